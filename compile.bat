@@ -12,7 +12,7 @@ if not exist "%SRC_DIR%" mkdir "%SRC_DIR%"
 
 REM 
 echo Compiling flight_booking.cpp...
-g++ -std=c++17 ^
+g++ -std=c++17 -pthread ^
  -I. ^
  -I"%VCPKG_DIR%\include" ^
  -L"%VCPKG_DIR%\lib" ^
@@ -26,7 +26,7 @@ if %ERRORLEVEL% NEQ 0 (
 
 REM 
 echo Compiling flight_simulator.cpp...
-g++ -std=c++17 ^
+g++ -std=c++17 -O2 -march=native -pthread ^
  -I. ^
  -I"%VCPKG_DIR%\include" ^
  -I"%SFML_DIR%\include" ^
@@ -0,0 +1,163 @@
+#pragma once
+
+// Anytime A* (ARA*): a route fast, then better ones while time allows, each
+// with a proven bound on how far from optimal it can be.
+//
+// Iteration k is weighted A* with f = g + eps_k * h, eps falling towards 1.
+// Weighted A* returns a route within eps of optimal, and ARA* does not start
+// over for the next eps: g-values, parents and the open list carry over, and
+// airports improved after being expanded in this iteration wait in an
+// INCONS list that rejoins the open list when eps drops. Each iteration
+// therefore only repairs what the smaller eps changes.
+//
+// The bound reported is min(eps, g(t) / min over OPEN and INCONS of g + h),
+// which holds at every step, so a search cut off by its deadline still
+// returns its best route with an honest bound. h must be admissible; it is
+// asked once per airport the search touches, never for the whole network.
+
+#include <vector>
+#include <set>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+struct AnytimeRoute
+{
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    std::vector<int> path; // empty when none was found in time
+    double length = Inf;
+    double bound = Inf;    // length <= bound * optimal
+    double epsilon = Inf;  // last heuristic weight searched to completion
+    int iterations = 0;    // completed
+    size_t expansions = 0;
+    bool timedOut = false;
+};
+
+// `arcs(u, relax)` calls relax(v, w) for every open arc u->v, w >= 0;
+// `estimate(v)` is an admissible estimate of the distance from v to t.
+template <typename Estimate, typename Arcs>
+AnytimeRoute anytimeAStar(int n, int s, int t, Estimate estimate, Arcs arcs, std::chrono::steady_clock::time_point deadline,
+                          double epsilon = 3.0, double step = 0.5)
+{
+    const double Inf = AnytimeRoute::Inf;
+    AnytimeRoute result;
+    std::vector<double> g(n, Inf), key(n, Inf), leg(n, 0); // leg: arc from parent
+    std::vector<double> known(n, -1);                      // estimates asked for so far
+    auto h = [&](int v)
+    {
+        if (known[v] < 0)
+            known[v] = estimate(v);
+        return known[v];
+    };
+    std::vector<int> parent(n, -1), closedIn(n, -1);
+    std::vector<char> inconsistent(n, 0);
+    std::vector<int> incons;
+    std::set<std::pair<double, int>> open;
+    double eps = std::max(1.0, epsilon);
+    auto f = [&](int v)
+    { return g[v] + eps * h(v); };
+    auto queue = [&](int v)
+    {
+        if (key[v] != Inf)
+            open.erase({key[v], v});
+        key[v] = f(v);
+        open.insert({key[v], v});
+    };
+
+    // Cut-off-safe suboptimality bound for the current g(t).
+    auto proven = [&]()
+    {
+        double lower = Inf;
+        for (const auto &[k, v] : open)
+            lower = std::min(lower, g[v] + h(v));
+        for (int v : incons)
+            lower = std::min(lower, g[v] + h(v));
+        if (g[t] == Inf)
+            return Inf;
+        return lower >= g[t] ? 1.0 : std::max(1.0, g[t] / lower);
+    };
+
+    // Expands until nothing open can improve t at this eps; false when the
+    // deadline passed first.
+    auto improve = [&](int iteration)
+    {
+        while (!open.empty() && f(t) > open.begin()->first)
+        {
+            if ((result.expansions & 7) == 0 && std::chrono::steady_clock::now() >= deadline)
+                return false;
+            int u = open.begin()->second;
+            open.erase(open.begin());
+            key[u] = Inf;
+            closedIn[u] = iteration;
+            ++result.expansions;
+            arcs(u, [&](int v, double w)
+                 {
+                     if (g[u] + w >= g[v])
+                         return;
+                     g[v] = g[u] + w;
+                     parent[v] = u;
+                     leg[v] = w;
+                     if (closedIn[v] != iteration)
+                         queue(v);
+                     else if (!inconsistent[v])
+                     {
+                         inconsistent[v] = 1;
+                         incons.push_back(v);
+                     } });
+        }
+        return true;
+    };
+
+    g[s] = 0;
+    queue(s);
+    double bound = Inf;
+    for (int iteration = 0;; ++iteration)
+    {
+        if (!improve(iteration))
+        {
+            result.timedOut = true;
+            bound = std::min(bound, proven());
+            break;
+        }
+        ++result.iterations;
+        result.epsilon = eps;
+        if (g[t] == Inf)
+            break;
+        // Once eps reaches 1 the bound is 1 too, which ends the loop.
+        bound = std::min(eps, proven());
+        if (bound <= 1.0)
+            break;
+
+        // Smaller eps: INCONS rejoins OPEN and every key is recomputed.
+        eps = std::max(1.0, std::min(eps - step, bound));
+        for (int v : incons)
+            inconsistent[v] = 0;
+        std::vector<int> waiting;
+        for (const auto &[k, v] : open)
+            waiting.push_back(v);
+        waiting.insert(waiting.end(), incons.begin(), incons.end());
+        incons.clear();
+        open.clear();
+        for (int v : waiting)
+        {
+            key[v] = f(v);
+            open.insert({key[v], v});
+        }
+    }
+
+    // The parent chain costs at most g(t): airports on it may have improved
+    // since t was reached through them.
+    if (g[t] != Inf)
+    {
+        result.length = 0;
+        for (int at = t, hops = 0; at != -1 && hops <= n; at = parent[at], ++hops)
+        {
+            result.path.push_back(at);
+            result.length += leg[at];
+        }
+        std::reverse(result.path.begin(), result.path.end());
+        result.bound = bound;
+    }
+    return result;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+// Arc-flags: goal-directed pruning for Dijkstra-style searches.
+//
+// Airports are split into up to 32 geographic regions. Every directed arc
+// u->v carries one bit per region, set when the arc starts some shortest
+// path into that region. A query towards a target in region R then only
+// scans arcs with bit R set, which on a geometric network leaves a narrow
+// corridor instead of a disc around the source.
+//
+// Flags are computed from the same per-edge weights the search uses, with
+// closed edges excluded (infinite weight). A closure can take away the only
+// flagged path into a region, so flags describe one weather state; callers
+// keep the state's version next to them and fall back to an unpruned search
+// when the two differ.
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <bitset>
+
+// Recursive coordinate bisection into 2^levels regions of equal size,
+// splitting the wider extent each time.
+inline std::vector<int> partitionByCoordinates(const std::vector<double> &x, const std::vector<double> &y, int levels)
+{
+    std::vector<int> region(x.size(), 0);
+    std::vector<int> ids(x.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    struct Range
+    {
+        size_t begin, end;
+        int region, depth;
+    };
+    std::vector<Range> stack{{0, ids.size(), 0, 0}};
+    while (!stack.empty())
+    {
+        Range r = stack.back();
+        stack.pop_back();
+        if (r.depth == levels || r.end - r.begin < 2)
+        {
+            for (size_t i = r.begin; i < r.end; ++i)
+                region[ids[i]] = r.region << (levels - r.depth);
+            continue;
+        }
+        double x0 = x[ids[r.begin]], x1 = x0, y0 = y[ids[r.begin]], y1 = y0;
+        for (size_t i = r.begin; i < r.end; ++i)
+        {
+            x0 = std::min(x0, x[ids[i]]), x1 = std::max(x1, x[ids[i]]);
+            y0 = std::min(y0, y[ids[i]]), y1 = std::max(y1, y[ids[i]]);
+        }
+        const std::vector<double> &key = (x1 - x0) >= (y1 - y0) ? x : y;
+        size_t mid = r.begin + (r.end - r.begin) / 2;
+        std::nth_element(ids.begin() + r.begin, ids.begin() + mid, ids.begin() + r.end, [&](int a, int b)
+                         { return key[a] < key[b]; });
+        stack.push_back({r.begin, mid, r.region * 2, r.depth + 1});
+        stack.push_back({mid, r.end, r.region * 2 + 1, r.depth + 1});
+    }
+    return region;
+}
+
+class ArcFlags
+{
+public:
+    static constexpr int MaxRegions = 32;
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    ArcFlags() = default;
+
+    // `edges[e]` = (u, v) of undirected edge e, `weight[e]` its cost (Inf when
+    // closed). Arc 2e runs u->v, arc 2e+1 runs v->u.
+    ArcFlags(const std::vector<int> &region, const std::vector<std::pair<int, int>> &edges, const std::vector<double> &weight, int threads = 1)
+        : region(region)
+    {
+        int n = static_cast<int>(region.size());
+        regionCount = region.empty() ? 0 : *std::max_element(region.begin(), region.end()) + 1;
+        flags.assign(edges.size() * 2, 0);
+
+        // Reverse adjacency: for node v, the open arcs ending at v.
+        std::vector<uint32_t> first(n + 1, 0);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            if (weight[e] == Inf)
+                continue;
+            ++first[edges[e].first + 1];
+            ++first[edges[e].second + 1];
+        }
+        for (int v = 0; v < n; ++v)
+            first[v + 1] += first[v];
+        std::vector<std::pair<int, uint32_t>> into(first[n]); // (arc tail, arc id)
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            if (weight[e] == Inf)
+                continue;
+            auto [u, v] = edges[e];
+            into[fill[v]++] = {u, static_cast<uint32_t>(2 * e)};
+            into[fill[u]++] = {v, static_cast<uint32_t>(2 * e + 1)};
+        }
+
+        // Arcs inside a region always carry its own bit.
+        std::vector<int> boundary;
+        std::vector<char> isBoundary(n, 0);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            if (weight[e] == Inf)
+                continue;
+            auto [u, v] = edges[e];
+            if (region[u] == region[v])
+                flags[2 * e] = flags[2 * e + 1] = bit(region[u]);
+            else
+                isBoundary[u] = isBoundary[v] = 1;
+        }
+        for (int v = 0; v < n; ++v)
+            if (isBoundary[v])
+                boundary.push_back(v);
+
+        // One backward search per boundary node b: the tree arcs leading to b
+        // are shortest paths into b's region.
+        threads = std::max(1, threads);
+        std::atomic<size_t> next{0};
+        std::vector<std::vector<uint32_t>> local(threads);
+        auto work = [&](int t)
+        {
+            std::vector<uint32_t> &mine = local[t];
+            mine.assign(flags.size(), 0);
+            std::vector<double> dist(n, Inf);
+            std::vector<int64_t> via(n, -1);
+            std::vector<int> reached;
+            using Item = std::pair<double, int>;
+            std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+            for (size_t i = next.fetch_add(1); i < boundary.size(); i = next.fetch_add(1))
+            {
+                int b = boundary[i];
+                uint32_t mask = bit(region[b]);
+                dist[b] = 0;
+                reached.push_back(b);
+                pq.push({0, b});
+                while (!pq.empty())
+                {
+                    auto [d, v] = pq.top();
+                    pq.pop();
+                    if (d > dist[v])
+                        continue;
+                    if (via[v] >= 0)
+                        mine[via[v]] |= mask;
+                    for (uint32_t k = first[v]; k < first[v + 1]; ++k)
+                    {
+                        auto [u, arc] = into[k];
+                        double alt = d + weight[arc / 2];
+                        if (alt < dist[u])
+                        {
+                            if (dist[u] == Inf)
+                                reached.push_back(u);
+                            dist[u] = alt;
+                            via[u] = arc;
+                            pq.push({alt, u});
+                        }
+                    }
+                }
+                for (int v : reached)
+                {
+                    dist[v] = Inf;
+                    via[v] = -1;
+                }
+                reached.clear();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t)
+            pool.emplace_back(work, t);
+        work(0);
+        for (auto &t : pool)
+            t.join();
+        for (const auto &mine : local)
+            for (size_t a = 0; a < flags.size(); ++a)
+                flags[a] |= mine[a];
+        boundaryCount = boundary.size();
+    }
+
+    bool empty() const { return flags.empty(); }
+    int regions() const { return regionCount; }
+    size_t boundaryNodes() const { return boundaryCount; }
+    uint32_t targetMask(int target) const { return bit(region[target]); }
+
+    // Arc of edge `edgeId` leaving `from` (one of its two ends).
+    bool allows(int edgeId, bool fromFirstEnd, uint32_t mask) const
+    {
+        return (flags[2 * static_cast<size_t>(edgeId) + (fromFirstEnd ? 0 : 1)] & mask) != 0;
+    }
+
+    // Share of arcs flagged for an average region.
+    double density() const
+    {
+        if (flags.empty() || regionCount == 0)
+            return 0;
+        size_t set = 0;
+        for (uint32_t f : flags)
+            set += std::bitset<32>(f).count();
+        return static_cast<double>(set) / (static_cast<double>(flags.size()) * regionCount);
+    }
+
+private:
+    std::vector<int> region;
+    std::vector<uint32_t> flags;
+    int regionCount = 0;
+    size_t boundaryCount = 0;
+
+    static uint32_t bit(int r) { return 1u << (r % MaxRegions); }
+};
@@ -0,0 +1,508 @@
+#pragma once
+
+// Customizable contraction hierarchy over an undirected graph.
+//
+// Three phases:
+//  - ordering: nested dissection on airport coordinates, done once per
+//    network and independent of any metric (nestedDissectionOrder);
+//  - preparation: eliminate nodes in that order and keep the chordal
+//    supergraph of upward arcs, plus every arc's lower triangles
+//    (CustomizableCH constructor);
+//  - customization: given one weight per input edge, settle every arc as
+//    min(own weight, cheapest lower triangle), bottom-up. Arcs whose lower
+//    endpoints share a level do not depend on each other, so each level is
+//    split across threads (customize).
+//
+// Queries walk the elimination tree upward from both ends and meet at the
+// cheapest common node, with no priority queue.
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// Node order for a CCH: each half of a coordinate bisection first, the nodes
+// separating them last. `edges` are (u, v) pairs; x/y are any planar-ish
+// coordinates (lon/lat will do).
+inline std::vector<int> nestedDissectionOrder(int n, const std::vector<std::pair<int, int>> &edges, const std::vector<double> &x,
+                                              const std::vector<double> &y)
+{
+    std::vector<std::vector<int>> adj(n);
+    for (const auto &e : edges)
+    {
+        adj[e.first].push_back(e.second);
+        adj[e.second].push_back(e.first);
+    }
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<int> side(n, -1);
+
+    // Explicit stack of (nodes, separator-to-emit-after) frames so deep
+    // recursion cannot overflow on large networks.
+    struct Frame
+    {
+        std::vector<int> nodes;
+        bool emit;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({std::vector<int>(n), false});
+    std::iota(stack.back().nodes.begin(), stack.back().nodes.end(), 0);
+    while (!stack.empty())
+    {
+        Frame frame = std::move(stack.back());
+        stack.pop_back();
+        std::vector<int> &nodes = frame.nodes;
+        if (frame.emit || nodes.size() <= 4)
+        {
+            order.insert(order.end(), nodes.begin(), nodes.end());
+            continue;
+        }
+
+        // Try straight cuts in four directions at a few positions around the
+        // middle and keep the one whose separator is smallest.
+        auto coverCut = [&](std::vector<int> cover[2])
+        {
+            cover[0].clear(), cover[1].clear();
+            for (int v : nodes)
+            {
+                for (int w : adj[v])
+                {
+                    if (side[w] >= 0 && side[w] != side[v])
+                    {
+                        cover[side[v]].push_back(v);
+                        break;
+                    }
+                }
+            }
+            return std::min(cover[0].size(), cover[1].size());
+        };
+        const double dirs[4][2] = {{1, 0}, {0, 1}, {0.7071, 0.7071}, {0.7071, -0.7071}};
+        const double fractions[] = {0.4, 0.45, 0.5, 0.55, 0.6};
+        std::vector<std::pair<double, int>> keyed(nodes.size());
+        std::vector<int> bestSide;
+        size_t bestSize = std::numeric_limits<size_t>::max();
+        std::vector<int> cover[2];
+        for (const auto &d : dirs)
+        {
+            for (size_t i = 0; i < nodes.size(); ++i)
+                keyed[i] = {d[0] * x[nodes[i]] + d[1] * y[nodes[i]], nodes[i]};
+            std::sort(keyed.begin(), keyed.end());
+            for (double f : fractions)
+            {
+                size_t mid = static_cast<size_t>(f * nodes.size());
+                for (size_t i = 0; i < keyed.size(); ++i)
+                    side[keyed[i].second] = i < mid ? 0 : 1;
+                size_t size = coverCut(cover);
+                if (size < bestSize)
+                {
+                    bestSize = size;
+                    bestSide.resize(nodes.size());
+                    for (size_t i = 0; i < nodes.size(); ++i)
+                        bestSide[i] = side[nodes[i]];
+                }
+            }
+        }
+        for (size_t i = 0; i < nodes.size(); ++i)
+            side[nodes[i]] = bestSide[i];
+        coverCut(cover);
+        int sepSide = cover[0].size() <= cover[1].size() ? 0 : 1;
+        for (int v : cover[sepSide])
+            side[v] = 2;
+        std::vector<int> part[2];
+        for (int v : nodes)
+            if (side[v] < 2)
+                part[side[v]].push_back(v);
+        for (int v : nodes)
+            side[v] = -1;
+
+        if (part[0].empty() || part[1].empty())
+        {
+            // Degenerate split (e.g. identical coordinates): fall back to any order.
+            stack.push_back({std::move(nodes), true});
+            continue;
+        }
+        // Popped last to first: part 0, part 1, then the separator.
+        stack.push_back({std::move(cover[sepSide]), true});
+        stack.push_back({std::move(part[1]), false});
+        stack.push_back({std::move(part[0]), false});
+    }
+    return order;
+}
+
+class CustomizableCH
+{
+public:
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    // One customization: a settled weight and an unpacking hint per arc,
+    // plus the arcs queries actually need (see perfect()).
+    struct Metric
+    {
+        std::vector<double> weight;
+        // Lower node of the triangle the weight came from, -1 for an input edge.
+        std::vector<int> middle;
+        std::vector<uint32_t> queryFirst;
+        std::vector<int> queryHead;
+        std::vector<double> queryWeight;
+    };
+
+    CustomizableCH() = default;
+
+    CustomizableCH(int n, const std::vector<std::pair<int, int>> &edges, const std::vector<int> &order)
+        : n(n), rank(n), node(order)
+    {
+        for (int r = 0; r < n; ++r)
+            rank[order[r]] = r;
+
+        // Elimination: each node's higher neighbours become a clique, which is
+        // recorded by merging them into the lowest one (its tree parent).
+        std::vector<std::vector<int>> up(n);
+        for (const auto &e : edges)
+        {
+            int a = rank[e.first], b = rank[e.second];
+            if (a == b)
+                continue;
+            up[std::min(a, b)].push_back(std::max(a, b));
+        }
+        parent.assign(n, -1);
+        std::vector<int> merged;
+        for (int r = 0; r < n; ++r)
+        {
+            std::sort(up[r].begin(), up[r].end());
+            up[r].erase(std::unique(up[r].begin(), up[r].end()), up[r].end());
+            if (up[r].empty())
+                continue;
+            int p = up[r][0];
+            parent[r] = p;
+            merged.clear();
+            std::set_union(up[p].begin(), up[p].end(), up[r].begin() + 1, up[r].end(), std::back_inserter(merged));
+            up[p].swap(merged);
+        }
+
+        first.assign(n + 1, 0);
+        for (int r = 0; r < n; ++r)
+            first[r + 1] = first[r] + static_cast<uint32_t>(up[r].size());
+        head.reserve(first[n]);
+        tail.reserve(first[n]);
+        for (int r = 0; r < n; ++r)
+        {
+            head.insert(head.end(), up[r].begin(), up[r].end());
+            tail.insert(tail.end(), up[r].size(), r);
+        }
+
+        inputArc.resize(edges.size());
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            int a = rank[edges[e].first], b = rank[edges[e].second];
+            inputArc[e] = a == b ? -1 : findArc(std::min(a, b), std::max(a, b));
+        }
+
+        // Lower triangles of arc y->z: every x below both with arcs x->y, x->z.
+        triangleFirst.assign(arcs() + 1, 0);
+        for (int x = 0; x < n; ++x)
+            for (uint32_t i = first[x]; i < first[x + 1]; ++i)
+                for (uint32_t j = i + 1; j < first[x + 1]; ++j)
+                    ++triangleFirst[findArc(head[i], head[j]) + 1];
+        for (size_t a = 0; a < arcs(); ++a)
+            triangleFirst[a + 1] += triangleFirst[a];
+        triangles.resize(triangleFirst[arcs()]);
+        std::vector<uint32_t> fill(triangleFirst.begin(), triangleFirst.end() - 1);
+        for (int x = 0; x < n; ++x)
+            for (uint32_t i = first[x]; i < first[x + 1]; ++i)
+                for (uint32_t j = i + 1; j < first[x + 1]; ++j)
+                    triangles[fill[findArc(head[i], head[j])]++] = {i, j};
+
+        // Level = 1 + highest level below; same-level nodes share no triangle.
+        std::vector<int> level(n, 0);
+        int levelCount = 0;
+        for (int r = 0; r < n; ++r)
+        {
+            for (uint32_t a = first[r]; a < first[r + 1]; ++a)
+                level[head[a]] = std::max(level[head[a]], level[r] + 1);
+            levelCount = std::max(levelCount, level[r] + 1);
+        }
+        levelFirst.assign(levelCount + 1, 0);
+        for (int r = 0; r < n; ++r)
+            ++levelFirst[level[r] + 1];
+        for (int l = 0; l < levelCount; ++l)
+            levelFirst[l + 1] += levelFirst[l];
+        byLevel.resize(n);
+        std::vector<uint32_t> at(levelFirst.begin(), levelFirst.end() - 1);
+        for (int r = 0; r < n; ++r)
+            byLevel[at[level[r]]++] = r;
+    }
+
+    int nodes() const { return n; }
+    size_t arcs() const { return head.size(); }
+    size_t triangleCount() const { return triangles.size(); }
+    int levels() const { return static_cast<int>(levelFirst.size()) - 1; }
+
+    int treeHeight() const
+    {
+        int best = 0;
+        std::vector<int> depth(n, 0);
+        for (int r = n - 1; r >= 0; --r)
+        {
+            if (parent[r] >= 0)
+                depth[r] = depth[parent[r]] + 1;
+            best = std::max(best, depth[r]);
+        }
+        return best;
+    }
+
+    // `edgeWeight[e]` for input edge e; Inf closes it. Parallel edges keep the cheaper.
+    void customize(const std::vector<double> &edgeWeight, Metric &m, int threads = 1) const
+    {
+        m.weight.assign(arcs(), Inf);
+        m.middle.assign(arcs(), -1);
+        for (size_t e = 0; e < inputArc.size(); ++e)
+            if (inputArc[e] >= 0 && edgeWeight[e] < m.weight[inputArc[e]])
+                m.weight[inputArc[e]] = edgeWeight[e];
+
+        auto settle = [&](int y)
+        {
+            for (uint32_t a = first[y]; a < first[y + 1]; ++a)
+            {
+                double best = m.weight[a];
+                int via = -1;
+                for (uint32_t k = triangleFirst[a]; k < triangleFirst[a + 1]; ++k)
+                {
+                    double w = m.weight[triangles[k].first] + m.weight[triangles[k].second];
+                    if (w < best)
+                        best = w, via = tail[triangles[k].first];
+                }
+                if (via >= 0)
+                    m.weight[a] = best, m.middle[a] = via;
+            }
+        };
+
+        threads = std::max(1, threads);
+        if (threads == 1)
+        {
+            for (int r : byLevel)
+                settle(r);
+        }
+        else
+            settleParallel(settle, threads);
+        perfect(m);
+    }
+
+    // Arcs kept in the query graph; the rest are never on a shortest path.
+    static size_t queryArcs(const Metric &m) { return m.queryHead.size(); }
+
+    // Shortest s-t distance under a customization, Inf if unreachable.
+    double distance(const Metric &m, int s, int t) const
+    {
+        Search &q = search();
+        double best = meet(m, rank[s], rank[t], q).first;
+        reset(rank[s], rank[t], q);
+        return best;
+    }
+
+    // Node ids from s to t with every shortcut unpacked; empty if unreachable.
+    std::vector<int> path(const Metric &m, int s, int t) const
+    {
+        Search &q = search();
+        auto [best, top] = meet(m, rank[s], rank[t], q);
+        std::vector<int> result;
+        if (best < Inf)
+        {
+            // Hierarchy path in ranks: s up to the meeting node, then down to t.
+            std::vector<int> ranks;
+            for (int r = top; r != rank[s]; r = q.predS[r])
+                ranks.push_back(r);
+            ranks.push_back(rank[s]);
+            std::reverse(ranks.begin(), ranks.end());
+            for (int r = top; r != rank[t]; r = q.predT[r])
+                ranks.push_back(q.predT[r]);
+
+            std::vector<int> expanded{ranks[0]};
+            for (size_t i = 1; i < ranks.size(); ++i)
+                unpack(m, ranks[i - 1], ranks[i], expanded);
+            for (int r : expanded)
+                result.push_back(node[r]);
+        }
+        reset(rank[s], rank[t], q);
+        return result;
+    }
+
+private:
+    int n = 0;
+    std::vector<int> rank, node, parent;
+    std::vector<uint32_t> first;
+    std::vector<int> head, tail;
+    std::vector<int> inputArc;
+    std::vector<uint32_t> triangleFirst;
+    std::vector<std::pair<uint32_t, uint32_t>> triangles;
+    std::vector<uint32_t> levelFirst;
+    std::vector<int> byLevel;
+
+    struct Search
+    {
+        std::vector<double> ds, dt;
+        std::vector<int> predS, predT;
+    };
+
+    Search &search() const
+    {
+        static thread_local Search q;
+        if (q.ds.size() != static_cast<size_t>(n))
+        {
+            q.ds.assign(n, Inf);
+            q.dt.assign(n, Inf);
+            q.predS.assign(n, -1);
+            q.predT.assign(n, -1);
+        }
+        return q;
+    }
+
+    int findArc(int lower, int higher) const
+    {
+        auto begin = head.begin() + first[lower], end = head.begin() + first[lower + 1];
+        auto it = std::lower_bound(begin, end, higher);
+        return it != end && *it == higher ? static_cast<int>(it - head.begin()) : -1;
+    }
+
+    // Both upward walks; returns the best total and the rank it meets at.
+    std::pair<double, int> meet(const Metric &m, int s, int t, Search &q) const
+    {
+        q.ds[s] = 0;
+        for (int r = s; r >= 0; r = parent[r])
+        {
+            if (q.ds[r] == Inf)
+                continue;
+            for (uint32_t a = m.queryFirst[r]; a < m.queryFirst[r + 1]; ++a)
+            {
+                double d = q.ds[r] + m.queryWeight[a];
+                if (d < q.ds[m.queryHead[a]])
+                    q.ds[m.queryHead[a]] = d, q.predS[m.queryHead[a]] = r;
+            }
+        }
+        q.dt[t] = 0;
+        double best = Inf;
+        int top = -1;
+        for (int r = t; r >= 0; r = parent[r])
+        {
+            if (q.dt[r] == Inf)
+                continue;
+            if (q.ds[r] + q.dt[r] < best)
+                best = q.ds[r] + q.dt[r], top = r;
+            // Nothing from here on can beat a meeting point already found.
+            if (q.dt[r] >= best)
+                continue;
+            for (uint32_t a = m.queryFirst[r]; a < m.queryFirst[r + 1]; ++a)
+            {
+                double d = q.dt[r] + m.queryWeight[a];
+                if (d < q.dt[m.queryHead[a]])
+                    q.dt[m.queryHead[a]] = d, q.predT[m.queryHead[a]] = r;
+            }
+        }
+        return {best, top};
+    }
+
+    void reset(int s, int t, Search &q) const
+    {
+        for (int r = s; r >= 0; r = parent[r])
+        {
+            q.ds[r] = Inf;
+            q.predS[r] = -1;
+        }
+        for (int r = t; r >= 0; r = parent[r])
+        {
+            q.dt[r] = Inf;
+            q.predT[r] = -1;
+        }
+    }
+
+    // Appends the ranks after `a` up to and including `b` along the arc
+    // between them, expanding shortcuts through their lower middle nodes.
+    void unpack(const Metric &m, int a, int b, std::vector<int> &out) const
+    {
+        int x = m.middle[findArc(std::min(a, b), std::max(a, b))];
+        if (x < 0)
+        {
+            out.push_back(b);
+            return;
+        }
+        unpack(m, a, x, out);
+        unpack(m, x, b, out);
+    }
+
+    template <typename Settle>
+    void settleParallel(Settle &settle, int threads) const
+    {
+        // One pool for the whole pass: workers take chunks of a level, then
+        // meet at a barrier before the next level starts.
+        std::atomic<uint32_t> next{0};
+        std::atomic<int> arrived{0};
+        std::atomic<int> generation{0};
+        auto barrier = [&]()
+        {
+            int gen = generation.load();
+            if (arrived.fetch_add(1) + 1 == threads)
+            {
+                arrived.store(0);
+                next.store(0);
+                generation.fetch_add(1);
+            }
+            else
+                while (generation.load() == gen)
+                    std::this_thread::yield();
+        };
+        auto work = [&]()
+        {
+            const uint32_t chunk = 16;
+            for (int l = 0; l < levels(); ++l)
+            {
+                uint32_t begin = levelFirst[l], size = levelFirst[l + 1] - begin;
+                for (uint32_t i = next.fetch_add(chunk); i < size; i = next.fetch_add(chunk))
+                    for (uint32_t k = i; k < std::min(size, i + chunk); ++k)
+                        settle(byLevel[begin + k]);
+                barrier();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t)
+            pool.emplace_back(work);
+        work();
+        for (auto &t : pool)
+            t.join();
+    }
+
+    // Perfect customization, top-down: arc x->y also gets its upper and
+    // intermediate triangles, after which its weight is the true x-y
+    // distance. Arcs that got cheaper that way are not shortest paths
+    // themselves and are left out of the query graph. Every arc's triangles
+    // only touch arcs of lower tails, so walking arcs by descending tail sees
+    // each one final before it is used.
+    void perfect(Metric &m) const
+    {
+        std::vector<double> exact(m.weight);
+        for (size_t a = arcs(); a-- > 0;)
+        {
+            for (uint32_t k = triangleFirst[a]; k < triangleFirst[a + 1]; ++k)
+            {
+                uint32_t xy = triangles[k].first, xz = triangles[k].second;
+                exact[xy] = std::min(exact[xy], exact[xz] + exact[a]);
+                exact[xz] = std::min(exact[xz], exact[xy] + exact[a]);
+            }
+        }
+        m.queryFirst.assign(n + 1, 0);
+        m.queryHead.clear();
+        m.queryWeight.clear();
+        for (int r = 0; r < n; ++r)
+        {
+            for (uint32_t a = first[r]; a < first[r + 1]; ++a)
+            {
+                if (exact[a] < m.weight[a] || m.weight[a] == Inf)
+                    continue;
+                m.queryHead.push_back(head[a]);
+                m.queryWeight.push_back(m.weight[a]);
+            }
+            m.queryFirst[r + 1] = static_cast<uint32_t>(m.queryHead.size());
+        }
+    }
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+// Resource-constrained shortest paths: the route minimizing one metric
+// (say time) whose total in a second metric (say cost) stays within a
+// budget, by label setting.
+//
+// A label is (airport, primary, resource, parent label). Labels are settled
+// in order of primary plus a lower bound on the primary still to go, so an
+// airport's settled labels come out in non-decreasing primary order, and a
+// new label there is dominated exactly when one already settled used no more
+// resource. Two reverse Dijkstra searches from the target give those lower
+// bounds, one per metric: a label is dropped once even the least-resource
+// continuation overruns the budget, or once even the best primary
+// continuation cannot beat a feasible route already known.
+//
+// Labels live in one pool that is reused across queries; a query only pays
+// for the airports and labels it touches.
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+class ConstrainedRouter
+{
+public:
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+    // Labels one query may create (32 bytes each) before it gives up.
+    static constexpr size_t DefaultMaxLabels = 250000;
+
+    struct Result
+    {
+        std::vector<int> path; // empty when no route fits the budget
+        double primary = Inf, resource = Inf;
+        size_t labels = 0;     // labels created
+        bool exhausted = false; // gave up at the label limit
+    };
+
+    ConstrainedRouter() = default;
+
+    // `edges[e]` = (u, v) of undirected edge e.
+    ConstrainedRouter(int n, const std::vector<std::pair<int, int>> &edges)
+        : first(n + 1, 0), arcs(edges.size() * 2), lowPrimary(n, Inf), lowResource(n, Inf), bestResource(n, Inf)
+    {
+        for (const auto &[u, v] : edges)
+        {
+            ++first[u + 1];
+            ++first[v + 1];
+        }
+        for (int v = 0; v < n; ++v)
+            first[v + 1] += first[v];
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            arcs[fill[edges[e].first]++] = {edges[e].second, static_cast<int>(e)};
+            arcs[fill[edges[e].second]++] = {edges[e].first, static_cast<int>(e)};
+        }
+    }
+
+    // Minimizes the sum of `primary` with the sum of `resource` at most
+    // `budget`; an edge with an infinite weight in either is closed.
+    Result route(int s, int t, const std::vector<double> &primary, const std::vector<double> &resource, double budget, size_t maxLabels = DefaultMaxLabels)
+    {
+        Result result;
+        reverseSearch(t, primary, lowPrimary, touchedPrimary);
+        reverseSearch(t, resource, lowResource, touchedResource);
+        if (lowResource[s] > budget)
+        {
+            reset();
+            return result;
+        }
+
+        // The least-resource route is feasible, which bounds the answer.
+        double upper = Inf;
+        {
+            double p = 0;
+            int at = s;
+            for (size_t steps = 0; at != t && steps < lowResource.size(); ++steps)
+            {
+                int next = -1, edge = -1;
+                for (uint32_t k = first[at]; k < first[at + 1] && next < 0; ++k)
+                {
+                    auto [v, e] = arcs[k];
+                    if (primary[e] != Inf && resource[e] != Inf && lowResource[at] == resource[e] + lowResource[v])
+                        next = v, edge = e;
+                }
+                if (next < 0)
+                    break;
+                p += primary[edge];
+                at = next;
+            }
+            if (at == t)
+                upper = p;
+        }
+
+        pool.clear();
+        using Item = std::pair<double, uint32_t>; // (primary + bound, label)
+        std::priority_queue<Item, std::vector<Item>, std::greater<>> open;
+        pool.push_back({s, 0, 0, NoParent});
+        open.push({lowPrimary[s], 0});
+        uint32_t found = NoParent;
+        while (!open.empty())
+        {
+            uint32_t id = open.top().second;
+            open.pop();
+            Label label = pool[id];
+            if (label.resource >= bestResource[label.at])
+                continue;
+            if (bestResource[label.at] == Inf)
+                touchedLabels.push_back(label.at);
+            bestResource[label.at] = label.resource;
+            if (label.at == t)
+            {
+                found = id;
+                break;
+            }
+            if (pool.size() >= maxLabels)
+            {
+                result.exhausted = true;
+                break;
+            }
+            for (uint32_t k = first[label.at]; k < first[label.at + 1]; ++k)
+            {
+                auto [v, e] = arcs[k];
+                if (primary[e] == Inf || resource[e] == Inf)
+                    continue;
+                double p = label.primary + primary[e], r = label.resource + resource[e];
+                if (r + lowResource[v] > budget || p + lowPrimary[v] > upper || r >= bestResource[v])
+                    continue;
+                pool.push_back({v, p, r, id});
+                open.push({p + lowPrimary[v], static_cast<uint32_t>(pool.size() - 1)});
+            }
+        }
+        result.labels = pool.size();
+        if (found != NoParent)
+        {
+            result.primary = pool[found].primary;
+            result.resource = pool[found].resource;
+            for (uint32_t at = found; at != NoParent; at = pool[at].parent)
+                result.path.push_back(pool[at].at);
+            std::reverse(result.path.begin(), result.path.end());
+        }
+        reset();
+        return result;
+    }
+
+private:
+    static constexpr uint32_t NoParent = std::numeric_limits<uint32_t>::max();
+
+    struct Label
+    {
+        int at;
+        double primary, resource;
+        uint32_t parent;
+    };
+
+    std::vector<uint32_t> first;
+    std::vector<std::pair<int, int>> arcs; // (head, edge id)
+    std::vector<double> lowPrimary, lowResource, bestResource;
+    std::vector<int> touchedPrimary, touchedResource, touchedLabels;
+    std::vector<Label> pool;
+
+    void reverseSearch(int t, const std::vector<double> &weight, std::vector<double> &dist, std::vector<int> &touched)
+    {
+        using Item = std::pair<double, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+        dist[t] = 0;
+        touched.push_back(t);
+        pq.push({0, t});
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > dist[u])
+                continue;
+            for (uint32_t k = first[u]; k < first[u + 1]; ++k)
+            {
+                auto [v, e] = arcs[k];
+                if (d + weight[e] < dist[v])
+                {
+                    if (dist[v] == Inf)
+                        touched.push_back(v);
+                    dist[v] = d + weight[e];
+                    pq.push({dist[v], v});
+                }
+            }
+        }
+    }
+
+    void reset()
+    {
+        for (int v : touchedPrimary)
+            lowPrimary[v] = Inf;
+        for (int v : touchedResource)
+            lowResource[v] = Inf;
+        for (int v : touchedLabels)
+            bestResource[v] = Inf;
+        touchedPrimary.clear();
+        touchedResource.clear();
+        touchedLabels.clear();
+    }
+};
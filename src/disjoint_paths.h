@@ -0,0 +1,251 @@
+#pragma once
+
+// Disjoint route pairs: two s-t routes sharing no edge (or, optionally, no
+// intermediate airport) with the least total length, by Suurballe's
+// algorithm.
+//
+// The first Dijkstra gives distances d from s and the shortest path P1.
+// Reweighting every arc to w(u,v) + d(u) - d(v) makes all weights
+// non-negative and P1's arcs zero, so P1 can be turned around in place: the
+// second Dijkstra runs on the reduced weights with P1's arcs reversed at
+// cost 0. The route P2 it finds may walk back along parts of P1; those
+// pieces cancel, and what is left of P1 and P2 splits into the optimal
+// disjoint pair. Searching again without the shortest route's edges is
+// simpler but can miss a pair that exists, or settle for a worse one.
+//
+// For airport-disjoint pairs every airport is split into an entry and an
+// exit node joined by one zero-length arc, which only one route can use.
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+struct DisjointPair
+{
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    // Airports s..t and the edge ids between them; the primary is the
+    // shorter of the two. The backup is empty when no disjoint pair exists,
+    // and the primary is then simply the shortest route.
+    std::vector<int> primary, backup;
+    std::vector<int> primaryEdges, backupEdges;
+    double primaryLength = Inf, backupLength = Inf;
+};
+
+class DisjointPaths
+{
+public:
+    DisjointPaths() = default;
+
+    // `edges[e]` = (u, v) of undirected edge e.
+    DisjointPaths(int n, const std::vector<std::pair<int, int>> &edges)
+        : n(n), m(static_cast<int>(edges.size())), layouts{layout(edges, false), layout(edges, true)} {}
+
+    // `weight[e]` >= 0, Inf when closed. Safe to call from several threads.
+    DisjointPair route(int s, int t, const std::vector<double> &weight, bool airportDisjoint = false) const
+    {
+        const double Inf = DisjointPair::Inf;
+        const Layout &g = layouts[airportDisjoint];
+        DisjointPair result;
+        if (s == t)
+            return result;
+        auto w = [&](int a)
+        { return a < 2 * m ? weight[a / 2] : 0.0; };
+        int source = airportDisjoint ? s + n : s, target = t;
+
+        // Dijkstra from `source` over the arcs not in `skip`; a node x with
+        // back[x] >= 0 may also step back along that arc at cost 0.
+        using Item = std::pair<double, int>;
+        std::vector<double> dist(g.nodes, Inf);
+        std::vector<int> via(g.nodes, -1); // arc into x, or -2 - arc when stepped back along
+        auto search = [&](auto cost, const std::vector<char> &skip, const std::vector<int> &back)
+        {
+            std::fill(dist.begin(), dist.end(), Inf);
+            std::fill(via.begin(), via.end(), -1);
+            std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+            dist[source] = 0;
+            pq.push({0, source});
+            auto relax = [&](int y, double alt, int how)
+            {
+                if (alt < dist[y])
+                {
+                    dist[y] = alt;
+                    via[y] = how;
+                    pq.push({alt, y});
+                }
+            };
+            while (!pq.empty())
+            {
+                auto [d, x] = pq.top();
+                pq.pop();
+                if (d > dist[x])
+                    continue;
+                if (x == target)
+                    break;
+                for (uint32_t k = g.first[x]; k < g.first[x + 1]; ++k)
+                {
+                    int a = g.out[k];
+                    if (!skip[a] && w(a) != Inf)
+                        relax(g.head[a], d + cost(a), a);
+                }
+                if (back[x] >= 0)
+                    relax(g.tail[back[x]], d, -2 - back[x]);
+            }
+        };
+
+        std::vector<char> used(g.tail.size(), 0);
+        search(w, used, std::vector<int>(g.nodes, -1));
+        if (dist[target] == Inf)
+            return result;
+        // The search stopped at t, so distances beyond d(t) are only upper
+        // bounds; capping them at d(t) keeps every reduced weight
+        // non-negative and P1's still zero.
+        std::vector<double> potential(dist);
+        for (double &p : potential)
+            p = std::min(p, dist[target]);
+        std::vector<int> back(g.nodes, -1);
+        for (int x = target; x != source; x = g.tail[via[x]])
+        {
+            used[via[x]] = 1;
+            back[x] = via[x];
+        }
+        search([&](int a)
+               { return std::max(0.0, w(a) + potential[g.tail[a]] - potential[g.head[a]]); }, used, back);
+
+        std::vector<char> cancelled(g.tail.size(), 0);
+        if (dist[target] != Inf)
+        {
+            for (int x = target; x != source;)
+            {
+                int how = via[x];
+                if (how <= -2)
+                {
+                    cancelled[-2 - how] = 1;
+                    x = g.head[-2 - how];
+                    continue;
+                }
+                // Without split airports, crossing a P1 edge the other way
+                // cancels it as well.
+                if (!airportDisjoint && used[how ^ 1] == 1)
+                    cancelled[how ^ 1] = 1;
+                else
+                    used[how] = 2;
+                x = g.tail[how];
+            }
+        }
+
+        // The arcs left over form one or two arc-disjoint routes. They are
+        // grouped by tail in one list; rest[x] marks the end of x's unused
+        // arcs, which are taken from the back.
+        std::vector<int> begin(g.nodes + 1, 0);
+        for (size_t a = 0; a < g.tail.size(); ++a)
+            if (used[a] && !cancelled[a])
+                ++begin[g.tail[a] + 1];
+        for (int x = 0; x < g.nodes; ++x)
+            begin[x + 1] += begin[x];
+        std::vector<int> leaving(begin[g.nodes]), rest(begin.begin(), begin.end() - 1);
+        for (size_t a = 0; a < g.tail.size(); ++a)
+            if (used[a] && !cancelled[a])
+                leaving[rest[g.tail[a]]++] = static_cast<int>(a);
+        DisjointPair found[2];
+        int routes = 0;
+        for (; routes < 2 && rest[source] > begin[source]; ++routes)
+        {
+            DisjointPair &r = found[routes];
+            r.primary = {s};
+            r.primaryLength = 0;
+            int x = source;
+            for (size_t steps = 0; x != target && rest[x] > begin[x] && steps < g.tail.size(); ++steps)
+            {
+                int a = leaving[--rest[x]];
+                if (a < 2 * m)
+                {
+                    r.primaryEdges.push_back(a / 2);
+                    r.primary.push_back(g.head[a] % n);
+                    r.primaryLength += w(a);
+                }
+                x = g.head[a];
+            }
+            if (x != target)
+                break;
+        }
+        if (routes == 0)
+            return result;
+        if (routes == 2 && found[1].primaryLength < found[0].primaryLength)
+            std::swap(found[0], found[1]);
+        result = std::move(found[0]);
+        if (routes == 2)
+        {
+            result.backup = std::move(found[1].primary);
+            result.backupEdges = std::move(found[1].primaryEdges);
+            result.backupLength = found[1].primaryLength;
+        }
+        return result;
+    }
+
+    // Pairs for many origin-destination queries (every booked itinerary,
+    // say, overnight), spread over `threads`.
+    std::vector<DisjointPair> routeAll(const std::vector<std::pair<int, int>> &queries, const std::vector<double> &weight, bool airportDisjoint = false,
+                                       int threads = 1) const
+    {
+        std::vector<DisjointPair> results(queries.size());
+        threads = std::max(1, std::min(threads, static_cast<int>(queries.size())));
+        auto work = [&](int t)
+        {
+            for (size_t q = t; q < queries.size(); q += threads)
+                results[q] = route(queries[q].first, queries[q].second, weight, airportDisjoint);
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t)
+            pool.emplace_back(work, t);
+        work(0);
+        for (auto &t : pool)
+            t.join();
+        return results;
+    }
+
+private:
+    // Arcs 2e and 2e+1 run both ways along edge e. With split airports,
+    // node v is v's entry, node n + v its exit, edge arcs run exit to entry
+    // and arc 2m + v is v's entry-to-exit arc.
+    struct Layout
+    {
+        int nodes = 0;
+        std::vector<int> tail, head;
+        std::vector<uint32_t> first, out;
+    };
+
+    int n = 0, m = 0;
+    Layout layouts[2];
+
+    Layout layout(const std::vector<std::pair<int, int>> &edges, bool split) const
+    {
+        Layout g;
+        g.nodes = split ? 2 * n : n;
+        int exitOffset = split ? n : 0;
+        size_t arcs = 2 * edges.size() + (split ? n : 0);
+        g.tail.resize(arcs);
+        g.head.resize(arcs);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            auto [u, v] = edges[e];
+            g.tail[2 * e] = u + exitOffset, g.head[2 * e] = v;
+            g.tail[2 * e + 1] = v + exitOffset, g.head[2 * e + 1] = u;
+        }
+        for (int v = 0; split && v < n; ++v)
+            g.tail[2 * edges.size() + v] = v, g.head[2 * edges.size() + v] = v + n;
+        g.first.assign(g.nodes + 1, 0);
+        for (int x : g.tail)
+            ++g.first[x + 1];
+        for (int x = 0; x < g.nodes; ++x)
+            g.first[x + 1] += g.first[x];
+        g.out.resize(arcs);
+        std::vector<uint32_t> fill(g.first.begin(), g.first.end() - 1);
+        for (size_t a = 0; a < arcs; ++a)
+            g.out[fill[g.tail[a]]++] = static_cast<uint32_t>(a);
+        return g;
+    }
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+// Read-mostly state shared between one writer and many query threads.
+//
+// SnapshotCell<T> holds a pointer to an immutable T. Readers pin the current
+// value with read() and never block: a pin is one store into the thread's
+// epoch slot and one pointer load. The writer builds the next T off to the
+// side and publishes it with a single pointer swap. Replaced values are kept
+// on a retire list tagged with the epoch they were retired in and freed once
+// every pinned reader has moved past that epoch, so a reader can keep using
+// what it loaded for as long as its guard lives.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+// Process-wide epoch clock plus one announcement slot per live thread.
+class EpochDomain
+{
+public:
+    static constexpr int MaxThreads = 256;
+
+    static EpochDomain &instance()
+    {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    // Pins the calling thread to the current epoch. Nested pins are counted
+    // and only the outermost one announces.
+    void enter()
+    {
+        ThreadSlot &t = threadSlot();
+        if (t.depth++ == 0)
+            slots[t.index].epoch.store(clock.load());
+    }
+
+    void leave()
+    {
+        ThreadSlot &t = threadSlot();
+        if (--t.depth == 0)
+            slots[t.index].epoch.store(0, std::memory_order_release);
+    }
+
+    // Moves the clock on and returns the epoch that just ended.
+    uint64_t advance() { return clock.fetch_add(1); }
+
+    // Oldest epoch any thread is pinned to, or max() when none is.
+    uint64_t oldestPinned() const
+    {
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for (const auto &s : slots)
+        {
+            uint64_t e = s.epoch.load();
+            if (e != 0 && e < oldest)
+                oldest = e;
+        }
+        return oldest;
+    }
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> taken{false};
+    };
+
+    struct ThreadSlot
+    {
+        int index = -1;
+        int depth = 0;
+        ~ThreadSlot()
+        {
+            if (index >= 0)
+                EpochDomain::instance().slots[index].taken.store(false, std::memory_order_release);
+        }
+    };
+
+    Slot slots[MaxThreads];
+    std::atomic<uint64_t> clock{1};
+
+    // Claims a free slot on a thread's first pin and releases it on thread exit.
+    // With every slot taken, new threads wait for one to free up.
+    ThreadSlot &threadSlot()
+    {
+        static thread_local ThreadSlot t;
+        while (t.index < 0)
+        {
+            for (int i = 0; i < MaxThreads && t.index < 0; ++i)
+            {
+                bool expected = false;
+                if (slots[i].taken.compare_exchange_strong(expected, true))
+                    t.index = i;
+            }
+            if (t.index < 0)
+                std::this_thread::yield();
+        }
+        return t;
+    }
+};
+
+template <typename T>
+class SnapshotCell
+{
+public:
+    SnapshotCell() = default;
+    SnapshotCell(const SnapshotCell &) = delete;
+    SnapshotCell &operator=(const SnapshotCell &) = delete;
+
+    ~SnapshotCell()
+    {
+        delete current.load();
+        for (auto &r : retired)
+            delete r.value;
+    }
+
+    // Keeps the loaded value alive until the guard goes away.
+    class Guard
+    {
+    public:
+        explicit Guard(const SnapshotCell &cell)
+        {
+            EpochDomain::instance().enter();
+            value = cell.current.load();
+        }
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+        ~Guard() { EpochDomain::instance().leave(); }
+
+        const T *get() const { return value; }
+        const T &operator*() const { return *value; }
+        const T *operator->() const { return value; }
+        explicit operator bool() const { return value != nullptr; }
+
+    private:
+        const T *value = nullptr;
+    };
+
+    Guard read() const { return Guard(*this); }
+
+    // Writer side; concurrent publishers are serialized against each other.
+    void publish(std::unique_ptr<const T> next)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        const T *old = current.exchange(next.release());
+        if (old)
+            retired.push_back({EpochDomain::instance().advance(), old});
+        reclaimLocked();
+    }
+
+    // Frees retired values no reader can still hold; returns how many remain.
+    size_t reclaim()
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        return reclaimLocked();
+    }
+
+    size_t freed() const { return freedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Retired
+    {
+        uint64_t epoch;
+        const T *value;
+    };
+
+    std::atomic<const T *> current{nullptr};
+    std::mutex writer;
+    std::vector<Retired> retired;
+    std::atomic<size_t> freedCount{0};
+
+    // A reader pinned at epoch e may hold anything retired in epoch >= e.
+    size_t reclaimLocked()
+    {
+        uint64_t oldest = EpochDomain::instance().oldestPinned();
+        size_t kept = 0;
+        for (auto &r : retired)
+        {
+            if (r.epoch < oldest)
+            {
+                delete r.value;
+                freedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+                retired[kept++] = r;
+        }
+        retired.resize(kept);
+        return kept;
+    }
+};
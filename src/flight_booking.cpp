@@ -14,15 +14,22 @@
 #include <unordered_map>
 #include <climits>
 #include <cmath>
+#if __has_include("config.h")
 #include "config.h"
+#endif
+#include "weather_provider.h"
+#include "forecast_cache.h"
 using namespace std;
 
-string apiKey = OPENWEATHERMAP_API_KEY;
-
 #ifndef OPENWEATHERMAP_API_KEY
-#error "API key not defined! Please create config.h and define OPENWEATHERMAP_API_KEY."
+#define OPENWEATHERMAP_API_KEY ""
 #endif
 
+string apiKey = getenv("OPENWEATHERMAP_API_KEY") ? getenv("OPENWEATHERMAP_API_KEY") : OPENWEATHERMAP_API_KEY;
+unique_ptr<WeatherProvider> weatherProvider = makeWeatherProvider();
+ForecastCache forecastCache(*weatherProvider);
+string routeServerUrl = getenv("AEROROUTE_SERVER") ? getenv("AEROROUTE_SERVER") : "http://127.0.0.1:8080";
+
 struct Airport
 {
     string code;
@@ -447,83 +454,34 @@ string toAPIDate(const string &dateStr)
     return oss.str();
 }
 
-SimpleWeather getForecastWeather(double lat, double lon, const string &apiKey, const string &date, const string &time)
+SimpleWeather forecastAt(const ForecastSeries &series, const string &date, const string &time)
 {
-    ostringstream url;
-    url << "http://api.openweathermap.org/data/2.5/forecast?lat=" << lat
-        << "&lon=" << lon
-        << "&appid=" << apiKey
-        << "&units=metric";
-    cpr::Response r = cpr::Get(cpr::Url{url.str()});
-    if (r.status_code == 200)
-    {
-        nlohmann::json j = nlohmann::json::parse(r.text);
-
-        tm flight_tm = {};
-        sscanf(date.c_str(), "%d/%d/%d", &flight_tm.tm_mday, &flight_tm.tm_mon, &flight_tm.tm_year);
-        flight_tm.tm_year -= 1900;
-        flight_tm.tm_mon -= 1;
-        sscanf(time.c_str(), "%d:%d", &flight_tm.tm_hour, &flight_tm.tm_min);
-        flight_tm.tm_sec = 0;
-
-        time_t flight_time = mktime(&flight_tm);
-        time_t min_diff = LLONG_MAX;
-        nlohmann::json bestEntry;
+    int i = series.closest(forecastQueryTime(date, time));
+    if (i >= 0)
+        return {series.main(i), series.desc(i), series.temp[i], series.humidity[i], series.wind[i]};
+    return {"--", "--", -1, -1, -1};
+}
 
-        for (const auto &entry : j["list"])
-        {
-            string dt_txt = entry["dt_txt"];
-            tm entry_tm = {};
-            sscanf(dt_txt.c_str(), "%d-%d-%d %d:%d:%d", &entry_tm.tm_year, &entry_tm.tm_mon, &entry_tm.tm_mday, &entry_tm.tm_hour, &entry_tm.tm_min, &entry_tm.tm_sec);
-            entry_tm.tm_year -= 1900;
-            entry_tm.tm_mon -= 1;
-            time_t entry_time = mktime(&entry_tm);
-            time_t diff = abs(entry_time - flight_time);
-            if (diff < min_diff)
-            {
-                min_diff = diff;
-                bestEntry = entry;
-            }
-        }
+SimpleWeather getForecastWeather(const Airport &airport, const string &date, const string &time)
+{
+    return forecastAt(*forecastCache.get(airport.code, airport.latitude, airport.longitude, apiKey), date, time);
+}
 
-        if (!bestEntry.is_null())
-        {
-            string main = bestEntry["weather"][0]["main"].get<string>();
-            string desc = bestEntry["weather"][0]["description"].get<string>();
-            double temp = bestEntry["main"]["temp"];
-            int humidity = bestEntry["main"]["humidity"];
-            double wind = bestEntry["wind"]["speed"];
-            return {main, desc, temp, humidity, wind};
-        }
-    }
+SimpleWeather currentFromResponse(const WeatherResponse &r)
+{
+    WeatherRecord w;
+    if (r.status == 200 && parseCurrentRecord(r.text, w))
+        return {weatherMainName(w.main), DescriptionTable::instance().text(w.description), w.temp, w.humidity, w.wind};
     return {"--", "--", -1, -1, -1};
 }
 
 SimpleWeather getCurrentWeather(double lat, double lon, const string &apiKey)
 {
-    ostringstream url;
-    url << "http://api.openweathermap.org/data/2.5/weather?lat=" << lat
-        << "&lon=" << lon
-        << "&appid=" << apiKey
-        << "&units=metric";
-    cpr::Response r = cpr::Get(cpr::Url{url.str()});
-
-    if (r.status_code == 200)
-    {
-        nlohmann::json j = nlohmann::json::parse(r.text);
-        string main = j["weather"][0]["main"].get<string>();
-        string desc = j["weather"][0]["description"].get<string>();
-        double temp = j["main"]["temp"];
-        int humidity = j["main"]["humidity"];
-        double wind = j["wind"]["speed"];
-        return {main, desc, temp, humidity, wind};
-    }
-    return {"--", "--", -1, -1, -1};
+    return currentFromResponse(weatherProvider->fetchCurrent(lat, lon, apiKey).get());
 }
 
-void printDetailedWeather(double lat, double lon, const string &apiKey, const string &airportCode, const string &date, const string &time)
+void printDetailedWeather(const SimpleWeather &w, const string &airportCode)
 {
-    SimpleWeather w = getCurrentWeather(lat, lon, apiKey);
     cout << "\nWEATHER AT " << airportCode << " :\n";
     if (w.temp == -1)
     {
@@ -612,14 +570,18 @@ FlightTicket bookFlight(const vector<Airport> &airports, int src, int dst)
          << setw(9) << "A.Wind" << endl;
     printLine('-', tableWidth);
 
+    // Both series cover all five days; fetch whichever is not cached, in parallel.
+    forecastCache.prefetch(airports[src].code, airports[src].latitude, airports[src].longitude, apiKey);
+    forecastCache.prefetch(airports[dst].code, airports[dst].latitude, airports[dst].longitude, apiKey);
+
     for (int i = 0; i < 5; ++i)
     {
         Date flightDate = currentDate.addDays(i);
         auto [departureTime, arrivalTime] = generateFlightTimes(distance);
         double price = generateRandomPrice(distance, i);
 
-        SimpleWeather depWeather = getForecastWeather(airports[src].latitude, airports[src].longitude, apiKey, flightDate.toString(), departureTime);
-        SimpleWeather arrWeather = getForecastWeather(airports[dst].latitude, airports[dst].longitude, apiKey, flightDate.toString(), arrivalTime);
+        SimpleWeather depWeather = getForecastWeather(airports[src], flightDate.toString(), departureTime);
+        SimpleWeather arrWeather = getForecastWeather(airports[dst], flightDate.toString(), arrivalTime);
         FlightTicket ticket;
 
         ticket.departureAirportCode = airports[src].code;
@@ -757,8 +719,10 @@ FlightTicket bookFlight(const vector<Airport> &airports, int src, int dst)
     cout << "Now checking weather conditions for your flight..." << endl;
     cout.flush();
 
-    printDetailedWeather(airports[src].latitude, airports[src].longitude, apiKey, airports[src].code, selectedTicket.departureDate, selectedTicket.departureTime);
-    printDetailedWeather(airports[dst].latitude, airports[dst].longitude, apiKey, airports[dst].code, selectedTicket.departureDate, selectedTicket.arrivalTime);
+    auto depNow = weatherProvider->fetchCurrent(airports[src].latitude, airports[src].longitude, apiKey);
+    auto arrNow = weatherProvider->fetchCurrent(airports[dst].latitude, airports[dst].longitude, apiKey);
+    printDetailedWeather(currentFromResponse(depNow.get()), airports[src].code);
+    printDetailedWeather(currentFromResponse(arrNow.get()), airports[dst].code);
 
     return selectedTicket;
 }
@@ -889,6 +853,39 @@ void findBookingByReference(const unordered_map<string, FlightTicket> &bookingMa
     }
 }
 
+bool showRoutesFromServer(const FlightTicket &ticket)
+{
+    cpr::Response r = cpr::Get(cpr::Url{routeServerUrl + "/routes?src=" + ticket.departureAirportCode + "&dst=" + ticket.arrivalAirportCode}, cpr::Timeout{1000});
+    if (r.status_code != 200)
+        return false;
+
+    nlohmann::json j = nlohmann::json::parse(r.text, nullptr, false);
+    if (j.is_discarded())
+        return false;
+
+    cout << "Using Route Server at " << routeServerUrl << endl;
+    if (j.value("rerouted", false))
+    {
+        printLine('-');
+        cout << "PATH REROUTED DUE TO BAD WEATHER" << endl;
+    }
+    vector<pair<string, string>> options = {{"shortest", "Shortest"}, {"cheapest", "Cheapest"}, {"fastest", "Fastest"}};
+    for (const auto &[key, label] : options)
+    {
+        const auto &route = j[key];
+        cout << label << " Path : ";
+        if (!route.value("found", false))
+        {
+            cout << "[NO VALID PATH DUE TO WEATHER]" << endl;
+            continue;
+        }
+        for (const auto &code : route["path"])
+            cout << code.get<string>() << " ";
+        cout << fixed << setprecision(1) << "| Length: " << route["distance"].get<double>() << " | Cost: $" << route["cost"].get<double>() << " | Time: " << route["time"].get<double>() << " min" << endl;
+    }
+    return true;
+}
+
 int main()
 {
     ios_base::sync_with_stdio(true);
@@ -1007,9 +1004,12 @@ int main()
         ticket.departureTime = generateRandomTime();
     }
 
-    string command = "flight_simulator.exe " + to_string(simSrc) + " " + to_string(simDst) + " " + ticket.departureDate + " " + ticket.departureTime;
-
-    int result = system(command.c_str());
+    int result = 0;
+    if (!showRoutesFromServer(ticket))
+    {
+        string command = "flight_simulator.exe " + to_string(simSrc) + " " + to_string(simDst) + " " + ticket.departureDate + " " + ticket.departureTime;
+        result = system(command.c_str());
+    }
     if (result != 0)
     {
         cout << "\nERROR : Could not launch Flight Simulator." << endl;
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <string>
 #include <cctype>
+#include <cerrno>
 #include <iomanip>
 #include <ctime>
 #include <random>
@@ -14,11 +15,38 @@
 #include <sstream>
 #include <filesystem>
 #include <set>
+#include <map>
 #include <unordered_map>
+#include <functional>
+#include <numeric>
+#include <future>
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
 #include <fstream>
+#if __has_include("config.h")
 #include "config.h"
+#endif
+#include "http_server.h"
+#include "geodesic.h"
+#include "geo_index.h"
+#include "weather_provider.h"
+#include "forecast_cache.h"
+#include "weather_records.h"
+#include "storm_field.h"
+#include "weather_grid.h"
+#include "weather_feed.h"
+#include "epoch_snapshot.h"
+#include "cch.h"
+#include "arc_flags.h"
+#include "hub_labels.h"
+#include "replacement_paths.h"
+#include "johnson.h"
+#include "constrained_routes.h"
+#include "itinerary.h"
+#include "disjoint_paths.h"
+#include "passenger_flow.h"
+#include "isochrone.h"
+#include "anytime_search.h"
 using namespace std;
 
 #ifndef M_PI
@@ -26,10 +54,36 @@ using namespace std;
 #endif
 
 #ifndef OPENWEATHERMAP_API_KEY
-#error "API key not defined! Please create config.h and define OPENWEATHERMAP_API_KEY."
+#define OPENWEATHERMAP_API_KEY ""
 #endif
 
-string apiKey = OPENWEATHERMAP_API_KEY;
+string apiKey = getenv("OPENWEATHERMAP_API_KEY") ? getenv("OPENWEATHERMAP_API_KEY") : OPENWEATHERMAP_API_KEY;
+const double cruiseSpeedKmh = 800.0;
+unique_ptr<WeatherProvider> weatherProvider = makeWeatherProvider();
+ForecastCache forecastCache(*weatherProvider);
+
+// Gridded weather for along-route checks. Only the storm backend can fill a
+// raster today; other modes leave it null and judge segments by endpoints.
+unique_ptr<WeatherGrid> makeWeatherGrid()
+{
+    if (weatherMode() != "storm")
+    return nullptr;
+    StormFieldConfig config = stormConfigFromEnv();
+    long long start = time(nullptr) / 10800 * 10800;
+    unique_ptr<WeatherGrid> grid(new WeatherGrid(config.latMin, config.latMax, config.lonMin, config.lonMax, 0.25, start, 10800, 40));
+    grid->rasterize(StormField(config));
+    return grid;
+}
+
+unique_ptr<WeatherGrid> weatherGrid = makeWeatherGrid();
+
+// Re-anchors the raster at the current slice and rasterizes the field again,
+// so a long-running server's along-route checks never run off its span.
+void refreshWeatherGrid()
+{
+    if (weatherGrid)
+    weatherGrid->refresh(StormField(stormConfigFromEnv()), time(nullptr) / 10800 * 10800);
+}
 
 struct Airport
 {
@@ -46,60 +100,497 @@ struct WeatherCondition
     string description;
 };
 
+// Graded weather cost on an open edge: extra block minutes and fare.
+struct EdgePenalty
+{
+    float minutes = 0;
+    float cost = 0;
+};
+
 struct EdgeInfo
 {
     int to;
     double distance;
     double cost;
     double time;
+    int id;
+};
+
+// Immutable edge availability at one weather version, as published to query
+// threads. Closed edges are a bitset; `reason` holds each closed edge's
+// interned weather description (see DescriptionTable), 0 for open edges.
+struct EdgeState
+{
+    uint64_t version = 0;
+    vector<uint64_t> closedBits;
+    vector<uint16_t> reason;
+
+    bool isOpen(int id) const { return !((closedBits[id >> 6] >> (id & 63)) & 1); }
+
+    // FNV-1a over the closed set, to key structures that depend only on it.
+    uint64_t closureHash() const
+    {
+        uint64_t h = 1469598103934665603ull;
+        for (uint64_t word : closedBits)
+        h = (h ^ word) * 1099511628211ull;
+        return h;
+    }
 };
 
 struct FlightGraph
 {
     vector<Airport> airports;
     vector<vector<EdgeInfo>> adj;
-    vector<vector<bool>> pathAvailable;
-    vector<vector<WeatherCondition>> pathWeather;
+    vector<pair<int, int>> edgeEnds;
+    vector<char> edgeAvailable;
+    vector<WeatherCondition> edgeWeather;
+    GeoPoints geo;
+    GeoIndex spatialIndex;
+    vector<UnitVector> edgeNormals;
+    EdgeCellTable edgeCells;
+    // Latest feed reports (see applyWeatherEvents) and per-batch scratch.
+    vector<WeatherMain> airportReport, edgeReport;
+    vector<uint32_t> touchedStamp;
+    vector<int> touched;
+    uint32_t touchRound = 0;
+    vector<EdgePenalty> edgePenalty;
+    // Signed fare change per direction (arc 2e: first->second end of edge e,
+    // 2e+1 the reverse); negative for credits and repositioning rebates.
+    vector<float> fareAdjustment;
+    // Seats still available per direction (same arc numbering).
+    static constexpr int DefaultSeats = 180;
+    vector<int> arcSeats;
 
     void addAirport(const string &code, float x, float y, double lat, double lon)
     {
         airports.push_back({code, "Unknown", sf::Vector2f(x, y), lat, lon});
         adj.emplace_back();
-
-        for (auto &row : pathAvailable)
-        row.push_back(false);
-        pathAvailable.push_back(vector<bool>(airports.size(), false));
-
-        for (auto &row : pathWeather)
-        row.push_back({false, "Clear"});
-        pathWeather.push_back(vector<WeatherCondition>(airports.size(), {false, "Clear"}));
+        geo.add(lat, lon);
     }
 
     void addEdge(int u, int v, double dist, double cost, double time)
     {
-        adj[u].push_back({v, dist, cost, time});
-        adj[v].push_back({u, dist, cost, time});
-        pathAvailable[u][v] = true;
-        pathAvailable[v][u] = true;
-        pathWeather[u][v] = {false, "Clear"};
-        pathWeather[v][u] = {false, "Clear"};
+        int id = edgeEnds.size();
+        adj[u].push_back({v, dist, cost, time, id});
+        adj[v].push_back({u, dist, cost, time, id});
+        edgeEnds.push_back({u, v});
+        edgeAvailable.push_back(true);
+        edgeWeather.push_back({false, "Clear"});
+        edgePenalty.push_back({});
+        fareAdjustment.push_back(0);
+        fareAdjustment.push_back(0);
+        arcSeats.push_back(DefaultSeats);
+        arcSeats.push_back(DefaultSeats);
     }
 
     void updateWeather(int u, int v, bool isBad, const string &description)
     {
-        pathWeather[u][v] = {isBad, description};
-        pathWeather[v][u] = {isBad, description};
-        pathAvailable[u][v] = !isBad;
-        pathAvailable[v][u] = !isBad;
+        const EdgeInfo *e = findEdge(u, v);
+        if (!e)
+        return;
+        edgeWeather[e->id] = {isBad, description};
+        edgeAvailable[e->id] = !isBad;
+    }
+
+    void setPenalty(int u, int v, float minutes, float cost)
+    {
+        const EdgeInfo *e = findEdge(u, v);
+        if (e)
+        edgePenalty[e->id] = {minutes, cost};
+    }
+
+    // Adjusts the fare for flying u->v only.
+    void setFareAdjustment(int u, int v, float amount)
+    {
+        const EdgeInfo *e = findEdge(u, v);
+        if (e)
+        fareAdjustment[arcOf(u, *e)] = amount;
+    }
+
+    void setSeats(int u, int v, int seats)
+    {
+        const EdgeInfo *e = findEdge(u, v);
+        if (e)
+        arcSeats[arcOf(u, *e)] = max(0, seats);
+    }
+
+    uint32_t arcOf(int from, const EdgeInfo &e) const
+    {
+        return 2 * static_cast<uint32_t>(e.id) + (edgeEnds[e.id].first == from ? 0 : 1);
+    }
+
+    // Live signed fare of one arc.
+    double arcFare(uint32_t arc) const
+    {
+        int id = arc / 2;
+        if (!edgeAvailable[id])
+        return JohnsonReweighting::Inf;
+        return findEdge(edgeEnds[id].first, edgeEnds[id].second)->cost + fareAdjustment[arc];
+    }
+
+    // Signed per-arc fares (cost plus adjustment), infinite where closed.
+    void arcFares(const EdgeState *state, vector<double> &out) const
+    {
+        out.resize(edgeEnds.size() * 2);
+        for (size_t u = 0; u < adj.size(); ++u)
+        {
+            for (const auto &e : adj[u])
+            {
+                bool open = state ? state->isOpen(e.id) : edgeAvailable[e.id] != 0;
+                uint32_t arc = arcOf(u, e);
+                out[arc] = open ? e.cost + fareAdjustment[arc] : JohnsonReweighting::Inf;
+            }
+        }
+    }
+
+    // Per-edge weights for a CCH customization: the metric plus any weather
+    // penalty, infinite where `state` (or the live flags) has the edge closed.
+    void edgeWeights(const string &metric, const EdgeState *state, vector<double> &out, bool withPenalties = true) const
+    {
+        out.resize(edgeEnds.size());
+        for (size_t u = 0; u < adj.size(); ++u)
+        {
+            for (const auto &e : adj[u])
+            {
+                if (e.to < static_cast<int>(u))
+                continue;
+                bool open = state ? state->isOpen(e.id) : edgeAvailable[e.id] != 0;
+                double w = metric == "distance" ? e.distance
+                         : metric == "cost"     ? e.cost + (withPenalties ? edgePenalty[e.id].cost : 0)
+                                                : e.time + (withPenalties ? edgePenalty[e.id].minutes : 0);
+                out[e.id] = open ? w : CustomizableCH::Inf;
+            }
+        }
+    }
+
+    // Regions for arc-flags: 2^levels equal-sized coordinate cells.
+    vector<int> partitionRegions(int levels) const
+    {
+        vector<double> lon(airports.size()), lat(airports.size());
+        for (size_t i = 0; i < airports.size(); ++i)
+        {
+            lon[i] = airports[i].longitude * cos(airports[i].latitude * M_PI / 180.0);
+            lat[i] = airports[i].latitude;
+        }
+        return partitionByCoordinates(lon, lat, levels);
+    }
+
+    // Arc-flags for plain (penalty-free) searches over `state`'s closures.
+    ArcFlags buildArcFlags(const vector<int> &regions, const string &metric, const EdgeState &state, int threads) const
+    {
+        vector<double> weights;
+        edgeWeights(metric, &state, weights, false);
+        return ArcFlags(regions, edgeEnds, weights, threads);
+    }
+
+    // Nested-dissection order, least important airport first.
+    vector<int> hierarchyOrder() const
+    {
+        vector<double> lon(airports.size()), lat(airports.size());
+        for (size_t i = 0; i < airports.size(); ++i)
+        {
+            lon[i] = airports[i].longitude * cos(airports[i].latitude * M_PI / 180.0);
+            lat[i] = airports[i].latitude;
+        }
+        return nestedDissectionOrder(airports.size(), edgeEnds, lon, lat);
+    }
+
+    // Metric-independent hierarchy; customize it with edgeWeights.
+    CustomizableCH buildHierarchy() const
+    {
+        return CustomizableCH(airports.size(), edgeEnds, hierarchyOrder());
+    }
+
+    // Hub labels for plain (penalty-free) distances over `state`'s closures.
+    HubLabels buildHubLabels(const string &metric, const EdgeState &state, const vector<int> &order) const
+    {
+        vector<double> weights;
+        edgeWeights(metric, &state, weights, false);
+        HubLabels labels;
+        labels.build(airports.size(), edgeEnds, weights, order);
+        return labels;
+    }
+
+    // FNV-1a over the segment ends and the weights buildHubLabels uses, so a
+    // saved label set is only reused for the same network and closures.
+    uint64_t labelsKey(const string &metric, const EdgeState &state) const
+    {
+        vector<double> weights;
+        edgeWeights(metric, &state, weights, false);
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&h](uint64_t word)
+        { h = (h ^ word) * 1099511628211ull; };
+        for (size_t i = 0; i < edgeEnds.size(); ++i)
+        {
+            uint64_t bits;
+            memcpy(&bits, &weights[i], sizeof(bits));
+            mix(static_cast<uint64_t>(edgeEnds[i].first) << 32 | static_cast<uint32_t>(edgeEnds[i].second));
+            mix(bits);
+        }
+        return h;
+    }
+
+    bool isBadSegment(int u, int v) const
+    {
+        const EdgeInfo *e = findEdge(u, v);
+        return e && edgeWeather[e->id].isBad;
+    }
+
+    void openAllEdges()
+    {
+        fill(edgeAvailable.begin(), edgeAvailable.end(), true);
+    }
+
+    // Snapshot of the current flags. With a base and the ids changed since
+    // it was taken, only those edges are re-read; otherwise all of them are.
+    unique_ptr<EdgeState> snapshotEdgeState(uint64_t version, const EdgeState *base = nullptr, const vector<int> *changed = nullptr) const
+    {
+        unique_ptr<EdgeState> state(base && changed ? new EdgeState(*base) : new EdgeState());
+        state->version = version;
+        auto refresh = [&](int id)
+        {
+            uint64_t bit = 1ull << (id & 63);
+            if (edgeAvailable[id])
+            state->closedBits[id >> 6] &= ~bit;
+            else
+            state->closedBits[id >> 6] |= bit;
+            // Only closures are ever explained, so only they pay for interning.
+            state->reason[id] = edgeAvailable[id] ? 0 : DescriptionTable::instance().intern(edgeWeather[id].description);
+        };
+        if (base && changed)
+        {
+            for (int id : *changed)
+            refresh(id);
+            return state;
+        }
+        state->closedBits.assign((edgeEnds.size() + 63) / 64, 0);
+        state->reason.assign(edgeEnds.size(), 0);
+        for (size_t id = 0; id < edgeEnds.size(); ++id)
+        refresh(static_cast<int>(id));
+        return state;
+    }
+
+    // Closes every edge whose great-circle track crosses a storm cell and
+    // reopens the rest. Ids of edges whose weather changed are appended to
+    // `changed`, so one call is the whole batch of updates for a time step.
+    void applyStorms(const StormSnapshot &storms, vector<int> &changed)
+    {
+        if (edgeNormals.size() != edgeEnds.size())
+        {
+            edgeNormals.resize(edgeEnds.size());
+            for (size_t id = 0; id < edgeEnds.size(); ++id)
+            edgeNormals[id] = arcNormal(geo.at(edgeEnds[id].first), geo.at(edgeEnds[id].second));
+        }
+        for (size_t id = 0; id < edgeEnds.size(); ++id)
+        {
+            int cell = storms.cellOnArc(geo.at(edgeEnds[id].first), geo.at(edgeEnds[id].second), edgeNormals[id]);
+            const char *description = cell >= 0 ? stormKindName(storms.kind[cell]) : "Clear";
+            WeatherCondition &w = edgeWeather[id];
+            if (w.isBad == (cell >= 0) && w.description == description)
+            continue;
+            w = {cell >= 0, description};
+            edgeAvailable[id] = cell < 0;
+            changed.push_back(static_cast<int>(id));
+        }
+    }
+
+    // Applies one coalesced batch from a WeatherFeed. Airport reports cover
+    // every edge touching the airport and edge reports cover just that edge;
+    // an edge is closed while any of its three reports is bad. Only edges a
+    // batch touches are re-evaluated, and those whose state changed are
+    // appended to `changed`.
+    void applyWeatherEvents(const vector<WeatherEvent> &events, vector<int> &changed)
+    {
+        airportReport.resize(airports.size(), WeatherMain::Clear);
+        edgeReport.resize(edgeEnds.size(), WeatherMain::Clear);
+        touchedStamp.resize(edgeEnds.size(), 0);
+        ++touchRound;
+        touched.clear();
+        auto touch = [&](int id)
+        {
+            if (touchedStamp[id] == touchRound)
+            return;
+            touchedStamp[id] = touchRound;
+            touched.push_back(id);
+        };
+        for (const auto &ev : events)
+        {
+            if (ev.edge >= 0)
+            {
+                edgeReport[ev.edge] = ev.condition;
+                touch(ev.edge);
+            }
+            else
+            {
+                airportReport[ev.airport] = ev.condition;
+                for (const auto &e : adj[ev.airport])
+                touch(e.id);
+            }
+        }
+        for (int id : touched)
+        {
+            auto [u, v] = edgeEnds[id];
+            // The reason is compared in place so unchanged edges cost no allocation.
+            const string *condition = nullptr, *at = nullptr;
+            if (isBadCondition(edgeReport[id]))
+            condition = &weatherMainName(edgeReport[id]);
+            else if (isBadCondition(airportReport[u]))
+            condition = &weatherMainName(airportReport[u]), at = &airports[u].code;
+            else if (isBadCondition(airportReport[v]))
+            condition = &weatherMainName(airportReport[v]), at = &airports[v].code;
+            bool bad = condition != nullptr;
+            WeatherCondition &w = edgeWeather[id];
+            auto same = [&]()
+            {
+                if (!bad)
+                return w.description == "Clear";
+                if (!at)
+                return w.description == *condition;
+                return w.description.size() == condition->size() + 4 + at->size() && w.description.compare(0, condition->size(), *condition) == 0 &&
+                       w.description.compare(condition->size() + 4, string::npos, *at) == 0;
+            };
+            if (w.isBad == bad && same())
+            continue;
+            w = {bad, !bad ? string("Clear") : at ? *condition + " at " + *at : *condition};
+            edgeAvailable[id] = !bad;
+            changed.push_back(id);
+        }
+    }
+
+    // Must be called once all airports are added; until then spatial queries fall back to a linear scan.
+    void buildSpatialIndex()
+    {
+        spatialIndex.build(geo);
+    }
+
+    // Connects every pair of airports within radiusKm, plus each airport's
+    // minNeighbors nearest ones so sparse regions stay connected. Candidate
+    // pairs come from the spatial index, so this is O(n log n + edges).
+    void connectNearby(double radiusKm, size_t minNeighbors, unsigned seed)
+    {
+        buildSpatialIndex();
+        mt19937 gen(seed);
+        uniform_int_distribution<int> costDist(100, 299);
+        int n = airports.size();
+        vector<int> candidates, nearest;
+        vector<int> linked(n, -1);
+        for (int u = 0; u < n; ++u)
+        {
+            candidates.clear();
+            spatialIndex.within(geo.at(u), radiusKm, candidates);
+            spatialIndex.nearest(geo.at(u), minNeighbors, nearest, u);
+            candidates.insert(candidates.end(), nearest.begin(), nearest.end());
+            for (const auto &e : adj[u])
+            linked[e.to] = u;
+            for (int v : candidates)
+            {
+                if (v == u || linked[v] == u)
+                continue;
+                linked[v] = u;
+                sf::Vector2f d = airports[u].position - airports[v].position;
+                double km = geo.distanceKm(u, v);
+                addEdge(u, v, sqrt(d.x * d.x + d.y * d.y), costDist(gen), max(10.0, km / cruiseSpeedKmh * 60.0));
+            }
+        }
+    }
+
+    // Built once per load: the weather raster cells under every edge.
+    void buildEdgeCells(const WeatherGrid &grid)
+    {
+        edgeCells = EdgeCellTable();
+        for (const auto &ends : edgeEnds)
+        edgeCells.addEdge(grid, geo.at(ends.first), geo.at(ends.second));
+    }
+
+    bool hasEdgeCells() const
+    {
+        return !edgeEnds.empty() && edgeCells.edges() == edgeEnds.size();
+    }
+
+    // First bad condition along edge `id` in a grid slice, Clear if none.
+    WeatherMain weatherAlong(const WeatherGrid &grid, int slice, int id) const
+    {
+        for (uint32_t k = edgeCells.offsets[id]; k < edgeCells.offsets[id + 1]; ++k)
+        {
+            WeatherMain m = grid.at(slice, edgeCells.cells[k]);
+            if (isBadCondition(m))
+            return m;
+        }
+        return WeatherMain::Clear;
+    }
+
+    // Closes every still-open edge whose track crosses bad cells in `slice`.
+    // Edges already closed (e.g. by airport forecasts) keep their reason.
+    void closeEdgesCrossing(const WeatherGrid &grid, int slice, vector<int> &changed)
+    {
+        static thread_local vector<int32_t> mask, scratch;
+        static thread_local vector<uint8_t> crossing;
+        grid.badMask(slice, mask);
+        edgeCells.crossing(mask, crossing, scratch);
+        for (size_t id = 0; id < crossing.size(); ++id)
+        {
+            if (!crossing[id] || edgeWeather[id].isBad)
+            continue;
+            edgeWeather[id] = {true, weatherMainName(weatherAlong(grid, slice, static_cast<int>(id))) + " en route"};
+            edgeAvailable[id] = false;
+            changed.push_back(static_cast<int>(id));
+        }
+    }
+
+    const EdgeInfo *findEdge(int u, int v) const
+    {
+        for (const auto &e : adj[u])
+        {
+            if (e.to == v)
+            return &e;
+        }
+        return nullptr;
+    }
+
+    int nearestAirport(double lat, double lon, int skip = -1) const
+    {
+        if (spatialIndex.size() != airports.size())
+        return geo.nearest(unitVector(lat, lon), skip);
+        vector<int> result;
+        spatialIndex.nearest(unitVector(lat, lon), 1, result, skip);
+        return result.empty() ? -1 : result[0];
+    }
+
+    vector<int> airportsWithin(int airport, double radiusKm) const
+    {
+        vector<int> result;
+        if (spatialIndex.size() != airports.size())
+        geo.within(geo.at(airport), radiusKm, result);
+        else
+        spatialIndex.within(geo.at(airport), radiusKm, result);
+        result.erase(remove(result.begin(), result.end(), airport), result.end());
+        return result;
+    }
+
+    // Airports within radiusKm of `airport` that could take a diversion,
+    // nearest first. isClosed marks airports that cannot accept traffic.
+    vector<pair<int, double>> diversionCandidates(int airport, double radiusKm, const function<bool(int)> &isClosed, size_t limit = 5) const
+    {
+        vector<pair<int, double>> result;
+        for (int v : airportsWithin(airport, radiusKm))
+        {
+            if (!isClosed || !isClosed(v))
+            result.push_back({v, geo.distanceKm(airport, v)});
+        }
+        sort(result.begin(), result.end(), [](const auto &a, const auto &b)
+             { return a.second < b.second; });
+        if (result.size() > limit)
+        result.resize(limit);
+        return result;
     }
 
     bool hasBadWeather(const vector<int> &path) const
     {
-        for (size_t i = 0; i < path.size() - 1; ++i)
+        for (size_t i = 0; i + 1 < path.size(); ++i)
         {
             int u = path[i];
             int v = path[i + 1];
-            if (pathWeather[u][v].isBad)
+            if (isBadSegment(u, v))
             {
                 return true;
             }
@@ -107,22 +598,87 @@ struct FlightGraph
         return false;
     }
 
+    // Segments of `path` closed in `state`, with the reason it recorded.
+    vector<pair<string, string>> closuresAlong(const vector<int> &path, const EdgeState &state) const
+    {
+        vector<pair<string, string>> result;
+        for (size_t i = 0; i + 1 < path.size(); ++i)
+        {
+            const EdgeInfo *e = findEdge(path[i], path[i + 1]);
+            if (e && !state.isOpen(e->id))
+            result.push_back({airports[path[i]].code + "-" + airports[path[i + 1]].code, DescriptionTable::instance().text(state.reason[e->id])});
+        }
+        return result;
+    }
+
     vector<pair<string, string>> getPathWeatherInfo(const vector<int> &path) const
     {
         vector<pair<string, string>> result;
-        for (size_t i = 0; i < path.size() - 1; ++i)
+        for (size_t i = 0; i + 1 < path.size(); ++i)
         {
             int u = path[i];
             int v = path[i + 1];
-            if (pathWeather[u][v].isBad)
+            const EdgeInfo *e = findEdge(u, v);
+            if (e && edgeWeather[e->id].isBad)
             {
-                result.push_back({airports[u].code + "-" + airports[v].code, pathWeather[u][v].description});
+                result.push_back({airports[u].code + "-" + airports[v].code, edgeWeather[e->id].description});
             }
         }
         return result;
     }
 
     vector<int> dijkstra(int src, int dst, vector<pair<int, int>> &exploredEdges, const string &metric = "distance") const
+    {
+        return dijkstraWith(src, dst, exploredEdges, metric, [this](int, const EdgeInfo &e)
+                            { return edgeAvailable[e.id] != 0; });
+    }
+
+    vector<int> dijkstra(int src,int dst, const string &metric = "distance") const
+    {
+        vector<pair<int, int>> dummy;
+        return dijkstra(src, dst, dummy, metric);
+    }
+
+    // Same search against a published snapshot instead of the live flags, so
+    // it is safe while a writer updates the graph's weather. With arc-flags
+    // computed for this snapshot's closures, only arcs flagged for dst's
+    // region are scanned.
+    vector<int> dijkstra(int src, int dst, const EdgeState &state, const string &metric = "distance", const ArcFlags *flags = nullptr) const
+    {
+        vector<pair<int, int>> dummy;
+        return dijkstra(src, dst, state, dummy, metric, flags);
+    }
+
+    vector<int> dijkstra(int src, int dst, const EdgeState &state, vector<pair<int, int>> &exploredEdges, const string &metric,
+                         const ArcFlags *flags) const
+    {
+        if (!flags || flags->empty())
+        return dijkstraWith(src, dst, exploredEdges, metric, [&state](int, const EdgeInfo &e)
+                            { return state.isOpen(e.id); });
+        uint32_t mask = flags->targetMask(dst);
+        return dijkstraWith(src, dst, exploredEdges, metric, [&, mask](int u, const EdgeInfo &e)
+                            { return state.isOpen(e.id) && flags->allows(e.id, edgeEnds[e.id].first == u, mask); });
+    }
+
+    template <typename IsOpen>
+    vector<int> dijkstraWith(int src, int dst, vector<pair<int, int>> &exploredEdges, const string &metric, IsOpen isOpen) const
+    {
+        return dijkstraBy(src, dst, exploredEdges, [&metric](int, const EdgeInfo &e)
+                          { return (metric == "distance") ? e.distance : (metric == "cost") ? e.cost : e.time; }, isOpen);
+    }
+
+    // Signed fares through Johnson reweighting: a plain Dijkstra over the
+    // reduced arc weights, whose shortest paths are the real ones.
+    vector<int> dijkstraReweighted(int src, int dst, const JohnsonReweighting &fares, vector<pair<int, int>> &exploredEdges) const
+    {
+        return dijkstraBy(src, dst, exploredEdges, [&](int u, const EdgeInfo &e)
+                          { return fares.reduced(arcOf(u, e)); }, [&](int u, const EdgeInfo &e)
+                          { return fares.reduced(arcOf(u, e)) != JohnsonReweighting::Inf; });
+    }
+
+    // Dijkstra with `weight(u, e)` for the arc u->e.to; weights must be >= 0.
+    template <typename Weight, typename IsOpen>
+    vector<int> dijkstraBy(int src, int dst, vector<pair<int, int>> &exploredEdges, Weight weight, IsOpen isOpen) const
     {
         int n = adj.size();
         vector<double> dist(n, numeric_limits<double>::infinity());
@@ -139,11 +695,10 @@ struct FlightGraph
             break;
             for (const auto &e : adj[u])
             {
-                if (!pathAvailable[u][e.to])
+                if (!isOpen(u, e))
                 continue;
                 exploredEdges.push_back({u, e.to});
-                double w = (metric == "distance") ? e.distance : (metric == "cost") ? e.cost : e.time;
-                double alt = d + w;
+                double alt = d + weight(u, e);
                 if (alt < dist[e.to])
                 {
                     dist[e.to] = alt;
@@ -161,12 +716,6 @@ struct FlightGraph
         return path;
     }
 
-    vector<int> dijkstra(int src,int dst, const string &metric = "distance") const
-    {
-        vector<pair<int, int>> dummy;
-        return dijkstra(src, dst, dummy, metric);
-    }
-
     vector<int> findRouteWithWeatherRerouting(int src, int dst, bool &rerouted)
     {
         vector<int> originalPath = dijkstra(src, dst);
@@ -178,37 +727,131 @@ struct FlightGraph
 
         rerouted = true;
 
-        FlightGraph tempGraph = *this;
-
+        vector<char> avoid(edgeEnds.size(), 0);
         for (size_t i = 0; i < originalPath.size() - 1; ++i)
         {
-            int u = originalPath[i];
-            int v = originalPath[i + 1];
-            if (pathWeather[u][v].isBad)
-            {
+            const EdgeInfo *e = findEdge(originalPath[i], originalPath[i + 1]);
+            if (e && edgeWeather[e->id].isBad)
+            avoid[e->id] = 1;
+        }
+        vector<pair<int, int>> dummy;
+        return dijkstraWith(src, dst, dummy, "distance", [&](int, const EdgeInfo &e)
+                            { return edgeAvailable[e.id] && !avoid[e.id]; });
+    }
+
+    // Route minimizing `minimize` whose total `limit` stays within `budget`
+    // (fastest within a fare, cheapest within a block time) over `state`.
+    ConstrainedRouter::Result constrainedRoute(ConstrainedRouter &router, int src, int dst, const string &minimize, const string &limit, double budget,
+                                               const EdgeState &state) const
+    {
+        vector<double> primary, resource;
+        edgeWeights(minimize, &state, primary, false);
+        edgeWeights(limit, &state, resource, false);
+        return router.route(src, dst, primary, resource, budget);
+    }
+
+    // Cheapest pair of src-dst routes sharing no segment (no intermediate
+    // airport when `airportDisjoint`) over `state`.
+    DisjointPair disjointRoutes(const DisjointPaths &engine, int src, int dst, const EdgeState &state, const string &metric = "distance",
+                                bool airportDisjoint = false) const
+    {
+        vector<double> weights;
+        edgeWeights(metric, &state, weights, false);
+        return engine.route(src, dst, weights, airportDisjoint);
+    }
+
+    // The same for a batch of itineraries, spread over `threads`.
+    vector<DisjointPair> disjointRoutes(const DisjointPaths &engine, const vector<pair<int, int>> &itineraries, const EdgeState &state,
+                                        const string &metric, bool airportDisjoint, int threads) const
+    {
+        vector<double> weights;
+        edgeWeights(metric, &state, weights, false);
+        return engine.routeAll(itineraries, weights, airportDisjoint, threads);
+    }
+
+    // Seats for `demands` on the flights open in `state`, each passenger
+    // routed as cheaply by `metric` as the remaining seats allow.
+    FlowAssignment assignPassengers(const PassengerFlow &engine, const vector<PassengerDemand> &demands, const EdgeState &state, const string &metric,
+                                    int rounds = 4) const
+    {
+        vector<double> weights, arcCost(edgeEnds.size() * 2);
+        edgeWeights(metric, &state, weights);
+        for (size_t e = 0; e < edgeEnds.size(); ++e)
+        arcCost[2 * e] = arcCost[2 * e + 1] = weights[e];
+        return engine.assign(demands, arcCost, arcSeats, rounds);
+    }
+
+    // Shortest src-dst path under the current availability plus, for each of
+    // its segments, the best route avoiding that segment.
+    ReplacementPaths replacementPaths(int src, int dst, const string &metric) const
+    {
+        vector<double> weights;
+        edgeWeights(metric, nullptr, weights, false);
+        return computeReplacementPaths(airports.size(), edgeEnds, weights, src, dst);
+    }
+
+    vector<int> astar(int src, int dst, const string &metric = "distance") const
+    {
+        vector<pair<int, int>> dummy;
+        return astarWith(src, dst, dummy, metric, [this](int, const EdgeInfo &e)
+                         { return edgeAvailable[e.id] != 0; });
+    }
+
+    vector<int> astar(int src, int dst, const EdgeState &state, const string &metric = "distance", const ArcFlags *flags = nullptr) const
+    {
+        vector<pair<int, int>> dummy;
+        return astar(src, dst, state, dummy, metric, flags);
+    }
+
+    vector<int> astar(int src, int dst, const EdgeState &state, vector<pair<int, int>> &exploredEdges, const string &metric,
+                      const ArcFlags *flags) const
+    {
+        if (!flags || flags->empty())
+        return astarWith(src, dst, exploredEdges, metric, [&state](int, const EdgeInfo &e)
+                         { return state.isOpen(e.id); });
+        uint32_t mask = flags->targetMask(dst);
+        return astarWith(src, dst, exploredEdges, metric, [&, mask](int u, const EdgeInfo &e)
+                         { return state.isOpen(e.id) && flags->allows(e.id, edgeEnds[e.id].first == u, mask); });
+    }
 
-                tempGraph.pathAvailable[u][v] = false;
-                tempGraph.pathAvailable[v][u] = false;
+    // Admissible estimate of `metric` from every airport to dst (0 for cost,
+    // which has no geometric lower bound).
+    vector<double> heuristicTo(int dst, const string &metric) const
+    {
+        int n = airports.size();
+        vector<double> h(n, 0.0);
+        if (metric == "time")
+        {
+            // Segment durations are great-circle km at cruise speed (never less),
+            // so the straight-line flying time to dst is an admissible bound.
+            geo.distancesKm(dst, h);
+            for (double &km : h)
+            km = km / cruiseSpeedKmh * 60.0;
+        }
+        else if (metric == "distance")
+        {
+            sf::Vector2f pb = airports[dst].position;
+            for (int a = 0; a < n; ++a)
+            {
+                sf::Vector2f pa = airports[a].position;
+                h[a] = sqrt((pa.x - pb.x) * (pa.x - pb.x) + (pa.y - pb.y) * (pa.y - pb.y));
             }
         }
-        return tempGraph.dijkstra(src, dst);
+        return h;
     }
 
-    vector<int> astar(int src, int dst) const
+    template <typename IsOpen>
+    vector<int> astarWith(int src, int dst, vector<pair<int, int>> &exploredEdges, const string &metric, IsOpen isOpen) const
     {
         int n = airports.size();
         vector<double> gScore(n, numeric_limits<double>::infinity());
         vector<double> fScore(n, numeric_limits<double>::infinity());
         vector<int> prev(n, -1);
-        auto heuristic = [&](int a, int b)
-        {
-            sf::Vector2f pa = airports[a].position;
-            sf::Vector2f pb = airports[b].position;
-            return sqrt((pa.x - pb.x) * (pa.x - pb.x) + (pa.y - pb.y) * (pa.y - pb.y));
-        };
+
+        vector<double> h = heuristicTo(dst, metric);
 
         gScore[src] = 0;
-        fScore[src] = heuristic(src, dst);
+        fScore[src] = h[src];
 
         set<pair<double, int>> openSet;
         openSet.insert(make_pair(fScore[src], src));
@@ -222,15 +865,17 @@ struct FlightGraph
 
             for (const auto &e : adj[u])
             {
-                if (!pathAvailable[u][e.to])
+                if (!isOpen(u, e))
                 continue;
-                double tentative = gScore[u] + e.distance;
+                exploredEdges.push_back({u, e.to});
+                double w = (metric == "distance") ? e.distance : (metric == "cost") ? e.cost : e.time;
+                double tentative = gScore[u] + w;
                 if (tentative < gScore[e.to])
                 {
                     openSet.erase(make_pair(fScore[e.to], e.to));
                     prev[e.to] = u;
                     gScore[e.to] = tentative;
-                    fScore[e.to] = tentative + heuristic(e.to, dst);
+                    fScore[e.to] = tentative + h[e.to];
                     openSet.insert(make_pair(fScore[e.to], e.to));
                 }
                 
@@ -246,39 +891,297 @@ struct FlightGraph
         return path;
     }
 
-    vector<int> bellmanFord(int src, int dst) const
+    // Best routes with at most 1..maxLegs legs (routes[k - 1] for k legs,
+    // empty when none), all from one run. Round k is a Bellman-Ford pass that
+    // only relaxes arcs out of airports whose distance improved in round k-1,
+    // reading last round's distances and writing this round's, so no route
+    // gains two legs in one round.
+    vector<vector<int>> hopLimitedRoutes(int src, int dst, int maxLegs, const EdgeState &state, const string &metric = "distance") const
     {
         int n = adj.size();
-        vector<double> dist(n, numeric_limits<double>::infinity());
-        vector<int> prev(n, -1);
-        dist[src] = 0;
-
-        for (int i = 0; i < n - 1; ++i)
+        const double inf = numeric_limits<double>::infinity();
+        vector<double> last(n, inf), current(n, inf);
+        last[src] = current[src] = 0;
+        // via[k][v]: predecessor that improved v in round k, -1 if it did not.
+        vector<vector<int>> via(maxLegs + 1, vector<int>(n, -1));
+        vector<int> frontier = {src}, improved, stamp(n, 0);
+        vector<vector<int>> routes(maxLegs);
+        const bool byDistance = metric == "distance", byCost = metric == "cost";
+        for (int k = 1; k <= maxLegs && !frontier.empty(); ++k)
         {
-            for (int u = 0; u < n; ++u)
+            for (int u : frontier)
             {
                 for (const auto &e : adj[u])
                 {
-                    int v = e.to;
-                    double w = e.distance;
-                    if (!pathAvailable[u][v])
+                    if (!state.isOpen(e.id))
                     continue;
-                    if (dist[u] != numeric_limits<double>::infinity() && dist[u] + w < dist[v])
+                    double w = byDistance ? e.distance : byCost ? e.cost : e.time;
+                    if (last[u] + w < current[e.to])
                     {
-                        dist[v] = dist[u] + w;
-                        prev[v] = u;
+                        current[e.to] = last[u] + w;
+                        via[k][e.to] = u;
+                        if (stamp[e.to] != k)
+                        {
+                            stamp[e.to] = k;
+                            improved.push_back(e.to);
+                        }
                     }
                 }
             }
-        }
+            for (int v : improved)
+            last[v] = current[v];
+            frontier.swap(improved);
+            improved.clear();
 
-        for (int u = 0; u < n; ++u)
+            if (current[dst] == inf)
+            continue;
+            vector<int> &path = routes[k - 1];
+            for (int at = dst, layer = k; layer > 0;)
+            {
+                if (via[layer][at] < 0)
+                {
+                    --layer;
+                    continue;
+                }
+                path.push_back(at);
+                at = via[layer--][at];
+            }
+            path.push_back(src);
+            reverse(path.begin(), path.end());
+        }
+        for (int k = 1; k < maxLegs; ++k)
+        if (routes[k].empty() && !routes[k - 1].empty())
+        routes[k] = routes[k - 1];
+        return routes;
+    }
+
+    struct MultiRoute
+    {
+        vector<int> path; // chosen source .. chosen target, empty when none is reachable
+        int source = -1, target = -1;
+        double value = numeric_limits<double>::infinity(); // access + route + egress
+        size_t settled = 0;
+    };
+
+    // Best route from any of `sources` to any of `targets`, each an (airport,
+    // access cost) pair in `metric` units, in one search: every source is
+    // seeded at its access cost, and the search stops once no unsettled
+    // airport can beat the best target reached plus its egress cost, which
+    // with no egress costs is the first target settled.
+    MultiRoute multiRoute(const vector<pair<int, double>> &sources, const vector<pair<int, double>> &targets, const EdgeState &state,
+                          const string &metric = "distance") const
+    {
+        int n = adj.size();
+        const double inf = numeric_limits<double>::infinity();
+        vector<double> dist(n, inf), egress(n, inf);
+        vector<int> prev(n, -1);
+        for (const auto &[t, cost] : targets)
+        egress[t] = min(egress[t], cost);
+        using PDI = pair<double, int>;
+        priority_queue<PDI, vector<PDI>, greater<>> pq;
+        for (const auto &[s, cost] : sources)
+        {
+            if (cost < dist[s])
+            {
+                dist[s] = cost;
+                pq.push({cost, s});
+            }
+        }
+        const bool byDistance = metric == "distance", byCost = metric == "cost";
+        MultiRoute result;
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > dist[u])
+            continue;
+            if (d >= result.value)
+            break;
+            ++result.settled;
+            if (d + egress[u] < result.value)
+            {
+                result.value = d + egress[u];
+                result.target = u;
+            }
+            for (const auto &e : adj[u])
+            {
+                if (!state.isOpen(e.id))
+                continue;
+                double alt = d + (byDistance ? e.distance : byCost ? e.cost : e.time);
+                if (alt < dist[e.to])
+                {
+                    dist[e.to] = alt;
+                    prev[e.to] = u;
+                    pq.push({alt, e.to});
+                }
+            }
+        }
+        if (result.target < 0)
+        return result;
+        for (int at = result.target; at != -1; at = prev[at])
+        result.path.push_back(at);
+        reverse(result.path.begin(), result.path.end());
+        result.source = result.path.front();
+        return result;
+    }
+
+    // Every airport within `bound` of src by `metric` over `state`, with the
+    // predecessor tree; repeated calls on one thread reuse its workspace.
+    Isochrone isochrone(int src, double bound, const EdgeState &state, const string &metric = "time") const
+    {
+        const bool byDistance = metric == "distance", byCost = metric == "cost";
+        return BoundedSearch::local().run(adj.size(), src, bound, [&](int u, auto relax)
+                                          {
+            for (const auto &e : adj[u])
+            if (state.isOpen(e.id))
+            relax(e.to, byDistance ? e.distance : byCost ? e.cost : e.time); });
+    }
+
+    // A* that must answer by `deadline`: weighted A* with the weight falling
+    // to 1, reusing its search between weights (see anytime_search.h). The
+    // route returned is the best found in time, with its proven bound.
+    AnytimeRoute anytimeRoute(int src, int dst, const EdgeState &state, const string &metric, chrono::steady_clock::time_point deadline,
+                              double epsilon = 3.0) const
+    {
+        const bool byDistance = metric == "distance", byCost = metric == "cost";
+        // h per airport touched rather than for the whole network up front,
+        // so setup does not eat into the deadline.
+        const bool byTime = metric == "time";
+        auto h = [&, target = geo.at(dst), pb = airports[dst].position](int a)
+        {
+            if (byTime)
+            return greatCircleKm(geo.at(a), target) / cruiseSpeedKmh * 60.0;
+            if (!byDistance)
+            return 0.0;
+            sf::Vector2f pa = airports[a].position;
+            return static_cast<double>(sqrt((pa.x - pb.x) * (pa.x - pb.x) + (pa.y - pb.y) * (pa.y - pb.y)));
+        };
+        return anytimeAStar(adj.size(), src, dst, h, [&](int u, auto relax)
+                            {
+            for (const auto &e : adj[u])
+            if (state.isOpen(e.id))
+            relax(e.to, byDistance ? e.distance : byCost ? e.cost : e.time); }, deadline, epsilon);
+    }
+
+    // Round trip from stops[0] through every other stop, in the order that
+    // minimizes `metric` over `state`. Leg costs come from one Dijkstra per
+    // stop, run `threads` at a time, each stopping once every stop is
+    // settled; `path` gets the whole trip airport by airport.
+    TourPlan planItinerary(const vector<int> &stops, const EdgeState &state, const string &metric, vector<int> &path, int threads = 1) const
+    {
+        int n = adj.size(), k = stops.size();
+        const double inf = numeric_limits<double>::infinity();
+        vector<vector<double>> leg(k, vector<double>(k, inf));
+        vector<vector<int>> prev(k);
+        const bool byDistance = metric == "distance", byCost = metric == "cost";
+        auto search = [&](int i)
+        {
+            vector<double> dist(n, inf);
+            vector<int> &from = prev[i];
+            from.assign(n, -1);
+            vector<int> wanted(n, 0);
+            for (int stop : stops)
+            ++wanted[stop];
+            int remaining = k;
+            using PDI = pair<double, int>;
+            priority_queue<PDI, vector<PDI>, greater<>> pq;
+            dist[stops[i]] = 0;
+            pq.push({0, stops[i]});
+            while (!pq.empty() && remaining > 0)
+            {
+                auto [d, u] = pq.top();
+                pq.pop();
+                if (d > dist[u])
+                continue;
+                remaining -= wanted[u];
+                for (const auto &e : adj[u])
+                {
+                    if (!state.isOpen(e.id))
+                    continue;
+                    double alt = d + (byDistance ? e.distance : byCost ? e.cost : e.time);
+                    if (alt < dist[e.to])
+                    {
+                        dist[e.to] = alt;
+                        from[e.to] = u;
+                        pq.push({alt, e.to});
+                    }
+                }
+            }
+            for (int j = 0; j < k; ++j)
+            leg[i][j] = dist[stops[j]];
+        };
+        int searchers = max(1, min(threads, k));
+        vector<thread> pool;
+        for (int t = 1; t < searchers; ++t)
+        pool.emplace_back([&, t]
+                          { for (int i = t; i < k; i += searchers) search(i); });
+        for (int i = 0; i < k; i += searchers)
+        search(i);
+        for (auto &t : pool)
+        t.join();
+
+        TourPlan plan = planTour(leg, threads);
+        path.clear();
+        for (size_t i = 1; i < plan.order.size(); ++i)
+        {
+            int a = plan.order[i - 1], b = plan.order[i];
+            vector<int> hop;
+            for (int at = stops[b]; at != stops[a]; at = prev[a][at])
+            hop.push_back(at);
+            if (path.empty())
+            path.push_back(stops[a]);
+            path.insert(path.end(), hop.rbegin(), hop.rend());
+        }
+        return plan;
+    }
+
+    vector<int> bellmanFord(int src, int dst, const EdgeState &state, const string &metric = "distance") const
+    {
+        vector<double> arcWeight(edgeEnds.size() * 2);
+        for (size_t u = 0; u < adj.size(); ++u)
+        for (const auto &e : adj[u])
+        arcWeight[arcOf(u, e)] = !state.isOpen(e.id) ? numeric_limits<double>::infinity() : metric == "cost" ? e.cost : metric == "time" ? e.time : e.distance;
+        return bellmanFord(src, dst, arcWeight);
+    }
+
+    // Bellman-Ford over signed per-arc weights (see arcOf), infinite where closed.
+    vector<int> bellmanFord(int src, int dst, const vector<double> &arcWeight) const
+    {
+        int n = adj.size();
+        vector<double> dist(n, numeric_limits<double>::infinity());
+        vector<int> prev(n, -1);
+        dist[src] = 0;
+
+        // A pass that changes nothing means every later one would too.
+        bool changed = true;
+        for (int i = 0; i < n - 1 && changed; ++i)
+        {
+            changed = false;
+            for (int u = 0; u < n; ++u)
+            {
+                for (const auto &e : adj[u])
+                {
+                    int v = e.to;
+                    double w = arcWeight[arcOf(u, e)];
+                    if (w == numeric_limits<double>::infinity())
+                    continue;
+                    if (dist[u] != numeric_limits<double>::infinity() && dist[u] + w < dist[v])
+                    {
+                        dist[v] = dist[u] + w;
+                        prev[v] = u;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        for (int u = 0; u < n; ++u)
         {
             for (const auto &e : adj[u])
             {
                 int v = e.to;
-                double w = e.distance;
-                if (!pathAvailable[u][v])
+                double w = arcWeight[arcOf(u, e)];
+                if (w == numeric_limits<double>::infinity())
                 continue;
                 if (dist[u] != numeric_limits<double>::infinity() && dist[u] + w < dist[v])
                 {
@@ -403,7 +1306,7 @@ int resolveAirportIndex(const string &input, const vector<Airport> &airports)
     return -1;
 }
 
-void visualizeGraph(const FlightGraph &graph, const vector<int> &path, const vector<int> &originalPath, bool rerouted, const vector<pair<int, int>> &exploredEdges, const string &metrics, int src, int dst, double us, const std::string& bookedDate = "", const std::string& bookedTime = "")
+void visualizeGraph(const FlightGraph &graph, const vector<int> &path, const vector<int> &originalPath, bool rerouted, const vector<pair<int, int>> &exploredEdges, const string &metrics, int src, int dst, double us, const std::string& bookedDate = "", const std::string& bookedTime = "", const Isochrone *heat = nullptr)
 {
     sf::RenderWindow window(sf::VideoMode(1496, 1120), "Flight Path Visualization");
     window.setFramerateLimit(60);
@@ -674,6 +1577,33 @@ void visualizeGraph(const FlightGraph &graph, const vector<int> &path, const vec
         }
     }
 
+    // Heat overlay: reachable airports shaded green (near) to red (at the
+    // bound), joined along the predecessor tree.
+    sf::VertexArray heatTree(sf::Lines);
+    vector<sf::CircleShape> heatSpots;
+    if (heat)
+    {
+        auto shade = [&](double value, uint8_t alpha)
+        {
+            float t = heat->bound > 0 ? static_cast<float>(min(1.0, value / heat->bound)) : 0.0f;
+            return sf::Color(static_cast<uint8_t>(255 * min(1.0f, 2 * t)), static_cast<uint8_t>(255 * min(1.0f, 2 - 2 * t)), 40, alpha);
+        };
+        for (size_t i = 0; i < heat->airports.size(); ++i)
+        {
+            sf::Vector2f pos = graph.airports[heat->airports[i]].position;
+            sf::CircleShape spot(22);
+            spot.setOrigin(22, 22);
+            spot.setPosition(pos);
+            spot.setFillColor(shade(heat->value[i], 110));
+            heatSpots.push_back(spot);
+            if (heat->parent[i] >= 0)
+            {
+                heatTree.append(sf::Vertex(graph.airports[heat->parent[i]].position, shade(heat->value[i], 200)));
+                heatTree.append(sf::Vertex(pos, shade(heat->value[i], 200)));
+            }
+        }
+    }
+
     while (window.isOpen())
     {
         sf::Event event;
@@ -705,6 +1635,10 @@ void visualizeGraph(const FlightGraph &graph, const vector<int> &path, const vec
 
         window.clear();
         window.draw(mapSprite);
+        // Under the panels, so the overlay never covers the info texts.
+        window.draw(heatTree);
+        for (const auto &spot : heatSpots)
+        window.draw(spot);
         window.draw(controlPanel);
         window.draw(infoPanel);
         window.draw(controlText);
@@ -975,87 +1909,3161 @@ void visualizeGraph(const FlightGraph &graph, const vector<int> &path, const vec
 
         window.display();
     }
-}
+}
+
+string getWeatherDescription(double lat, double lon, const string &apiKey)
+{
+    WeatherResponse r = weatherProvider->fetchCurrent(lat, lon, apiKey).get();
+    WeatherRecord w;
+    if (r.status == 200 && parseCurrentRecord(r.text, w))
+    {
+        ostringstream oss;
+        oss << weatherMainName(w.main) << " (" << DescriptionTable::instance().text(w.description) << "), " << w.temp << " C";
+        return oss.str();
+    }
+    else
+    {
+        return "[Weather unavailable]";
+    }
+}
+
+string convertToAPIDate(const std::string &dateStr)
+{
+    int d, m, y;
+    char sep;
+    istringstream iss(dateStr);
+    iss >> d >> sep >> m >> sep >> y;
+    ostringstream oss;
+    oss << y << "-";
+    if (m < 10)
+    oss << "0";
+    oss << m << "-";
+    if (d < 10)
+    oss << "0";
+    oss << d;
+    return oss.str();
+}
+
+struct DetailedWeather
+{
+    string main;
+    string desc;
+    double temp;
+    int humidity;
+    double wind;
+};
+
+DetailedWeather forecastAt(const ForecastSeries &series, const string &date, const string &time)
+{
+    int i = series.closest(forecastQueryTime(date, time));
+    if (i >= 0)
+    return {series.main(i), series.desc(i), series.temp[i], series.humidity[i], series.wind[i]};
+    return {"--", "--", -1, -1, -1};
+}
+
+DetailedWeather forecastFor(const Airport &airport, const string &date, const string &time)
+{
+    return forecastAt(*forecastCache.get(airport.code, airport.latitude, airport.longitude, apiKey), date, time);
+}
+
+double haversine(double lat1, double lon1, double lat2, double lon2)
+{
+    const double R = 6371.0;
+    double dLat = (lat2 - lat1) * M_PI / 180.0;
+    double dLon = (lon2 - lon1) * M_PI / 180.0;
+    double a = sin(dLat / 2) * sin(dLat / 2) + cos(lat1 * M_PI / 180.0) * cos(lat2 * M_PI / 180.0) * sin(dLon / 2) * sin(dLon / 2);
+    double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+    return R * c;
+}
+
+FlightGraph buildFlightNetwork()
+{
+    FlightGraph graph;
+
+    vector<Airport> airports = {
+
+        {"SEA", "SEATTLE TACOMA INTERNATIONAL AIRPORT", sf::Vector2f(225, 269), 47.4502, -122.3088},
+        {"PDX", "PORTLAND INTERNATIONAL AIRPORT", sf::Vector2f(153, 369), 45.5898, -122.5951},
+        {"SFO", "SAN FRANCISCO INTERNATIONAL AIRPORT", sf::Vector2f(82, 586), 37.6213, -122.3790},
+        {"LAS", "HARRY REID INTERNATIONAL AIRPORT", sf::Vector2f(250, 624), 36.0840, -115.1537},
+        {"SLC", "SALT LAKE CITY INTERNATIONAL AIRPORT", sf::Vector2f(378, 558), 40.7899, -111.9791},
+        {"LAX", "LOS ANGELES INTERNATIONAL AIRPORT", sf::Vector2f(166, 721), 33.9416, -118.4085},
+        {"MSP", "MINNEAPOLIS SAINT PAUL INTERNATIONAL AIRPORT", sf::Vector2f(831, 405), 44.8848, -93.2223},
+        {"MCI", "KANSAS CITY INTERNATIONAL AIRPORT", sf::Vector2f(742, 642), 39.2976, -94.7139},
+        {"JFK", "JOHN F. KENNEDY INTERNATIONAL AIRPORT", sf::Vector2f(1324, 511), 40.6413, -73.7781},
+        {"BOS", "BOSTON LOGAN INTERNATIONAL AIRPORT", sf::Vector2f(1393, 448), 42.3656, -71.0096},
+        {"CLE", "CLEVELAND HOPKINS INTERNATIONAL AIRPORT", sf::Vector2f(1150, 550), 41.4117, -81.8498},
+        {"CLT", "CHARLOTTE DOUGLAS INTERNATIONAL AIRPORT", sf::Vector2f(1237, 727), 35.2140, -80.9431},
+        {"MIA", "MIAMI INTERNATIONAL AIRPORT", sf::Vector2f(1259, 1016), 25.7959, -80.2870},
+        {"IAH", "GEORGE BUSH INTERCONTINENTAL AIRPORT", sf::Vector2f(786, 962), 29.9902, -95.3368},
+        {"STL", "ST. LOUIS LAMBERT INTERNATIONAL AIRPORT", sf::Vector2f(905, 647), 38.7500, -90.3700},
+        {"TPA", "TAMPA INTERNATIONAL AIRPORT", sf::Vector2f(1160, 991), 27.9755, -82.5332},
+        {"DEN", "DENVER INTERNATIONAL AIRPORT", sf::Vector2f(549, 616), 39.8561, -104.6737},
+        {"PHX", "PHOENIX SKY HARBOR INTERNATIONAL AIRPORT", sf::Vector2f(342, 778), 33.4373, -112.0078},
+        {"DFW", "DALLAS/FORT WORTH INTERNATIONAL AIRPORT", sf::Vector2f(756, 853), 32.8998, -97.0403},
+        {"AUG", "AUGUSTA STATE AIRPORT", sf::Vector2f(1413, 331), 44.3206, -69.7973}
+    };
+
+    for (const auto &ap : airports)
+    {
+        graph.addAirport(ap.code, ap.position.x, ap.position.y, ap.latitude, ap.longitude);
+    }
+
+    int n = airports.size();
+
+    vector<double> rowKm(n);
+    for (int i = 0; i < n; ++i)
+    {
+        graph.geo.distancesKm(graph.geo.at(i), i + 1, n, rowKm.data());
+        for (int j = i + 1; j < n; ++j)
+        {
+            const auto &pi = graph.airports[i].position;
+            const auto &pj = graph.airports[j].position;
+            double dx = pi.x - pj.x;
+            double dy = pi.y - pj.y;
+            double dist = sqrt(dx * dx + dy * dy);
+
+            if (dist > 800)
+            continue;
+
+            string code1 = graph.airports[i].code;
+            string code2 = graph.airports[j].code;
+
+            if ((code1 == "STL" && code2 == "SEA") || (code1 == "SEA" && code2 == "STL"))
+            continue;
+            if ((code1 == "TPA" && code2 == "SEA") || (code1 == "SEA" && code2 == "TPA"))
+            continue;
+            if ((code1 == "MIA" && code2 == "SEA") || (code1 == "SEA" && code2 == "MIA"))
+            continue;
+            if ((code1 == "BOS" && code2 == "LAX") || (code1 == "LAX" && code2 == "BOS"))
+            continue;
+            if ((code1 == "CLE" && code2 == "LAX") || (code1 == "LAX" && code2 == "CLE"))
+            continue;
+
+            double cost = 100 + (rand() % 200);
+            double time = 30 + (rand() % 120);
+            double distance = rowKm[j - i - 1];
+            double duration = distance / cruiseSpeedKmh * 60.0;
+            if (duration < 10.0)
+            duration = 10.0;
+            graph.addEdge(i, j, dist, cost, duration);
+        }
+    }
+    graph.buildSpatialIndex();
+    if (weatherGrid)
+    graph.buildEdgeCells(*weatherGrid);
+    return graph;
+}
+
+// Rough linear fit of the background map, good enough to place synthetic airports.
+sf::Vector2f mapPosition(double lat, double lon)
+{
+    return sf::Vector2f(static_cast<float>(25.37 * lon + 3216.1), static_cast<float>(-35.36 * lat + 1971.0));
+}
+
+vector<Airport> generateSyntheticAirports(int count, unsigned seed)
+{
+    mt19937 gen(seed);
+    uniform_real_distribution<double> latDist(25.0, 49.0);
+    uniform_real_distribution<double> lonDist(-124.0, -67.0);
+    vector<Airport> result;
+    result.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        double lat = latDist(gen), lon = lonDist(gen);
+        ostringstream code;
+        code << "X" << setfill('0') << setw(5) << i;
+        result.push_back({code.str(), "SYNTHETIC AIRPORT", mapPosition(lat, lon), lat, lon});
+    }
+    return result;
+}
+
+FlightGraph buildSyntheticNetwork(int count, unsigned seed, double radiusKm = 300.0, size_t minNeighbors = 3)
+{
+    FlightGraph graph;
+    for (const auto &ap : generateSyntheticAirports(count, seed))
+    graph.addAirport(ap.code, ap.position.x, ap.position.y, ap.latitude, ap.longitude);
+    graph.connectNearby(radiusKm, minNeighbors, seed);
+    return graph;
+}
+
+// Resolves feed codes against a graph; the string_views point into its
+// airports, so the graph must outlive the resolver.
+WeatherFeedResolver feedResolver(const FlightGraph &graph)
+{
+    WeatherFeedResolver resolver;
+    resolver.airportIndex.reserve(graph.airports.size());
+    for (size_t i = 0; i < graph.airports.size(); ++i)
+    resolver.airportIndex.emplace(graph.airports[i].code, static_cast<int>(i));
+    resolver.edgeId = [&graph](int u, int v)
+    {
+        const EdgeInfo *e = graph.findEdge(u, v);
+        return e ? e->id : -1;
+    };
+    resolver.edgeCount = graph.edgeEnds.size();
+    return resolver;
+}
+
+int runSpatialBenchmark(int count)
+{
+    using namespace std::chrono;
+    const double radiusKm = 300.0;
+    FlightGraph graph;
+    for (const auto &ap : generateSyntheticAirports(count, 7))
+    graph.addAirport(ap.code, ap.position.x, ap.position.y, ap.latitude, ap.longitude);
+
+    auto t0 = high_resolution_clock::now();
+    size_t brutePairs = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        for (int j = i + 1; j < count; ++j)
+        {
+            if (haversine(graph.airports[i].latitude, graph.airports[i].longitude, graph.airports[j].latitude, graph.airports[j].longitude) <= radiusKm)
+            ++brutePairs;
+        }
+    }
+    auto t1 = high_resolution_clock::now();
+    graph.connectNearby(radiusKm, 3, 7);
+    auto t2 = high_resolution_clock::now();
+
+    mt19937 gen(11);
+    uniform_real_distribution<double> latDist(25.0, 49.0), lonDist(-124.0, -67.0);
+    const int queries = 100000;
+    vector<int> result;
+    size_t found = 0;
+    auto t3 = high_resolution_clock::now();
+    for (int q = 0; q < queries; ++q)
+    found += graph.nearestAirport(latDist(gen), lonDist(gen)) >= 0;
+    auto t4 = high_resolution_clock::now();
+    for (int q = 0; q < queries; ++q)
+    found += graph.airportsWithin(q % count, radiusKm).size();
+    auto t5 = high_resolution_clock::now();
+    for (int q = 0; q < queries / 100; ++q)
+    {
+        result.clear();
+        graph.geo.within(graph.geo.at(q % count), radiusKm, result);
+        found += result.size();
+    }
+    auto t6 = high_resolution_clock::now();
+
+    auto ms = [](high_resolution_clock::time_point a, high_resolution_clock::time_point b)
+    { return duration<double, milli>(b - a).count(); };
+    printLine('=');
+    cout << "SPATIAL INDEX (" << count << " airports, " << radiusKm << " km radius)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "All-pairs scan : " << ms(t0, t1) << " ms (" << brutePairs << " pairs in range)" << endl;
+    cout << "Indexed edge build : " << ms(t1, t2) << " ms (" << graph.edgeEnds.size() << " edges incl. nearest-neighbour links)" << endl;
+    cout << "Nearest airport : " << ms(t3, t4) * 1000.0 / queries << " us/query" << endl;
+    cout << "Radius query (index) : " << ms(t4, t5) * 1000.0 / queries << " us/query" << endl;
+    cout << "Radius query (linear) : " << ms(t5, t6) * 1000.0 / (queries / 100) << " us/query" << endl;
+    cout << "Checksum : " << found << endl;
+    return 0;
+}
+
+// Storm field throughput: snapshot cost, airport and segment queries, and the
+// per-step batch of edge changes over a synthetic network.
+int runStormBenchmark(int count, int hours)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    StormFieldConfig config = stormConfigFromEnv();
+    config.cells = getenv("AEROROUTE_STORMS") ? config.cells : 64;
+    StormField field(config);
+    const long long start = 1700000000;
+    const int stepMinutes = 10;
+    const int steps = hours * 60 / stepMinutes;
+
+    StormSnapshot snapshot;
+    vector<int> changed;
+    vector<int> lastPath;
+    size_t badAirports = 0, totalChanges = 0, maxChanges = 0, reroutes = 0;
+    double snapshotMs = 0, pointMs = 0, edgeMs = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+        auto t0 = high_resolution_clock::now();
+        field.at(start + step * stepMinutes * 60LL, snapshot);
+        auto t1 = high_resolution_clock::now();
+        for (int a = 0; a < count; ++a)
+        badAirports += snapshot.isBad(graph.geo.at(a));
+        auto t2 = high_resolution_clock::now();
+        changed.clear();
+        graph.applyStorms(snapshot, changed);
+        auto t3 = high_resolution_clock::now();
+        totalChanges += changed.size();
+        maxChanges = max(maxChanges, changed.size());
+        vector<int> path = graph.dijkstra(0, count - 1, "distance");
+        reroutes += step > 0 && path != lastPath;
+        lastPath = path;
+        snapshotMs += duration<double, milli>(t1 - t0).count();
+        pointMs += duration<double, milli>(t2 - t1).count();
+        edgeMs += duration<double, milli>(t3 - t2).count();
+    }
+
+    double pointQueries = static_cast<double>(count) * steps;
+    double edgeQueries = static_cast<double>(graph.edgeEnds.size()) * steps;
+    printLine('=');
+    cout << "STORM FIELD (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << config.cells << " cells, "
+         << steps << " steps of " << stepMinutes << " min)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Snapshot : " << snapshotMs * 1000.0 / steps << " us/step" << endl;
+    cout << "Airport queries : " << pointQueries / pointMs / 1000.0 << " M/s (" << 100.0 * badAirports / pointQueries << "% under a cell)" << endl;
+    cout << "Segment queries : " << edgeQueries / edgeMs / 1000.0 << " M/s" << endl;
+    cout << "Edge changes : " << totalChanges / static_cast<double>(steps) << " per step on average, " << maxChanges << " max" << endl;
+    cout << "Route " << graph.airports[0].code << " -> " << graph.airports[count - 1].code << " changed at " << reroutes << " steps" << endl;
+    return 0;
+}
+
+// Along-route checks from the raster: edge-table build, per-slice network
+// pass, and agreement with the exact storm-cell arc test it approximates.
+int runGridBenchmark(int count)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    StormFieldConfig config = stormConfigFromEnv();
+    config.cells = getenv("AEROROUTE_STORMS") ? config.cells : 64;
+    StormField field(config);
+    const long long start = 1700000000;
+    WeatherGrid grid(config.latMin, config.latMax, config.lonMin, config.lonMax, 0.25, start, 10800, 40);
+
+    auto t0 = high_resolution_clock::now();
+    grid.rasterize(field);
+    auto t1 = high_resolution_clock::now();
+    graph.buildEdgeCells(grid);
+    auto t2 = high_resolution_clock::now();
+
+    vector<int32_t> mask, scratch;
+    vector<uint8_t> crossing;
+    size_t crossingEdges = 0;
+    const int rounds = 5;
+    auto t3 = high_resolution_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (int slice = 0; slice < grid.slices(); ++slice)
+        {
+            grid.badMask(slice, mask);
+            graph.edgeCells.crossing(mask, crossing, scratch);
+            crossingEdges += count_if(crossing.begin(), crossing.end(), [](uint8_t c)
+                                      { return c != 0; });
+        }
+    }
+    auto t4 = high_resolution_clock::now();
+
+    // Exact answer for comparison; the raster is conservative only up to the
+    // cell size, so the two differ at storm edges.
+    size_t agree = 0, total = 0;
+    StormSnapshot snapshot;
+    for (int slice = 0; slice < grid.slices(); ++slice)
+    {
+        field.at(grid.sliceTime(slice), snapshot);
+        grid.badMask(slice, mask);
+        graph.edgeCells.crossing(mask, crossing, scratch);
+        for (size_t id = 0; id < graph.edgeEnds.size(); ++id)
+        {
+            UnitVector a = graph.geo.at(graph.edgeEnds[id].first), b = graph.geo.at(graph.edgeEnds[id].second);
+            agree += (snapshot.cellOnArc(a, b, arcNormal(a, b)) >= 0) == (crossing[id] != 0);
+            ++total;
+        }
+    }
+
+    double passMs = duration<double, milli>(t4 - t3).count() / (rounds * grid.slices());
+    printLine('=');
+    cout << "WEATHER GRID (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << grid.cellCount() << " cells x "
+         << grid.slices() << " slices, " << geodesicKernelName() << ")" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Rasterize storms : " << duration<double, milli>(t1 - t0).count() << " ms for all slices" << endl;
+    cout << "Edge-cell table : " << duration<double, milli>(t2 - t1).count() << " ms, " << graph.edgeCells.cells.size() << " entries ("
+         << static_cast<double>(graph.edgeCells.cells.size()) / graph.edgeEnds.size() << " cells/edge)" << endl;
+    cout << "Network pass : " << passMs << " ms/slice, " << graph.edgeEnds.size() / passMs / 1000.0 << " M edges/s" << endl;
+    cout << "Edges crossing bad cells : " << 100.0 * crossingEdges / (static_cast<double>(graph.edgeEnds.size()) * rounds * grid.slices()) << "%" << endl;
+    cout << "Agreement with exact arc test : " << 100.0 * agree / total << "%" << endl;
+    return 0;
+}
+
+// Feed ingestion: writes a synthetic NDJSON event stream to disk, then replays
+// it through a WeatherFeed in fixed-size chunks into a synthetic network.
+// A hot subset of airports and edges gets most of the traffic, as storms do,
+// so the coalescing window has something to fold.
+int runIngestBenchmark(int events, int count)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    const long long start = 1700000000;
+    const int eventsPerSecond = 50;
+    const long long windowSeconds = 60;
+    string path = (filesystem::temp_directory_path() / "aeroroute_feed_bench.ndjson").string();
+    {
+        mt19937 gen(11);
+        uniform_int_distribution<int> airportDist(0, count - 1);
+        uniform_int_distribution<int> edgeDist(0, static_cast<int>(graph.edgeEnds.size()) - 1);
+        uniform_int_distribution<int> pct(0, 99);
+        const char *conditions[] = {"Clear", "Clear", "Clear", "Clouds", "Rain", "Thunderstorm", "Snow"};
+        ofstream out(path, ios::binary);
+        for (int i = 0; i < events; ++i)
+        {
+            bool hot = pct(gen) < 70;
+            const char *condition = conditions[gen() % 7];
+            out << "{\"t\":" << start + i / eventsPerSecond;
+            if (pct(gen) < 40)
+            {
+                int a = hot ? airportDist(gen) % (count / 20 + 1) : airportDist(gen);
+                out << ",\"airport\":\"" << graph.airports[a].code << "\"";
+            }
+            else
+            {
+                int id = hot ? edgeDist(gen) % (static_cast<int>(graph.edgeEnds.size()) / 20 + 1) : edgeDist(gen);
+                out << ",\"from\":\"" << graph.airports[graph.edgeEnds[id].first].code << "\",\"to\":\""
+                    << graph.airports[graph.edgeEnds[id].second].code << "\"";
+            }
+            out << ",\"condition\":\"" << condition << "\"}\n";
+        }
+    }
+    uintmax_t bytes = filesystem::file_size(path);
+
+    size_t published = 0;
+    WeatherFeed feed(feedResolver(graph), graph.airports.size(), graph.edgeEnds.size(), [&](const vector<WeatherEvent> &batch, vector<int> &changed)
+                     { graph.applyWeatherEvents(batch, changed); },
+                     windowSeconds);
+    feed.subscribe([&](const vector<int> &changed)
+                   { published += changed.size(); });
+
+    vector<char> chunk(64 * 1024);
+    auto t0 = high_resolution_clock::now();
+    ifstream in(path, ios::binary);
+    while (in)
+    {
+        in.read(chunk.data(), chunk.size());
+        feed.ingest(chunk.data(), static_cast<size_t>(in.gcount()));
+    }
+    feed.flush();
+    auto t1 = high_resolution_clock::now();
+    filesystem::remove(path);
+
+    // Lines a client could post to /weather/feed that must all be refused,
+    // edge ids out of range or not integers first, and one that must pass.
+    const int edges = graph.edgeEnds.size();
+    vector<string> malformed = {
+        "{\"t\":1,\"edge\":-1,\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":" + to_string(edges) + ",\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":1e12,\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":-4294967295,\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":2.5,\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":nan,\"condition\":\"Rain\"}",
+        "{\"t\":1e300,\"edge\":0,\"condition\":\"Rain\"}",
+        "{\"t\":1,\"airport\":\"NOPE\",\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":0}",
+        "{\"t\":1,\"edge\":0,\"airport\":\"" + graph.airports[0].code + "\",\"condition\":\"Rain\"}",
+        "{\"t\":1,\"edge\":",
+    };
+    size_t accepted = 0;
+    WeatherFeed strict(feedResolver(graph), graph.airports.size(), graph.edgeEnds.size(), [&](const vector<WeatherEvent> &batch, vector<int> &)
+                       { accepted += batch.size(); });
+    for (const string &line : malformed)
+    strict.ingest(line + "\n");
+    strict.ingest("{\"t\":1,\"edge\":" + to_string(edges - 1) + ",\"condition\":\"Rain\"}\n");
+    strict.flush();
+    size_t mismatches = (strict.stats().rejected != malformed.size()) + (accepted != 1);
+
+    const WeatherFeedStats &stats = feed.stats();
+    double seconds = duration<double>(t1 - t0).count();
+    size_t closed = count_if(graph.edgeAvailable.begin(), graph.edgeAvailable.end(), [](char open)
+                             { return !open; });
+    printLine('=');
+    cout << "WEATHER FEED (" << events << " events, " << count << " airports, " << graph.edgeEnds.size() << " edges, "
+         << windowSeconds << " s window)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Replay : " << seconds * 1000.0 << " ms, " << stats.lines / seconds / 1000.0 << " k events/s, "
+         << bytes / seconds / 1e6 << " MB/s" << endl;
+    cout << "Rejected lines : " << stats.rejected << endl;
+    cout << "Coalesced : " << 100.0 * stats.coalesced / max<size_t>(1, stats.lines) << "% of events folded into a newer one" << endl;
+    cout << "Applied : " << stats.applied << " events in " << stats.batches << " batches" << endl;
+    cout << "Published : " << published << " edge changes (" << published / static_cast<double>(max<size_t>(1, stats.batches)) << " per batch)" << endl;
+    cout << "Closed edges at end : " << closed << endl;
+    cout << "Malformed lines refused : " << strict.stats().rejected << " of " << malformed.size() << endl;
+    cout << "Mismatches : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Query throughput on published snapshots, first with the weather frozen and
+// then with a writer pushing feed batches on its own thread, paced at
+// `batchesPerSecond` (0 = flat out). Readers never touch the graph's live
+// flags, so they take no locks in either phase.
+int runSnapshotBenchmark(int readers, double seconds, double batchesPerSecond)
+{
+    using namespace std::chrono;
+    const int count = 2000;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    SnapshotCell<EdgeState> cell;
+    uint64_t version = 0;
+    cell.publish(graph.snapshotEdgeState(++version));
+
+    // A pool of feed lines the writer cycles through, one flushed batch per chunk.
+    const int linesPerBatch = 1000;
+    vector<string> chunks;
+    {
+        mt19937 gen(5);
+        uniform_int_distribution<int> airportDist(0, count - 1);
+        const char *conditions[] = {"Clear", "Clear", "Clear", "Clear", "Clear", "Clear", "Clouds", "Mist", "Rain", "Thunderstorm"};
+        for (int c = 0; c < 64; ++c)
+        {
+            ostringstream out;
+            for (int i = 0; i < linesPerBatch; ++i)
+            out << "{\"t\":" << 1700000000 + i << ",\"airport\":\"" << graph.airports[airportDist(gen)].code << "\",\"condition\":\""
+                << conditions[gen() % 10] << "\"}\n";
+            chunks.push_back(out.str());
+        }
+    }
+    WeatherFeed feed(feedResolver(graph), graph.airports.size(), graph.edgeEnds.size(), [&](const vector<WeatherEvent> &batch, vector<int> &changed)
+                     { graph.applyWeatherEvents(batch, changed); });
+    feed.subscribe([&](const vector<int> &changed)
+                   {
+                       auto current = cell.read();
+                       cell.publish(graph.snapshotEdgeState(++version, current.get(), &changed)); });
+
+    struct Phase
+    {
+        size_t queries = 0, found = 0, versionsSeen = 0, batches = 0;
+        double seconds = 0;
+    };
+    auto run = [&](bool updating)
+    {
+        Phase result;
+        atomic<bool> stop{false};
+        vector<size_t> queries(readers, 0), found(readers, 0), seen(readers, 0);
+        vector<thread> threads;
+        for (int r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&, r]()
+                                 {
+                                     mt19937 gen(100 + r);
+                                     uniform_int_distribution<int> pick(0, count - 1);
+                                     uint64_t last = 0;
+                                     while (!stop.load(memory_order_relaxed))
+                                     {
+                                         int src = pick(gen), dst = pick(gen);
+                                         auto state = cell.read();
+                                         found[r] += !graph.dijkstra(src, dst, *state, "time").empty();
+                                         // Each query knows the weather version it ran against.
+                                         seen[r] += state->version != last;
+                                         last = state->version;
+                                         ++queries[r];
+                                     } });
+        }
+        auto t0 = high_resolution_clock::now();
+        if (updating)
+        {
+            size_t next = 0;
+            while (duration<double>(high_resolution_clock::now() - t0).count() < seconds)
+            {
+                feed.ingest(chunks[next++ % chunks.size()]);
+                feed.flush();
+                ++result.batches;
+                if (batchesPerSecond > 0)
+                this_thread::sleep_until(t0 + duration_cast<high_resolution_clock::duration>(duration<double>(result.batches / batchesPerSecond)));
+            }
+        }
+        else
+        this_thread::sleep_for(duration<double>(seconds));
+        stop = true;
+        for (auto &t : threads)
+        t.join();
+        result.seconds = duration<double>(high_resolution_clock::now() - t0).count();
+        for (int r = 0; r < readers; ++r)
+        {
+            result.queries += queries[r];
+            result.found += found[r];
+            result.versionsSeen += seen[r];
+        }
+        return result;
+    };
+
+    // Both phases start from the steady state the update stream produces.
+    for (const auto &chunk : chunks)
+    {
+        feed.ingest(chunk);
+        feed.flush();
+    }
+    Phase frozen = run(false);
+    Phase live = run(true);
+    size_t pending = cell.reclaim();
+
+    printLine('=');
+    cout << "SNAPSHOT READS (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << readers << " query threads, "
+         << seconds << " s per phase, writer " << (batchesPerSecond > 0 ? to_string(static_cast<int>(batchesPerSecond)) + " batches/s" : string("unpaced")) << ")" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Frozen weather : " << frozen.queries / frozen.seconds << " queries/s" << endl;
+    cout << "Live updates : " << live.queries / live.seconds << " queries/s (" << 100.0 * live.queries / live.seconds / (frozen.queries / frozen.seconds)
+         << "% of frozen)" << endl;
+    cout << "Writer : " << live.batches / live.seconds << " batches/s, " << live.batches * linesPerBatch / live.seconds / 1000.0 << " k events/s" << endl;
+    cout << "Versions : " << version << " published, " << live.versionsSeen << " version switches seen by readers" << endl;
+    cout << "Snapshots : " << cell.freed() << " reclaimed, " << pending << " still pinned" << endl;
+    cout << "Routes found : " << 100.0 * (frozen.found + live.found) / max<size_t>(1, frozen.queries + live.queries) << "%" << endl;
+    return 0;
+}
+
+// Customizable contraction hierarchy: one-off preparation, re-customization
+// as weather penalties change, and query latency against plain Dijkstra on
+// the same weights (which also checks every answer).
+int runCchBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(3);
+    uniform_int_distribution<int> pick(0, count - 1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    auto ms = [](high_resolution_clock::time_point a, high_resolution_clock::time_point b)
+    { return duration<double, milli>(b - a).count(); };
+
+    auto t0 = high_resolution_clock::now();
+    CustomizableCH cch = graph.buildHierarchy();
+    auto t1 = high_resolution_clock::now();
+
+    // A new round of turbulence and headwinds every few minutes, plus a few
+    // closures; each round is one customization.
+    auto reweather = [&]()
+    {
+        for (size_t id = 0; id < graph.edgeEnds.size(); ++id)
+        {
+            double r = unit(gen);
+            graph.edgePenalty[id] = r < 0.2 ? EdgePenalty{static_cast<float>(60 * unit(gen)), static_cast<float>(50 * unit(gen))} : EdgePenalty{};
+            graph.edgeAvailable[id] = unit(gen) >= 0.03;
+        }
+    };
+    const int threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    const int rounds = 10;
+    vector<double> weights;
+    CustomizableCH::Metric metric;
+    double serialMs = 0, parallelMs = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        reweather();
+        graph.edgeWeights("time", nullptr, weights);
+        auto a = high_resolution_clock::now();
+        cch.customize(weights, metric, 1);
+        auto b = high_resolution_clock::now();
+        cch.customize(weights, metric, threads);
+        auto c = high_resolution_clock::now();
+        serialMs += ms(a, b);
+        parallelMs += ms(b, c);
+    }
+
+    // Reference answers from Dijkstra over the same weights.
+    auto reference = [&](int s, int t)
+    {
+        vector<double> dist(count, CustomizableCH::Inf);
+        using PDI = pair<double, int>;
+        priority_queue<PDI, vector<PDI>, greater<>> pq;
+        dist[s] = 0;
+        pq.push({0, s});
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (u == t)
+            break;
+            if (d > dist[u])
+            continue;
+            for (const auto &e : graph.adj[u])
+            {
+                if (d + weights[e.id] < dist[e.to])
+                {
+                    dist[e.to] = d + weights[e.id];
+                    pq.push({dist[e.to], e.to});
+                }
+            }
+        }
+        return dist[t];
+    };
+
+    vector<pair<int, int>> pairs(queries);
+    for (auto &q : pairs)
+    q = {pick(gen), pick(gen)};
+    double checksum = 0;
+    auto t2 = high_resolution_clock::now();
+    for (const auto &q : pairs)
+    checksum += min(cch.distance(metric, q.first, q.second), 1e9);
+    auto t3 = high_resolution_clock::now();
+    size_t pathNodes = 0;
+    for (const auto &q : pairs)
+    pathNodes += cch.path(metric, q.first, q.second).size();
+    auto t4 = high_resolution_clock::now();
+    const int checked = min(queries, 300);
+    size_t mismatches = 0;
+    for (int i = 0; i < checked; ++i)
+    {
+        double expected = reference(pairs[i].first, pairs[i].second);
+        double got = cch.distance(metric, pairs[i].first, pairs[i].second);
+        vector<int> path = cch.path(metric, pairs[i].first, pairs[i].second);
+        double walked = path.empty() ? CustomizableCH::Inf : 0;
+        for (size_t k = 1; k < path.size(); ++k)
+        {
+            const EdgeInfo *e = graph.findEdge(path[k - 1], path[k]);
+            walked += e ? weights[e->id] : CustomizableCH::Inf;
+        }
+        bool same = expected == CustomizableCH::Inf ? got == expected && path.empty() : fabs(got - expected) < 1e-6 * expected + 1e-9 && fabs(walked - expected) < 1e-6 * expected + 1e-9;
+        mismatches += !same;
+    }
+    auto t5 = high_resolution_clock::now();
+
+    printLine('=');
+    cout << "CUSTOMIZABLE CH (" << count << " airports, " << graph.edgeEnds.size() << " edges, time metric with penalties)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Order + prepare : " << ms(t0, t1) << " ms, " << cch.arcs() << " arcs, " << cch.triangleCount() << " triangles, tree height "
+         << cch.treeHeight() << ", " << cch.levels() << " levels" << endl;
+    cout << "Customize : " << serialMs / rounds << " ms on 1 thread, " << parallelMs / rounds << " ms on " << threads << " ("
+         << CustomizableCH::queryArcs(metric) << " arcs left for queries)" << endl;
+    cout << "Distance query : " << ms(t2, t3) * 1000.0 / queries << " us" << endl;
+    cout << "Path query : " << ms(t3, t4) * 1000.0 / queries << " us (" << static_cast<double>(pathNodes) / queries << " airports/path)" << endl;
+    cout << "Dijkstra (check) : " << ms(t4, t5) * 1000.0 / checked << " us/query incl. CCH answer, " << mismatches << " mismatches in " << checked << endl;
+    cout << "Checksum : " << checksum << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Arc-flags: precomputation per metric and the search-space reduction they
+// give Dijkstra and A* on a synthetic network with some edges closed.
+int runArcFlagsBenchmark(int count, int levels)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(9);
+    uniform_int_distribution<int> pick(0, count - 1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t id = 0; id < graph.edgeEnds.size(); ++id)
+    graph.edgeAvailable[id] = unit(gen) >= 0.03;
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    const int threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    vector<int> regions = graph.partitionRegions(levels);
+
+    const int queries = 300;
+    vector<pair<int, int>> pairs(queries);
+    for (auto &q : pairs)
+    q = {pick(gen), pick(gen)};
+    auto pathWeight = [&](const vector<int> &path, const string &metric)
+    {
+        double total = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            const EdgeInfo *e = graph.findEdge(path[i - 1], path[i]);
+            total += metric == "distance" ? e->distance : metric == "cost" ? e->cost : e->time;
+        }
+        return total;
+    };
+
+    printLine('=');
+    cout << "ARC-FLAGS (" << count << " airports, " << graph.edgeEnds.size() << " edges, 3% closed, " << (1 << levels) << " regions)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    size_t mismatches = 0;
+    for (const string metric : {"distance", "time"})
+    {
+        auto t0 = high_resolution_clock::now();
+        ArcFlags flags = graph.buildArcFlags(regions, metric, *state, threads);
+        auto t1 = high_resolution_clock::now();
+
+        struct Run
+        {
+            size_t scanned = 0;
+            double ms = 0;
+        };
+        auto run = [&](bool astar, const ArcFlags *f, vector<vector<int>> &paths)
+        {
+            Run r;
+            vector<pair<int, int>> explored;
+            paths.clear();
+            auto a = high_resolution_clock::now();
+            for (const auto &q : pairs)
+            {
+                explored.clear();
+                paths.push_back(astar ? graph.astar(q.first, q.second, *state, explored, metric, f)
+                                      : graph.dijkstra(q.first, q.second, *state, explored, metric, f));
+                r.scanned += explored.size();
+            }
+            r.ms = duration<double, milli>(high_resolution_clock::now() - a).count();
+            return r;
+        };
+        cout << metric << " : " << duration<double, milli>(t1 - t0).count() << " ms precompute on " << threads << " threads, "
+             << flags.boundaryNodes() << " boundary airports, " << 100.0 * flags.density() << "% of arcs flagged per region" << endl;
+        for (bool astar : {false, true})
+        {
+            vector<vector<int>> plainPaths, flaggedPaths;
+            Run plain = run(astar, nullptr, plainPaths);
+            Run flagged = run(astar, &flags, flaggedPaths);
+            for (int i = 0; i < queries; ++i)
+            mismatches += plainPaths[i].empty() != flaggedPaths[i].empty() ||
+                          fabs(pathWeight(plainPaths[i], metric) - pathWeight(flaggedPaths[i], metric)) > 1e-6;
+            cout << "  " << (astar ? "A*       " : "Dijkstra ") << ": " << plain.scanned / queries << " -> " << flagged.scanned / queries
+                 << " arcs scanned (" << static_cast<double>(plain.scanned) / max<size_t>(1, flagged.scanned) << "x), "
+                 << plain.ms * 1000.0 / queries << " -> " << flagged.ms * 1000.0 / queries << " us/query" << endl;
+        }
+    }
+    cout << "Mismatched routes : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Hub labels: build time, label size and query latency for one metric,
+// checked against Dijkstra and read back through a mapped label file.
+int runHubLabelsBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    mt19937 gen(11);
+    uniform_int_distribution<int> pick(0, count - 1);
+    vector<pair<int, int>> pairs(queries);
+    for (auto &q : pairs)
+    q = {pick(gen), pick(gen)};
+    auto ms = [](auto a, auto b)
+    { return duration<double, milli>(b - a).count(); };
+
+    printLine('=');
+    cout << "HUB LABELS (" << count << " airports, " << graph.edgeEnds.size() << " edges, metric distance)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    auto t0 = high_resolution_clock::now();
+    vector<int> order = graph.hierarchyOrder();
+    auto t1 = high_resolution_clock::now();
+    HubLabels labels = graph.buildHubLabels("distance", *state, order);
+    auto t2 = high_resolution_clock::now();
+    double checksum = 0;
+    for (const auto &q : pairs)
+    checksum += labels.distance(q.first, q.second);
+    auto t3 = high_resolution_clock::now();
+
+    const string file = (filesystem::temp_directory_path() / "aeroroute_hub_labels_bench.bin").string();
+    bool saved = labels.save(file, 42);
+    HubLabels mapped;
+    uint64_t key = 0;
+    bool loaded = saved && mapped.load(file, count, &key) && key == 42;
+    size_t differ = 0;
+    if (loaded)
+    for (const auto &q : pairs)
+    differ += mapped.distance(q.first, q.second) != labels.distance(q.first, q.second);
+
+    // Damaged copies must be refused: truncated, for another graph, and with
+    // an offset that runs backwards.
+    size_t refused = 0;
+    {
+        string bytes;
+        {
+            ifstream in(file, ios::binary);
+            bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        const string damaged = file + ".damaged";
+        auto refuses = [&](const string &content, uint32_t nodes)
+        {
+            ofstream(damaged, ios::binary | ios::trunc).write(content.data(), content.size());
+            HubLabels probe;
+            return !probe.load(damaged, nodes);
+        };
+        refused += refuses(bytes.substr(0, bytes.size() / 2), count);
+        refused += refuses(bytes, count + 1);
+        string backwards = bytes;
+        uint32_t big = 0xFFFFFFF0u;
+        memcpy(&backwards[24 + 4], &big, sizeof(big));
+        refused += refuses(backwards, count);
+        remove(damaged.c_str());
+    }
+
+    const int checked = min(queries, 300);
+    size_t mismatches = 0;
+    auto t4 = high_resolution_clock::now();
+    for (int i = 0; i < checked; ++i)
+    {
+        vector<int> path = graph.dijkstra(pairs[i].first, pairs[i].second, *state, "distance");
+        double expect = path.empty() ? HubLabels::Inf : 0.0;
+        for (size_t k = 1; k < path.size(); ++k)
+        expect += graph.findEdge(path[k - 1], path[k])->distance;
+        float got = labels.distance(pairs[i].first, pairs[i].second);
+        mismatches += path.empty() ? got != HubLabels::Inf : fabs(got - expect) > 1e-4 * max(1.0, expect);
+    }
+    auto t5 = high_resolution_clock::now();
+
+    cout << "Order : " << ms(t0, t1) << " ms" << endl;
+    cout << "Labels : " << ms(t1, t2) << " ms, " << static_cast<double>(labels.labelEntries()) / count << " hubs/airport (max " << labels.largestLabel() << "), "
+         << labels.bytes() / (1024.0 * 1024.0) << " MB" << endl;
+#if defined(__AVX2__)
+    cout << "Query (AVX2) : " << ms(t2, t3) * 1e6 / queries << " ns" << endl;
+#else
+    cout << "Query : " << ms(t2, t3) * 1e6 / queries << " ns" << endl;
+#endif
+    cout << "Mapped file : " << (loaded ? "loaded" : "failed") << ", " << differ << " differing answers, " << refused << " of 3 damaged copies refused" << endl;
+    cout << "Dijkstra (check) : " << ms(t4, t5) * 1000.0 / checked << " us/query, " << mismatches << " mismatches in " << checked << endl;
+    cout << "Checksum : " << checksum << endl;
+    remove(file.c_str());
+    return mismatches == 0 && loaded && differ == 0 && refused == 3 ? 0 : 1;
+}
+
+// Replacement paths: one batched pass per origin-destination pair against a
+// Dijkstra per closed segment, then a request stream with closures served
+// from the per-pair tables.
+int runReplacementBenchmark(int count, int pairsCount)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(13);
+    uniform_int_distribution<int> pick(0, count - 1);
+    vector<pair<int, int>> pairs(pairsCount);
+    for (auto &q : pairs)
+    {
+        q = {pick(gen), pick(gen)};
+        while (q.second == q.first)
+        q.second = pick(gen);
+    }
+    auto ms = [](auto a, auto b)
+    { return duration<double, milli>(b - a).count(); };
+    auto pathWeight = [&](const vector<int> &path)
+    {
+        double total = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        total += graph.findEdge(path[i - 1], path[i])->distance;
+        return total;
+    };
+
+    printLine('=');
+    cout << "REPLACEMENT PATHS (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << pairsCount << " pairs)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+
+    auto t0 = high_resolution_clock::now();
+    vector<ReplacementPaths> tables;
+    for (const auto &q : pairs)
+    tables.push_back(graph.replacementPaths(q.first, q.second, "distance"));
+    auto t1 = high_resolution_clock::now();
+    size_t segments = 0, mismatches = 0;
+    vector<pair<int, int>> dummy;
+    for (const auto &table : tables)
+    {
+        for (size_t i = 0; i < table.pathEdges.size(); ++i)
+        {
+            int closed = table.pathEdges[i];
+            dummy.clear();
+            vector<int> path = graph.dijkstraWith(table.source, table.target, dummy, "distance", [&](int, const EdgeInfo &e)
+                                                  { return e.id != closed; });
+            double expect = path.empty() ? ReplacementPaths::Inf : pathWeight(path);
+            double got = table.detourLength[i];
+            mismatches += path.empty() ? got != ReplacementPaths::Inf : fabs(got - expect) > 1e-6 * max(1.0, expect) ||
+                                                                            fabs(pathWeight(table.detour[i]) - expect) > 1e-6 * max(1.0, expect);
+            ++segments;
+        }
+    }
+    auto t2 = high_resolution_clock::now();
+    size_t answered = 0;
+    const int rounds = 100;
+    vector<int> route;
+    for (int r = 0; r < rounds; ++r)
+    for (const auto &table : tables)
+    for (int closed : table.pathEdges)
+    answered += table.route([closed](int id)
+                            { return id != closed; }, route);
+    auto t3 = high_resolution_clock::now();
+
+    // Skewed stream: most requests hit a few popular pairs, each with one
+    // random segment of its usual route closed.
+    ReplacementCache cache(64);
+    const int requests = 20000;
+    uniform_int_distribution<int> popular(0, min(pairsCount, 32) - 1), any(0, pairsCount - 1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    size_t fromTable = 0;
+    auto t4 = high_resolution_clock::now();
+    for (int r = 0; r < requests; ++r)
+    {
+        const auto &q = pairs[unit(gen) < 0.8 ? popular(gen) : any(gen)];
+        const ReplacementPaths &usual = tables[&q - pairs.data()];
+        int closed = usual.pathEdges.empty() ? -1 : usual.pathEdges[gen() % usual.pathEdges.size()];
+        const ReplacementPaths *table = cache.lookup(ReplacementCache::key(q.first, q.second, 0), [&]
+                                                     { return graph.replacementPaths(q.first, q.second, "distance"); });
+        if (table && table->route([closed](int id)
+                                  { return id != closed; }, route))
+        ++fromTable;
+        else
+        {
+            dummy.clear();
+            route = graph.dijkstraWith(q.first, q.second, dummy, "distance", [&](int, const EdgeInfo &e)
+                                       { return e.id != closed; });
+        }
+    }
+    auto t5 = high_resolution_clock::now();
+
+    cout << "Batched tables : " << ms(t0, t1) / pairsCount << " ms/pair (" << static_cast<double>(segments) / pairsCount << " segments/route)" << endl;
+    cout << "Dijkstra per segment : " << ms(t1, t2) / max<size_t>(1, segments) << " ms/segment, " << mismatches << " mismatches in " << segments << endl;
+    cout << "Table lookup : " << ms(t2, t3) * 1e6 / max<size_t>(1, segments * rounds) << " ns (" << answered << " of " << segments * rounds << " answered)" << endl;
+    cout << "Request stream : " << ms(t4, t5) * 1000.0 / requests << " us/request, " << 100.0 * fromTable / requests << "% from tables, "
+         << cache.builds() << " tables built, " << cache.size() << " kept" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Johnson reweighting: one SPFA pass for potentials, then signed-fare
+// queries on Dijkstra checked against Bellman-Ford, then incremental
+// potential repair as credits are added.
+int runJohnsonBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(17);
+    uniform_int_distribution<int> pick(0, count - 1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    // Eastbound repositioning credits of 50-110% of the fare on a tenth of
+    // the arcs, so some legs pay the traveller.
+    vector<uint32_t> eastbound;
+    for (size_t id = 0; id < graph.edgeEnds.size(); ++id)
+    {
+        auto [u, v] = graph.edgeEnds[id];
+        uint32_t arc = graph.airports[v].longitude > graph.airports[u].longitude ? 2 * id : 2 * id + 1;
+        eastbound.push_back(arc);
+        if (unit(gen) < 0.1)
+        graph.fareAdjustment[arc] = -(0.5 + 0.6 * unit(gen)) * graph.arcFare(arc);
+    }
+    vector<double> weights;
+    graph.arcFares(nullptr, weights);
+    auto ms = [](auto a, auto b)
+    { return duration<double, milli>(b - a).count(); };
+    auto net = [&](const vector<int> &path)
+    {
+        double total = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        total += graph.arcFare(graph.arcOf(path[i - 1], *graph.findEdge(path[i - 1], path[i])));
+        return total;
+    };
+
+    printLine('=');
+    cout << "JOHNSON REWEIGHTING (" << count << " airports, " << weights.size() << " arcs, signed fares)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    JohnsonReweighting fares;
+    auto t0 = high_resolution_clock::now();
+    bool ok = fares.reset(count, graph.edgeEnds, weights);
+    auto t1 = high_resolution_clock::now();
+    if (!ok)
+    {
+        cout << "Negative fare cycle; nothing to route" << endl;
+        return 1;
+    }
+    size_t negative = count_if(weights.begin(), weights.end(), [](double w)
+                               { return w < 0; });
+    cout << "Potentials (SPFA) : " << ms(t0, t1) << " ms, " << fares.relaxations() << " relaxations, " << negative << " arcs below zero" << endl;
+
+    vector<pair<int, int>> pairs(queries);
+    for (auto &q : pairs)
+    q = {pick(gen), pick(gen)};
+    auto check = [&](size_t limit)
+    {
+        size_t mismatches = 0;
+        double johnsonMs = 0, bellmanMs = 0;
+        vector<pair<int, int>> explored;
+        for (size_t i = 0; i < min(limit, pairs.size()); ++i)
+        {
+            explored.clear();
+            auto a = high_resolution_clock::now();
+            vector<int> fast = graph.dijkstraReweighted(pairs[i].first, pairs[i].second, fares, explored);
+            auto b = high_resolution_clock::now();
+            vector<int> slow = graph.bellmanFord(pairs[i].first, pairs[i].second, weights);
+            auto c = high_resolution_clock::now();
+            double reduced = 0;
+            for (size_t k = 1; k < fast.size(); ++k)
+            reduced += fares.reduced(graph.arcOf(fast[k - 1], *graph.findEdge(fast[k - 1], fast[k])));
+            mismatches += fast.empty() != slow.empty() || fabs(net(fast) - net(slow)) > 1e-6 * max(1.0, fabs(net(slow))) ||
+                          fabs(fares.restore(pairs[i].first, pairs[i].second, reduced) - net(fast)) > 1e-6 * max(1.0, fabs(net(fast)));
+            johnsonMs += ms(a, b);
+            bellmanMs += ms(b, c);
+        }
+        size_t done = min(limit, pairs.size());
+        cout << "  Dijkstra on reduced fares : " << johnsonMs * 1000.0 / done << " us/query" << endl;
+        cout << "  Bellman-Ford per query    : " << bellmanMs * 1000.0 / done << " us/query" << endl;
+        cout << "  Mismatches : " << mismatches << " in " << done << endl;
+        return mismatches;
+    };
+    size_t mismatches = check(pairs.size());
+
+    // New credits one at a time: local repair against a full SPFA pass.
+    const int updates = 200;
+    size_t repaired = 0, rejected = 0;
+    double updateMs = 0;
+    for (int i = 0; i < updates; ++i)
+    {
+        uint32_t arc = eastbound[gen() % eastbound.size()];
+        float previous = graph.fareAdjustment[arc];
+        graph.fareAdjustment[arc] = -(0.5 + 0.6 * unit(gen)) * (graph.arcFare(arc) - previous);
+        auto a = high_resolution_clock::now();
+        bool applied = fares.update(arc, graph.arcFare(arc));
+        updateMs += ms(a, high_resolution_clock::now());
+        if (applied)
+        repaired += fares.lastRepairSize();
+        else
+        {
+            graph.fareAdjustment[arc] = previous;
+            ++rejected;
+        }
+    }
+    graph.arcFares(nullptr, weights);
+    JohnsonReweighting fresh;
+    auto t2 = high_resolution_clock::now();
+    fresh.reset(count, graph.edgeEnds, weights);
+    auto t3 = high_resolution_clock::now();
+    cout << "Incremental update : " << updateMs * 1000.0 / updates << " us/update (" << static_cast<double>(repaired) / updates
+         << " airports re-potentialed, " << rejected << " rejected as cycles) vs " << ms(t2, t3) << " ms full SPFA" << endl;
+    cout << "After updates :" << endl;
+    mismatches += check(min<size_t>(pairs.size(), 50));
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Hop-limited routes: best route with at most 1..k legs from one frontier
+// Bellman-Ford run, against Dijkstra over the graph layered by leg count.
+int runHopLimitBenchmark(int count, int maxLegs)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    mt19937 gen(19);
+    uniform_int_distribution<int> pick(0, count - 1);
+    // Destinations a random walk of maxLegs legs away, so most limits matter.
+    const int queries = 300;
+    vector<pair<int, int>> pairs;
+    for (int q = 0; q < queries; ++q)
+    {
+        int src = pick(gen), at = src;
+        for (int k = 0; k < maxLegs; ++k)
+        at = graph.adj[at][gen() % graph.adj[at].size()].to;
+        pairs.push_back({src, at});
+    }
+    auto ms = [](auto a, auto b)
+    { return duration<double, milli>(b - a).count(); };
+    auto length = [&](const vector<int> &path)
+    {
+        double total = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        total += graph.findEdge(path[i - 1], path[i])->distance;
+        return path.empty() ? numeric_limits<double>::infinity() : total;
+    };
+
+    // Layered baseline: state (v, j) = at v after j legs, j <= maxLegs.
+    auto layered = [&](int src, int dst)
+    {
+        const double inf = numeric_limits<double>::infinity();
+        int layers = maxLegs + 1;
+        vector<double> dist(graph.adj.size() * layers, inf);
+        vector<double> best(maxLegs, inf);
+        using Item = pair<double, int>;
+        priority_queue<Item, vector<Item>, greater<>> pq;
+        dist[src * layers] = 0;
+        pq.push({0, src * layers});
+        int settledTarget = 0;
+        while (!pq.empty() && settledTarget < layers)
+        {
+            auto [d, id] = pq.top();
+            pq.pop();
+            if (d > dist[id])
+            continue;
+            int u = id / layers, j = id % layers;
+            if (u == dst)
+            {
+                ++settledTarget;
+                for (int k = max(j, 1); k <= maxLegs; ++k)
+                best[k - 1] = min(best[k - 1], d);
+            }
+            if (j == maxLegs)
+            continue;
+            for (const auto &e : graph.adj[u])
+            {
+                int next = e.to * layers + j + 1;
+                if (state->isOpen(e.id) && d + e.distance < dist[next])
+                {
+                    dist[next] = d + e.distance;
+                    pq.push({dist[next], next});
+                }
+            }
+        }
+        return best;
+    };
+
+    auto t0 = high_resolution_clock::now();
+    vector<vector<vector<int>>> routes;
+    for (const auto &q : pairs)
+    routes.push_back(graph.hopLimitedRoutes(q.first, q.second, maxLegs, *state));
+    auto t1 = high_resolution_clock::now();
+    vector<vector<double>> expected;
+    for (const auto &q : pairs)
+    expected.push_back(layered(q.first, q.second));
+    auto t2 = high_resolution_clock::now();
+
+    size_t mismatches = 0;
+    vector<size_t> reachable(maxLegs, 0);
+    for (int q = 0; q < queries; ++q)
+    {
+        for (int k = 0; k < maxLegs; ++k)
+        {
+            double got = length(routes[q][k]);
+            bool bad = routes[q][k].size() > static_cast<size_t>(k + 2) || (got == numeric_limits<double>::infinity()) != (expected[q][k] == numeric_limits<double>::infinity()) ||
+                       (got != numeric_limits<double>::infinity() && fabs(got - expected[q][k]) > 1e-6 * max(1.0, expected[q][k]));
+            mismatches += bad;
+            reachable[k] += !routes[q][k].empty();
+        }
+    }
+
+    printLine('=');
+    cout << "HOP-LIMITED ROUTES (" << count << " airports, " << graph.edgeEnds.size() << " edges, up to " << maxLegs << " legs)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Frontier rounds : " << ms(t0, t1) * 1000.0 / queries << " us/query for all limits" << endl;
+    cout << "Layered Dijkstra : " << ms(t1, t2) * 1000.0 / queries << " us/query" << endl;
+    cout << "Reachable within k legs :";
+    for (int k = 0; k < maxLegs; ++k)
+    cout << " " << k + 1 << ":" << 100.0 * reachable[k] / queries << "%";
+    cout << endl;
+    cout << "Mismatches : " << mismatches << " in " << queries * maxLegs << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Resource-constrained routes: fastest within a fare budget and cheapest
+// within a block-time limit, checked on a few queries against an exact
+// dynamic program over whole-dollar fares.
+int runConstrainedBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    ConstrainedRouter router(count, graph.edgeEnds);
+    mt19937 gen(23);
+    uniform_int_distribution<int> pick(0, count - 1);
+    auto total = [&](const vector<int> &path, const string &metric)
+    {
+        double sum = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            const EdgeInfo *e = graph.findEdge(path[i - 1], path[i]);
+            sum += metric == "distance" ? e->distance : metric == "cost" ? e->cost : e->time;
+        }
+        return sum;
+    };
+    // Exact: least time to reach each airport having spent exactly b dollars.
+    auto exactFastest = [&](int src, int dst, int budget)
+    {
+        const double inf = numeric_limits<double>::infinity();
+        vector<vector<double>> best(budget + 1, vector<double>(count, inf));
+        best[0][src] = 0;
+        double answer = inf;
+        for (int b = 0; b <= budget; ++b)
+        {
+            for (int u = 0; u < count; ++u)
+            {
+                if (best[b][u] == inf)
+                continue;
+                for (const auto &e : graph.adj[u])
+                {
+                    int nb = b + static_cast<int>(e.cost);
+                    if (nb <= budget)
+                    best[nb][e.to] = min(best[nb][e.to], best[b][u] + e.time);
+                }
+            }
+            answer = min(answer, best[b][dst]);
+        }
+        return answer;
+    };
+
+    printLine('=');
+    cout << "RESOURCE-CONSTRAINED ROUTES (" << count << " airports, " << graph.edgeEnds.size() << " edges)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    size_t mismatches = 0;
+    struct Kind
+    {
+        string minimize, limit;
+        double slack;
+    };
+    for (const Kind &kind : {Kind{"time", "cost", 1.15}, Kind{"time", "cost", 1.5}, Kind{"cost", "time", 1.1}, Kind{"cost", "time", 1.3}})
+    {
+        double ms = 0, worst = 0;
+        size_t labels = 0, found = 0, binding = 0, checked = 0, exhausted = 0;
+        for (int q = 0; q < queries; ++q)
+        {
+            int src = pick(gen), dst = pick(gen);
+            vector<int> tightest = graph.dijkstra(src, dst, *state, kind.limit);
+            vector<int> free = graph.dijkstra(src, dst, *state, kind.minimize);
+            if (tightest.empty())
+            continue;
+            double budget = floor(total(tightest, kind.limit) * kind.slack);
+            binding += total(free, kind.limit) > budget;
+            auto a = high_resolution_clock::now();
+            ConstrainedRouter::Result r = graph.constrainedRoute(router, src, dst, kind.minimize, kind.limit, budget, *state);
+            double took = duration<double, milli>(high_resolution_clock::now() - a).count();
+            ms += took;
+            worst = max(worst, took);
+            labels += r.labels;
+            found += !r.path.empty();
+            // Past the per-query label limit there is no answer to check.
+            exhausted += r.exhausted;
+            if (r.exhausted)
+            continue;
+            mismatches += r.path.empty() || total(r.path, kind.limit) > budget + 1e-9 ||
+                          fabs(total(r.path, kind.minimize) - r.primary) > 1e-6 * max(1.0, r.primary);
+            if (kind.minimize == "time" && checked < 5)
+            {
+                ++checked;
+                mismatches += fabs(exactFastest(src, dst, static_cast<int>(budget)) - r.primary) > 1e-6 * max(1.0, r.primary);
+            }
+        }
+        cout << kind.minimize << " within " << kind.limit << " x" << kind.slack << " : " << ms / queries << " ms/query (worst " << worst << "), "
+             << labels / max(1, queries) << " labels, constraint binding in " << binding << "/" << queries << ", found " << found << ", exhausted " << exhausted << endl;
+    }
+    cout << "Mismatches (incl. exact DP on 5 fare-budget queries each) : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Multi-city itineraries: visiting orders checked against brute force over
+// every permutation for small trips, then the subset DP timed on one thread
+// and on all of them, and the heuristic used above the exact limit compared
+// with the exact order.
+int runItineraryBenchmark(int count, int stops)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    const int threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    mt19937 gen(31);
+    uniform_int_distribution<int> pick(0, count - 1);
+    auto ms = [](auto a, auto b)
+    { return duration<double, milli>(b - a).count(); };
+    auto length = [&](const vector<int> &path)
+    {
+        double sum = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        sum += graph.findEdge(path[i - 1], path[i])->cost;
+        return sum;
+    };
+    auto trip = [&](int size)
+    {
+        vector<int> chosen;
+        while (static_cast<int>(chosen.size()) < size + 1)
+        {
+            int a = pick(gen);
+            if (find(chosen.begin(), chosen.end(), a) == chosen.end())
+            chosen.push_back(a);
+        }
+        return chosen;
+    };
+    // An unreachable leg is infinite, as in planItinerary.
+    auto legs = [&](const vector<int> &chosen)
+    {
+        vector<vector<double>> leg(chosen.size(), vector<double>(chosen.size(), 0));
+        for (size_t i = 0; i < chosen.size(); ++i)
+        for (size_t j = 0; j < chosen.size(); ++j)
+        if (i != j)
+        {
+            vector<int> hop = graph.dijkstra(chosen[i], chosen[j], *state, "cost");
+            leg[i][j] = hop.empty() ? numeric_limits<double>::infinity() : length(hop);
+        }
+        return leg;
+    };
+
+    printLine('=');
+    cout << "MULTI-CITY ITINERARIES (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << threads << " threads)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+
+    size_t mismatches = 0, trips = 0, unreachable = 0;
+    for (int size = 2; size <= 7; ++size)
+    {
+        for (int t = 0; t < 4; ++t, ++trips)
+        {
+            vector<int> chosen = trip(size), path;
+            TourPlan plan = graph.planItinerary(chosen, *state, "cost", path, threads);
+            vector<vector<double>> leg = legs(chosen);
+            vector<int> order(size);
+            iota(order.begin(), order.end(), 1);
+            double best = numeric_limits<double>::infinity();
+            do
+            {
+                double sum = leg[0][order.front()] + leg[order.back()][0];
+                for (int i = 1; i < size; ++i)
+                sum += leg[order[i - 1]][order[i]];
+                best = min(best, sum);
+            } while (next_permutation(order.begin(), order.end()));
+            // No round trip exists: the plan must say so with an empty path.
+            if (best == numeric_limits<double>::infinity())
+            {
+                ++unreachable;
+                mismatches += !plan.order.empty() || !path.empty();
+                continue;
+            }
+            mismatches += path.empty() || !plan.exact || fabs(plan.cost - best) > 1e-6 * best || fabs(length(path) - best) > 1e-6 * best ||
+                          path.front() != chosen[0] || path.back() != chosen[0];
+        }
+    }
+    cout << "Brute-force checks : " << trips << " trips of 2-7 stops, " << unreachable << " with an unreachable stop" << endl;
+
+    // The timed trip is drawn again until every stop is reachable, so the
+    // solvers have a tour to agree on.
+    vector<int> chosen, path;
+    vector<vector<double>> leg;
+    for (int attempt = 0; attempt < 20; ++attempt)
+    {
+        chosen = trip(stops);
+        leg = legs(chosen);
+        bool connected = true;
+        for (const auto &row : leg)
+        connected = connected && *max_element(row.begin(), row.end()) != numeric_limits<double>::infinity();
+        if (connected)
+        break;
+    }
+    auto a = high_resolution_clock::now();
+    TourPlan plan = graph.planItinerary(chosen, *state, "cost", path, threads);
+    auto b = high_resolution_clock::now();
+    leg = legs(chosen);
+    auto c = high_resolution_clock::now();
+    TourPlan serial = planTour(leg, 1);
+    auto d = high_resolution_clock::now();
+    TourPlan parallel = planTour(leg, threads);
+    auto e = high_resolution_clock::now();
+    TourPlan heuristic = planTour(leg, 1, 0);
+    auto f = high_resolution_clock::now();
+    mismatches += fabs(serial.cost - parallel.cost) > 1e-6 * serial.cost || fabs(plan.cost - serial.cost) > 1e-6 * serial.cost;
+    cout << "Full plan, " << stops << " stops : " << ms(a, b) << " ms (" << path.size() << " airports)" << endl;
+    cout << "Held-Karp, 1 thread : " << ms(c, d) << " ms" << endl;
+    cout << "Held-Karp, " << threads << " threads : " << ms(d, e) << " ms" << endl;
+    cout << "Heuristic : " << ms(e, f) << " ms, " << 100.0 * (heuristic.cost / serial.cost - 1) << "% above exact" << endl;
+    cout << "Mismatches : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Metro-area queries: every airport within a radius of two random centres,
+// with random access costs, answered by one multi-source search and checked
+// against the best of all |S| x |T| single-pair searches.
+int runMetroBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    mt19937 gen(37);
+    uniform_int_distribution<int> pick(0, count - 1);
+    uniform_real_distribution<double> access(0.0, 60.0);
+    auto metro = [&](int centre)
+    {
+        vector<pair<int, double>> out = {{centre, access(gen)}};
+        for (int a = 0; a < count && out.size() < 6; ++a)
+        if (a != centre && graph.geo.distanceKm(a, centre) < 250.0)
+        out.push_back({a, access(gen)});
+        return out;
+    };
+    auto cost = [&](const vector<int> &path)
+    {
+        double sum = 0;
+        for (size_t i = 1; i < path.size(); ++i)
+        sum += graph.findEdge(path[i - 1], path[i])->cost;
+        return sum;
+    };
+    vector<pair<vector<pair<int, double>>, vector<pair<int, double>>>> sets;
+    size_t pairs = 0;
+    for (int q = 0; q < queries; ++q)
+    {
+        sets.push_back({metro(pick(gen)), metro(pick(gen))});
+        pairs += sets.back().first.size() * sets.back().second.size();
+    }
+
+    auto t0 = high_resolution_clock::now();
+    vector<FlightGraph::MultiRoute> multi;
+    size_t settled = 0;
+    for (const auto &[from, to] : sets)
+    {
+        multi.push_back(graph.multiRoute(from, to, *state, "cost"));
+        settled += multi.back().settled;
+    }
+    auto t1 = high_resolution_clock::now();
+    vector<double> expected;
+    for (const auto &[from, to] : sets)
+    {
+        double best = numeric_limits<double>::infinity();
+        for (const auto &[s, in] : from)
+        {
+            for (const auto &[t, out] : to)
+            {
+                vector<int> path = graph.dijkstra(s, t, *state, "cost");
+                if (!path.empty())
+                best = min(best, in + cost(path) + out);
+            }
+        }
+        expected.push_back(best);
+    }
+    auto t2 = high_resolution_clock::now();
+
+    size_t mismatches = 0;
+    for (int q = 0; q < queries; ++q)
+    {
+        const FlightGraph::MultiRoute &r = multi[q];
+        double in = 0, out = 0;
+        for (const auto &[s, c] : sets[q].first)
+        if (s == r.source)
+        in = c;
+        for (const auto &[t, c] : sets[q].second)
+        if (t == r.target)
+        out = c;
+        mismatches += fabs(r.value - expected[q]) > 1e-6 * max(1.0, expected[q]) || fabs(in + cost(r.path) + out - r.value) > 1e-6 * max(1.0, r.value);
+    }
+
+    printLine('=');
+    cout << "METRO-AREA QUERIES (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << queries << " queries)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Airport pairs per query : " << static_cast<double>(pairs) / queries << endl;
+    cout << "One multi-source search : " << duration<double, milli>(t1 - t0).count() * 1000.0 / queries << " us/query, "
+         << settled / queries << " airports settled" << endl;
+    cout << "Every pair separately : " << duration<double, milli>(t2 - t1).count() * 1000.0 / queries << " us/query" << endl;
+    cout << "Mismatches : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Disjoint backup routes: Suurballe pairs checked for disjointness and
+// against successive shortest paths with Bellman-Ford on the residual graph,
+// and compared with the usual shortest route plus a second search that
+// avoids its segments.
+int runDisjointBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    DisjointPaths engine(count, graph.edgeEnds);
+    const int threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    const double inf = numeric_limits<double>::infinity();
+    vector<double> weights;
+    graph.edgeWeights("distance", state.get(), weights, false);
+    mt19937 gen(41);
+    uniform_int_distribution<int> pick(0, count - 1);
+    vector<pair<int, int>> itineraries;
+    while (static_cast<int>(itineraries.size()) < queries)
+    {
+        int a = pick(gen), b = pick(gen);
+        if (a != b)
+        itineraries.push_back({a, b});
+    }
+    auto valid = [&](const vector<int> &path, const vector<int> &ids, double length)
+    {
+        double sum = 0;
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            auto [u, v] = graph.edgeEnds[ids[i]];
+            if (!((u == path[i] && v == path[i + 1]) || (v == path[i] && u == path[i + 1])))
+            return false;
+            sum += weights[ids[i]];
+        }
+        return ids.size() + 1 == path.size() && fabs(sum - length) <= 1e-6 * max(1.0, length);
+    };
+    // Two units of flow by successive shortest paths: Bellman-Ford (SPFA)
+    // from s, then again with the first route's arcs reversed at -w.
+    auto flowTotal = [&](int s, int t)
+    {
+        double total = 0;
+        vector<char> forward(2 * graph.edgeEnds.size(), 0); // arc 2e: first->second
+        for (int round = 0; round < 2; ++round)
+        {
+            vector<double> dist(count, inf);
+            vector<int> via(count, -1);
+            vector<char> queued(count, 0);
+            deque<int> work = {s};
+            dist[s] = 0;
+            while (!work.empty())
+            {
+                int u = work.front();
+                work.pop_front();
+                queued[u] = 0;
+                for (const auto &e : graph.adj[u])
+                {
+                    int arc = 2 * e.id + (graph.edgeEnds[e.id].first == u ? 0 : 1);
+                    if (forward[arc] || weights[e.id] == inf)
+                    continue;
+                    double w = forward[arc ^ 1] ? -weights[e.id] : weights[e.id];
+                    if (dist[u] + w < dist[e.to] - 1e-9)
+                    {
+                        dist[e.to] = dist[u] + w;
+                        via[e.to] = arc;
+                        if (!queued[e.to])
+                        {
+                            queued[e.to] = 1;
+                            work.push_back(e.to);
+                        }
+                    }
+                }
+            }
+            if (dist[t] == inf)
+            return round == 0 ? inf : -total;
+            total += dist[t];
+            for (int v = t; v != s;)
+            {
+                int arc = via[v];
+                if (forward[arc ^ 1])
+                forward[arc ^ 1] = 0;
+                else
+                forward[arc] = 1;
+                v = arc & 1 ? graph.edgeEnds[arc / 2].second : graph.edgeEnds[arc / 2].first;
+            }
+        }
+        return total;
+    };
+
+    auto t0 = high_resolution_clock::now();
+    vector<DisjointPair> pairs = engine.routeAll(itineraries, weights, false, threads);
+    auto t1 = high_resolution_clock::now();
+    vector<DisjointPair> airportPairs = engine.routeAll(itineraries, weights, true, threads);
+    auto t2 = high_resolution_clock::now();
+    vector<double> naiveTotal;
+    for (const auto &[s, t] : itineraries)
+    {
+        vector<pair<int, int>> explored;
+        vector<int> first = graph.dijkstra(s, t, *state, "distance");
+        vector<char> avoid(graph.edgeEnds.size(), 0);
+        double total = 0;
+        for (size_t i = 1; i < first.size(); ++i)
+        {
+            const EdgeInfo *e = graph.findEdge(first[i - 1], first[i]);
+            avoid[e->id] = 1;
+            total += e->distance;
+        }
+        vector<int> second = graph.dijkstraWith(s, t, explored, "distance", [&](int, const EdgeInfo &e)
+                                                { return state->isOpen(e.id) && !avoid[e.id]; });
+        for (size_t i = 1; i < second.size(); ++i)
+        total += graph.findEdge(second[i - 1], second[i])->distance;
+        naiveTotal.push_back(second.empty() ? inf : total);
+    }
+    auto t3 = high_resolution_clock::now();
+
+    size_t mismatches = 0, found = 0, naiveFound = 0, better = 0, checked = 0, unreachable = 0;
+    double saved = 0;
+    for (int q = 0; q < queries; ++q)
+    {
+        const DisjointPair &r = pairs[q], &a = airportPairs[q];
+        // No route at all: both searches must agree, and there is no pair
+        // to check.
+        if (r.primary.empty() || a.primary.empty())
+        {
+            ++unreachable;
+            mismatches += r.primary.empty() != a.primary.empty() || !graph.dijkstra(itineraries[q].first, itineraries[q].second, *state).empty();
+            continue;
+        }
+        mismatches += !valid(r.primary, r.primaryEdges, r.primaryLength) || (!r.backup.empty() && !valid(r.backup, r.backupEdges, r.backupLength));
+        mismatches += !valid(a.primary, a.primaryEdges, a.primaryLength) || (!a.backup.empty() && !valid(a.backup, a.backupEdges, a.backupLength));
+        set<int> edgesUsed(r.primaryEdges.begin(), r.primaryEdges.end());
+        for (int e : r.backupEdges)
+        mismatches += !edgesUsed.insert(e).second;
+        set<int> airportsUsed(a.primary.begin() + 1, a.primary.end() - 1);
+        for (size_t i = 1; i + 1 < a.backup.size(); ++i)
+        mismatches += !airportsUsed.insert(a.backup[i]).second;
+        double total = r.backup.empty() ? inf : r.primaryLength + r.backupLength;
+        mismatches += a.backup.empty() ? false : a.primaryLength + a.backupLength < total - 1e-6;
+        found += !r.backup.empty();
+        naiveFound += naiveTotal[q] != inf;
+        mismatches += naiveTotal[q] < total - 1e-6 * total;
+        if (total < naiveTotal[q] - 1e-6 * total)
+        {
+            ++better;
+            if (naiveTotal[q] != inf)
+            saved += naiveTotal[q] - total;
+        }
+        if (checked < 20)
+        {
+            ++checked;
+            double expected = flowTotal(itineraries[q].first, itineraries[q].second);
+            mismatches += expected < 0 ? !r.backup.empty() : fabs(expected - total) > 1e-6 * max(1.0, expected);
+        }
+    }
+
+    printLine('=');
+    cout << "DISJOINT BACKUP ROUTES (" << count << " airports, " << graph.edgeEnds.size() << " edges, " << queries << " itineraries, " << threads << " threads)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Segment-disjoint pairs : " << duration<double, milli>(t1 - t0).count() * 1000.0 / queries << " us/itinerary, found for " << found << ", " << unreachable << " unreachable" << endl;
+    cout << "Airport-disjoint pairs : " << duration<double, milli>(t2 - t1).count() * 1000.0 / queries << " us/itinerary" << endl;
+    cout << "Shortest + avoid-and-retry : " << duration<double, milli>(t3 - t2).count() * 1000.0 / queries << " us/itinerary, found for " << naiveFound << endl;
+    cout << "Pairs cheaper than avoid-and-retry : " << better << " (" << (better ? saved / better : 0.0) << " km saved on average where both exist)" << endl;
+    cout << "Mismatches (incl. Bellman-Ford flow check on " << checked << ") : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Passenger flow after a weather event: a tenth of the segments closed and
+// demand concentrated on a few busy origins and destinations, assigned by
+// PassengerFlow and compared with rerouting every passenger independently
+// on the shortest open route.
+int runFlowBenchmark(int count, int passengers)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(43);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t e = 0; e < graph.edgeEnds.size(); ++e)
+    if (unit(gen) < 0.1)
+    graph.edgeAvailable[e] = false;
+    for (int &seats : graph.arcSeats)
+    seats = 40 + static_cast<int>(unit(gen) * 100);
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    PassengerFlow engine(count, graph.edgeEnds);
+
+    uniform_int_distribution<int> pick(0, count - 1);
+    vector<int> busy(60);
+    for (int &a : busy)
+    a = pick(gen);
+    uniform_int_distribution<int> busyPick(0, busy.size() - 1);
+    map<pair<int, int>, int> od;
+    for (int p = 0; p < passengers; ++p)
+    {
+        int a = unit(gen) < 0.7 ? busy[busyPick(gen)] : pick(gen);
+        int b = unit(gen) < 0.7 ? busy[busyPick(gen)] : pick(gen);
+        if (a != b)
+        ++od[{a, b}];
+        else
+        --p;
+    }
+    vector<PassengerDemand> demands;
+    for (const auto &[key, n] : od)
+    demands.push_back({key.first, key.second, n});
+
+    auto t0 = high_resolution_clock::now();
+    FlowAssignment flow = graph.assignPassengers(engine, demands, *state, "time");
+    auto t1 = high_resolution_clock::now();
+    vector<int> independentLoad(graph.arcSeats.size(), 0);
+    double independentCost = 0;
+    for (const PassengerDemand &d : demands)
+    {
+        vector<int> path = graph.dijkstra(d.origin, d.destination, *state, "time");
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            const EdgeInfo *e = graph.findEdge(path[i - 1], path[i]);
+            independentLoad[graph.arcOf(path[i - 1], *e)] += d.passengers;
+            independentCost += e->time * d.passengers;
+        }
+    }
+    auto t2 = high_resolution_clock::now();
+
+    size_t mismatches = 0;
+    long long overbooked = 0, grouped = 0;
+    vector<int> load(graph.arcSeats.size(), 0);
+    for (const auto &g : flow.groups)
+    {
+        grouped += g.passengers;
+        mismatches += g.path.front() != g.origin || g.path.back() != g.destination;
+        for (size_t i = 1; i < g.path.size(); ++i)
+        {
+            const EdgeInfo *e = graph.findEdge(g.path[i - 1], g.path[i]);
+            if (!e || !state->isOpen(e->id))
+            {
+                ++mismatches;
+                continue;
+            }
+            load[graph.arcOf(g.path[i - 1], *e)] += g.passengers;
+        }
+    }
+    for (size_t a = 0; a < load.size(); ++a)
+    {
+        mismatches += load[a] != flow.arcLoad[a] || load[a] > graph.arcSeats[a];
+        overbooked += max(0, independentLoad[a] - graph.arcSeats[a]);
+    }
+    mismatches += grouped != flow.served || flow.served + flow.stranded != passengers;
+
+    printLine('=');
+    cout << "PASSENGER FLOW (" << count << " airports, " << graph.edgeEnds.size() << " edges, 10% closed, " << passengers << " passengers, "
+         << demands.size() << " origin-destination pairs)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Flow assignment : " << duration<double, milli>(t1 - t0).count() << " ms, " << flow.searches << " searches, " << flow.groups.size() << " path groups" << endl;
+    cout << "Served : " << flow.served << ", stranded : " << flow.stranded << endl;
+    cout << "Average block time : " << flow.cost / max(1LL, flow.served) << " min (unconstrained " << independentCost / passengers << ")" << endl;
+    cout << "Independent rerouting : " << duration<double, milli>(t2 - t1).count() << " ms, " << overbooked << " seats overbooked" << endl;
+    cout << "Mismatches : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Isochrones at a few block-time bounds: the bounded search on this
+// thread's reused workspace, the same search with a fresh workspace per
+// query, and a full one-to-all Dijkstra filtered to the bound, which also
+// checks the reachable sets and values.
+int runIsochroneBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(47);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t e = 0; e < graph.edgeEnds.size(); ++e)
+    if (unit(gen) < 0.05)
+    graph.edgeAvailable[e] = false;
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    uniform_int_distribution<int> pick(0, count - 1);
+    vector<int> sources(queries);
+    for (int &s : sources)
+    s = pick(gen);
+    const double inf = numeric_limits<double>::infinity();
+    auto full = [&](int src)
+    {
+        vector<double> dist(count, inf);
+        using PDI = pair<double, int>;
+        priority_queue<PDI, vector<PDI>, greater<>> pq;
+        dist[src] = 0;
+        pq.push({0, src});
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > dist[u])
+            continue;
+            for (const auto &e : graph.adj[u])
+            if (state->isOpen(e.id) && d + e.time < dist[e.to])
+            {
+                dist[e.to] = d + e.time;
+                pq.push({dist[e.to], e.to});
+            }
+        }
+        return dist;
+    };
+
+    printLine('=');
+    cout << "ISOCHRONES (" << count << " airports, " << graph.edgeEnds.size() << " edges, 5% closed, " << queries << " queries per bound)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    size_t mismatches = 0;
+    for (double bound : {60.0, 120.0, 240.0})
+    {
+        size_t reached = 0;
+        auto t0 = high_resolution_clock::now();
+        vector<Isochrone> results;
+        for (int s : sources)
+        results.push_back(graph.isochrone(s, bound, *state, "time"));
+        auto t1 = high_resolution_clock::now();
+        vector<Isochrone> freshResults;
+        for (int s : sources)
+        {
+            BoundedSearch fresh;
+            freshResults.push_back(fresh.run(count, s, bound, [&](int u, auto relax)
+                                             {
+                for (const auto &e : graph.adj[u])
+                if (state->isOpen(e.id))
+                relax(e.to, e.time); }));
+            reached += freshResults.back().airports.size();
+        }
+        auto t2 = high_resolution_clock::now();
+        for (int q = 0; q < queries; ++q)
+        {
+            vector<double> dist = full(sources[q]);
+            size_t within = count_if(dist.begin(), dist.end(), [&](double d)
+                                     { return d <= bound; });
+            const Isochrone &iso = results[q];
+            mismatches += within != iso.airports.size();
+            for (size_t i = 0; i < iso.airports.size(); ++i)
+            {
+                mismatches += fabs(dist[iso.airports[i]] - iso.value[i]) > 1e-6;
+                if (iso.parent[i] >= 0)
+                {
+                    const EdgeInfo *e = graph.findEdge(iso.parent[i], iso.airports[i]);
+                    mismatches += !e || fabs(dist[iso.parent[i]] + e->time - iso.value[i]) > 1e-6;
+                }
+            }
+        }
+        auto t3 = high_resolution_clock::now();
+        cout << "Within " << setw(3) << static_cast<int>(bound) << " min : " << static_cast<double>(reached) / queries << " airports, reused workspace "
+             << duration<double, micro>(t1 - t0).count() / queries << " us, fresh workspace " << duration<double, micro>(t2 - t1).count() / queries
+             << " us, full Dijkstra " << duration<double, micro>(t3 - t2).count() / queries << " us" << endl;
+    }
+    cout << "Mismatches : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+int runAnytimeBenchmark(int count, int queries)
+{
+    using namespace std::chrono;
+    FlightGraph graph = buildSyntheticNetwork(count, 7);
+    mt19937 gen(53);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t e = 0; e < graph.edgeEnds.size(); ++e)
+    if (unit(gen) < 0.05)
+    graph.edgeAvailable[e] = false;
+    unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+    uniform_int_distribution<int> pick(0, count - 1);
+    vector<pair<int, int>> pairs(queries);
+    for (auto &[s, t] : pairs)
+    s = pick(gen), t = pick(gen);
+
+    // Optimal travel times, by plain Dijkstra stopping at t.
+    const double inf = numeric_limits<double>::infinity();
+    vector<double> optimal;
+    auto t0 = high_resolution_clock::now();
+    for (auto [s, t] : pairs)
+    {
+        vector<double> dist(count, inf);
+        using PDI = pair<double, int>;
+        priority_queue<PDI, vector<PDI>, greater<>> pq;
+        dist[s] = 0;
+        pq.push({0, s});
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (u == t)
+            break;
+            if (d > dist[u])
+            continue;
+            for (const auto &e : graph.adj[u])
+            if (state->isOpen(e.id) && d + e.time < dist[e.to])
+            {
+                dist[e.to] = d + e.time;
+                pq.push({dist[e.to], e.to});
+            }
+        }
+        optimal.push_back(dist[t]);
+    }
+    auto t1 = high_resolution_clock::now();
+    for (auto [s, t] : pairs)
+    graph.astar(s, t, *state, "time");
+    auto t2 = high_resolution_clock::now();
+
+    printLine('=');
+    cout << "ANYTIME A* (" << count << " airports, " << graph.edgeEnds.size() << " edges, 5% closed, " << queries << " queries, time metric)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Dijkstra : " << duration<double, micro>(t1 - t0).count() / queries << " us per query" << endl;
+    cout << "A*       : " << duration<double, micro>(t2 - t1).count() / queries << " us per query" << endl;
+    size_t mismatches = 0;
+    for (double budget : {0.1, 0.2, 0.5, 1000.0})
+    {
+        size_t found = 0, cutOff = 0, expansions = 0;
+        int iterations = 0;
+        double bounds = 0, excess = 0, worst = 1, spent = 0;
+        for (int q = 0; q < queries; ++q)
+        {
+            auto [s, t] = pairs[q];
+            auto start = steady_clock::now();
+            AnytimeRoute r = graph.anytimeRoute(s, t, *state, "time", start + microseconds(static_cast<long long>(budget * 1000)));
+            spent += duration<double, micro>(steady_clock::now() - start).count();
+            cutOff += r.timedOut;
+            iterations += r.iterations;
+            expansions += r.expansions;
+            if (optimal[q] == inf)
+            {
+                mismatches += !r.path.empty();
+                continue;
+            }
+            if (r.path.empty())
+            {
+                // Only a search cut off early may come back empty.
+                mismatches += !r.timedOut;
+                continue;
+            }
+            ++found;
+            double ratio = optimal[q] > 0 ? r.length / optimal[q] : 1;
+            bounds += r.bound;
+            excess += ratio;
+            worst = max(worst, ratio);
+            // The bound must hold, and an unhurried search must be exact.
+            mismatches += r.length > r.bound * optimal[q] + 1e-6;
+            mismatches += !r.timedOut && r.bound == 1 && fabs(r.length - optimal[q]) > 1e-6;
+            mismatches += r.path.front() != s || r.path.back() != t;
+        }
+        cout << "Deadline " << setw(7) << budget << " ms : " << found << " found, " << cutOff << " cut off, " << spent / queries << " us, "
+             << static_cast<double>(iterations) / queries << " iterations, " << static_cast<double>(expansions) / queries << " expansions, bound "
+             << setprecision(3) << (found ? bounds / found : 0) << "x, actual " << (found ? excess / found : 0) << "x (worst " << worst << "x)"
+             << setprecision(2) << endl;
+    }
+    cout << "Mismatches : " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+int runGeodesicBenchmark(int count)
+{
+    vector<Airport> airports = generateSyntheticAirports(count, 42);
+    GeoPoints geo;
+    for (const auto &ap : airports)
+    geo.add(ap.latitude, ap.longitude);
+
+    using namespace std::chrono;
+    int sources = min(count, 256);
+    double checksum = 0.0;
+    vector<double> row(count);
+
+    auto t0 = high_resolution_clock::now();
+    for (int s = 0; s < sources; ++s)
+    {
+        for (int j = 0; j < count; ++j)
+        row[j] = haversine(airports[s].latitude, airports[s].longitude, airports[j].latitude, airports[j].longitude);
+        checksum += row[count - 1];
+    }
+    auto t1 = high_resolution_clock::now();
+    for (int s = 0; s < sources; ++s)
+    {
+        geo.distancesKm(geo.at(s), 0, count, row.data());
+        checksum -= row[count - 1];
+    }
+    auto t2 = high_resolution_clock::now();
+    size_t inRange = 0;
+    vector<int> hits;
+    for (int s = 0; s < sources; ++s)
+    {
+        hits.clear();
+        geo.within(geo.at(s), 800.0, hits);
+        inRange += hits.size();
+    }
+    auto t3 = high_resolution_clock::now();
+
+    double pairs = double(sources) * count;
+    auto nsPerPair = [&](high_resolution_clock::time_point a, high_resolution_clock::time_point b)
+    { return duration<double, nano>(b - a).count() / pairs; };
+
+    printLine('=');
+    cout << "GEODESIC KERNELS (" << count << " airports, kernel: " << geodesicKernelName() << ")" << endl;
+    printLine('=');
+    cout << fixed << setprecision(2);
+    cout << "Scalar haversine : " << nsPerPair(t0, t1) << " ns/pair" << endl;
+    cout << "Batch distance km : " << nsPerPair(t1, t2) << " ns/pair" << endl;
+    cout << "Batch radius test : " << nsPerPair(t2, t3) << " ns/pair (" << inRange / sources << " airports within 800 km on average)" << endl;
+    cout << "Checksum drift : " << checksum << " km" << endl;
+    return 0;
+}
+
+nlohmann::json routeToJson(const FlightGraph &graph, const vector<int> &path)
+{
+    nlohmann::json j;
+    vector<string> codes;
+    double totalDistance = 0.0, totalCost = 0.0, totalTime = 0.0;
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        codes.push_back(graph.airports[path[i]].code);
+        if (i > 0)
+        {
+            const EdgeInfo *e = graph.findEdge(path[i - 1], path[i]);
+            if (e)
+            {
+                totalDistance += e->distance;
+                totalCost += e->cost;
+                totalTime += e->time;
+            }
+        }
+    }
+    j["found"] = !path.empty();
+    j["path"] = codes;
+    j["distance"] = totalDistance;
+    j["cost"] = totalCost;
+    j["time"] = totalTime;
+    return j;
+}
+
+nlohmann::json disjointToJson(const FlightGraph &graph, const DisjointPair &routes)
+{
+    nlohmann::json j;
+    j["primary"] = routeToJson(graph, routes.primary);
+    j["backup"] = routeToJson(graph, routes.backup);
+    j["disjoint"] = !routes.backup.empty();
+    return j;
+}
+
+struct RouteService
+{
+    FlightGraph graph;
+    FlightGraph allOpenGraph;
+    unordered_map<string, int> codeIndex;
+    vector<char> airportClosed;
+    // Bumped on every published weather change so clients can tell their
+    // cached routes predate it. Writer-side; readers take it from edgeState.
+    uint64_t weatherVersion = 0;
+    WeatherFeed feed;
+    // What route queries read: the graph's live flags are writer-only.
+    SnapshotCell<EdgeState> edgeState;
+    // Penalty-aware routing (algo=cch): one hierarchy, re-customized per
+    // metric the first time it is queried after a weather version change.
+    // It is the only algorithm that weighs penalties; /route reports the
+    // penalties on every route so the difference is visible.
+    CustomizableCH hierarchy;
+    struct CchMetric
+    {
+        string name;
+        uint64_t version = 0;
+        CustomizableCH::Metric metric;
+    };
+    vector<CchMetric> cchMetrics = {{"distance", 0, {}}, {"cost", 0, {}}, {"time", 0, {}}};
+    // A structure built for one metric over one closure set, rebuilt on a
+    // background thread once the snapshot being queried has other closures.
+    // Versions that leave the closures alone (penalties, fares) keep it.
+    // Until the rebuild lands, current() returns null and the caller answers
+    // with a plain search, so no request waits for a build.
+    template <typename T>
+    struct Rebuilt
+    {
+        string name;
+        uint64_t key = 0; // closureHash of what `ready` was built for
+        shared_ptr<const T> ready;
+        uint64_t buildingKey = 0;
+        future<shared_ptr<const T>> building;
+
+        template <typename Build>
+        const T *current(const EdgeState &state, uint64_t want, Build build)
+        {
+            if (building.valid() && building.wait_for(chrono::seconds(0)) == future_status::ready)
+            {
+                ready = building.get();
+                key = buildingKey;
+            }
+            if (ready && key == want)
+            return ready.get();
+            if (!building.valid())
+            {
+                buildingKey = want;
+                building = async(launch::async, [build, copy = state]()
+                                 { return build(copy); });
+            }
+            return nullptr;
+        }
+    };
+    // Hash of the newest snapshot's closures, computed once per version.
+    uint64_t keyVersion = 0, versionKey = 0;
+    // Goal-directed pruning (algo=arcflags): flags per metric over the
+    // closures of the snapshot being queried.
+    vector<int> flagRegions;
+    vector<Rebuilt<ArcFlags>> arcFlags = vector<Rebuilt<ArcFlags>>(3);
+    // Distance oracle (/distance): hub labels per metric over the hierarchy
+    // order. Each build is saved to hub_labels_<metric>.bin (prefix from
+    // AEROROUTE_HUB_LABELS) and queried from the mapped file, which also
+    // serves the next start when network and closures match.
+    vector<int> labelOrder;
+    vector<Rebuilt<HubLabels>> hubLabels = vector<Rebuilt<HubLabels>>(3);
+    // Reroutes (/reroute): replacement-path tables over the weather-free
+    // network for the origin-destination pairs asked for most often.
+    ReplacementCache replacements;
+    // Signed fares (algo=johnson): potentials over the live closures and fare
+    // adjustments, repaired edge by edge as either changes. Empty while the
+    // adjustments contain a negative cycle.
+    JohnsonReweighting fares;
+    ConstrainedRouter constrainedRouter;
+    // Backup routes sharing no segment with the primary.
+    DisjointPaths disjointPaths;
+    // Seat assignment for many passengers at once.
+    PassengerFlow passengerFlow;
+    // Visits one /itinerary request may ask for.
+    static constexpr size_t MaxItineraryVisits = 12;
+    // Demands one /flows request may carry, and passengers per demand. The
+    // assignment runs on the request thread and holds every other request.
+    static constexpr size_t MaxFlowDemands = 5000;
+    static constexpr int MaxDemandPassengers = 10000;
+    // Seats one /seats post may set on a direction.
+    static constexpr int MaxSeats = 100000;
+    // Itineraries one /backups request may ask for; the batch runs on every
+    // core while the request thread waits.
+    static constexpr size_t MaxBackupItineraries = 1000;
+
+    explicit RouteService(FlightGraph network)
+        : graph(std::move(network)),
+          feed(feedResolver(graph), graph.airports.size(), graph.edgeEnds.size(), [this](const vector<WeatherEvent> &batch, vector<int> &changed)
+               { applyFeedBatch(batch, changed); })
+    {
+        airportClosed.assign(graph.airports.size(), false);
+        allOpenGraph = graph;
+        allOpenGraph.openAllEdges();
+        for (size_t i = 0; i < graph.airports.size(); ++i)
+        codeIndex[graph.airports[i].code] = i;
+        feed.subscribe([this](const vector<int> &changed)
+                       { publishEdgeState(&changed); });
+        publishEdgeState(nullptr);
+        constrainedRouter = ConstrainedRouter(graph.airports.size(), graph.edgeEnds);
+        disjointPaths = DisjointPaths(graph.airports.size(), graph.edgeEnds);
+        passengerFlow = PassengerFlow(graph.airports.size(), graph.edgeEnds);
+        labelOrder = graph.hierarchyOrder();
+        hierarchy = CustomizableCH(graph.airports.size(), graph.edgeEnds, labelOrder);
+        flagRegions = graph.partitionRegions(graph.airports.size() >= 512 ? 5 : 2);
+        const char *metrics[] = {"distance", "cost", "time"};
+        auto state = edgeState.read();
+        for (int m = 0; m < 3; ++m)
+        {
+            arcFlags[m].name = hubLabels[m].name = metrics[m];
+            auto saved = make_shared<HubLabels>();
+            uint64_t key = 0;
+            if (saved->load(labelsPath(metrics[m]), graph.airports.size(), &key) && key == graph.labelsKey(metrics[m], *state))
+            {
+                hubLabels[m].ready = saved;
+                hubLabels[m].key = closureKey(*state);
+            }
+        }
+    }
+
+    static string labelsPath(const string &metric)
+    {
+        const char *env = getenv("AEROROUTE_HUB_LABELS");
+        return string(env && *env ? env : "hub_labels") + "_" + metric + ".bin";
+    }
+
+    uint64_t closureKey(const EdgeState &state)
+    {
+        if (keyVersion != state.version)
+        {
+            keyVersion = state.version;
+            versionKey = state.closureHash();
+        }
+        return versionKey;
+    }
+
+    // Flags for `state`'s closures, or null while they are being rebuilt.
+    const ArcFlags *flagsFor(const string &metric, const EdgeState &state)
+    {
+        Rebuilt<ArcFlags> *f = &arcFlags[0];
+        for (auto &candidate : arcFlags)
+        if (candidate.name == metric)
+        f = &candidate;
+        return f->current(state, closureKey(state), [this, name = f->name](const EdgeState &closures)
+                          { return make_shared<const ArcFlags>(graph.buildArcFlags(flagRegions, name, closures, max(1, static_cast<int>(thread::hardware_concurrency())))); });
+    }
+
+    // Labels for `state`'s closures, or null while they are being rebuilt.
+    const HubLabels *labelsFor(const string &metric, const EdgeState &state)
+    {
+        Rebuilt<HubLabels> *l = &hubLabels[0];
+        for (auto &candidate : hubLabels)
+        if (candidate.name == metric)
+        l = &candidate;
+        return l->current(state, closureKey(state), [this, name = l->name](const EdgeState &closures)
+                          {
+                              auto labels = make_shared<HubLabels>(graph.buildHubLabels(name, closures, labelOrder));
+                              string path = labelsPath(name);
+                              uint64_t key = graph.labelsKey(name, closures);
+                              auto mapped = make_shared<HubLabels>();
+                              if (labels->save(path, key) && mapped->load(path, graph.airports.size()))
+                              labels = mapped;
+                              return shared_ptr<const HubLabels>(labels); });
+    }
+
+    const CustomizableCH::Metric &customized(const string &metric, const EdgeState &state)
+    {
+        CchMetric *m = &cchMetrics[0];
+        for (auto &candidate : cchMetrics)
+        if (candidate.name == metric)
+        m = &candidate;
+        if (m->version != state.version)
+        {
+            vector<double> weights;
+            graph.edgeWeights(m->name, &state, weights);
+            hierarchy.customize(weights, m->metric, max(1, static_cast<int>(thread::hardware_concurrency())));
+            m->version = state.version;
+        }
+        return m->metric;
+    }
+
+    RouteService(const RouteService &) = delete;
+    RouteService &operator=(const RouteService &) = delete;
+
+    void applyFeedBatch(const vector<WeatherEvent> &batch, vector<int> &changed)
+    {
+        for (const auto &ev : batch)
+        if (ev.airport >= 0)
+        airportClosed[ev.airport] = isBadCondition(ev.condition);
+        graph.applyWeatherEvents(batch, changed);
+    }
+
+    // Publishes the graph's current flags as the next version. `changed`
+    // lists the edges touched since the last publish; null re-reads them all.
+    void publishEdgeState(const vector<int> *changed)
+    {
+        auto current = edgeState.read();
+        edgeState.publish(graph.snapshotEdgeState(++weatherVersion, current.get(), current ? changed : nullptr));
+        refreshFares(changed);
+    }
+
+    // Re-reads the fares of the changed edges (all of them without a list).
+    void refreshFares(const vector<int> *changed)
+    {
+        if (changed && !fares.empty())
+        {
+            bool repaired = true;
+            for (int id : *changed)
+            for (uint32_t arc : {2u * id, 2u * id + 1})
+            repaired = repaired && (graph.arcFare(arc) == fares.weight(arc) || fares.update(arc, graph.arcFare(arc)));
+            if (repaired)
+            return;
+        }
+        vector<double> weights;
+        graph.arcFares(nullptr, weights);
+        fares.reset(graph.airports.size(), graph.edgeEnds, weights);
+    }
+
+    int lookup(const string &input) const
+    {
+        auto it = codeIndex.find(input);
+        if (it != codeIndex.end())
+        return it->second;
+        if (!input.empty() && all_of(input.begin(), input.end(), ::isdigit))
+        {
+            errno = 0;
+            long idx = strtol(input.c_str(), nullptr, 10);
+            if (errno == 0 && idx < static_cast<long>(graph.airports.size()))
+            return static_cast<int>(idx);
+        }
+        return -1;
+    }
+
+    // A parsed POST body naming a segment by its "from" and "to" airports.
+    static bool isSegment(const nlohmann::json &body)
+    {
+        return body.is_object() && body.contains("from") && body["from"].is_string() && body.contains("to") && body["to"].is_string();
+    }
+
+    // A JSON integer in [low, high]; 3.0 counts, 3.5 and 1e12 do not.
+    static bool isIntegerIn(const nlohmann::json &value, long long low, long long high)
+    {
+        if (value.is_number_unsigned())
+        return value.get<unsigned long long>() <= static_cast<unsigned long long>(high) &&
+               (low <= 0 || value.get<unsigned long long>() >= static_cast<unsigned long long>(low));
+        if (value.is_number_integer())
+        return value.get<long long>() >= low && value.get<long long>() <= high;
+        if (!value.is_number_float())
+        return false;
+        double d = value.get<double>();
+        return d >= low && d <= high && d == floor(d);
+    }
+
+    static bool knownMetric(const string &metric)
+    {
+        return metric == "distance" || metric == "cost" || metric == "time";
+    }
+
+    void refreshWeather()
+    {
+        Date today = Date::getCurrentDate();
+        time_t now = time(nullptr);
+        char timeBuf[6];
+        strftime(timeBuf, sizeof(timeBuf), "%H:%M", localtime(&now));
+
+        int n = graph.airports.size();
+        for (const auto &airport : graph.airports)
+        forecastCache.prefetch(airport.code, airport.latitude, airport.longitude, apiKey);
+
+        vector<DetailedWeather> weather(n);
+        for (int i = 0; i < n; ++i)
+        {
+            weather[i] = forecastFor(graph.airports[i], today.toString(), timeBuf);
+            airportClosed[i] = isBadWeather(weather[i].main);
+        }
+        forecastCache.save();
+        for (int u = 0; u < n; ++u)
+        {
+            for (const auto &e : graph.adj[u])
+            {
+                bool badU = isBadWeather(weather[u].main);
+                bool badV = isBadWeather(weather[e.to].main);
+                string desc = (badU ? weather[u].main : "") + (badU && badV ? ", " : "") + (badV ? weather[e.to].main : "");
+                graph.updateWeather(u, e.to, badU || badV, badU || badV ? desc : "Clear");
+            }
+        }
+        if (weatherGrid && graph.hasEdgeCells())
+        {
+            refreshWeatherGrid();
+            vector<int> changed;
+            graph.closeEdgesCrossing(*weatherGrid, weatherGrid->sliceAt(now), changed);
+        }
+        publishEdgeState(nullptr);
+    }
+
+    // One request never takes the server down: a body field of an
+    // unexpected type is the client's fault, anything else is ours.
+    HttpResponse handle(const HttpRequest &req)
+    {
+        try
+        {
+            return respond(req);
+        }
+        catch (const nlohmann::json::exception &e)
+        {
+            return {400, nlohmann::json{{"error", e.what()}}.dump()};
+        }
+        catch (const exception &e)
+        {
+            return {500, nlohmann::json{{"error", e.what()}}.dump()};
+        }
+    }
+
+    HttpResponse respond(const HttpRequest &req)
+    {
+        if (req.path == "/health")
+        return {200, nlohmann::json{{"status", "ok"}, {"airports", graph.airports.size()}, {"weatherVersion", edgeState.read()->version}}.dump()};
+
+        if (req.path == "/weather/feed")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            WeatherFeedStats before = feed.stats();
+            feed.ingest(req.body);
+            feed.flush();
+            const WeatherFeedStats &after = feed.stats();
+            // Valid lines are applied either way; any refused line makes the
+            // post a 400 so the sender knows to look at its feed.
+            nlohmann::json j{{"events", after.lines - before.lines},
+                             {"rejected", after.rejected - before.rejected},
+                             {"coalesced", after.coalesced - before.coalesced},
+                             {"changedEdges", after.changedEdges - before.changedEdges},
+                             {"weatherVersion", weatherVersion}};
+            return {after.rejected != before.rejected ? 400 : 200, j.dump()};
+        }
+
+        if (req.path == "/nearest")
+        {
+            int idx = graph.nearestAirport(atof(req.param("lat").c_str()), atof(req.param("lon").c_str()));
+            if (idx < 0)
+            return {404, "{\"error\":\"no airports\"}"};
+            return {200, nlohmann::json{{"code", graph.airports[idx].code}, {"index", idx}}.dump()};
+        }
+
+        if (req.path == "/diversions")
+        {
+            int airport = lookup(req.param("airport"));
+            if (airport < 0)
+            return {400, "{\"error\":\"unknown airport\"}"};
+            double radius = atof(req.param("radius", "300").c_str());
+            size_t limit = atoi(req.param("limit", "5").c_str());
+            nlohmann::json list = nlohmann::json::array();
+            for (auto [v, km] : graph.diversionCandidates(airport, radius, [&](int a)
+                                                          { return airportClosed[a]; },
+                                                          limit))
+            list.push_back({{"code", graph.airports[v].code}, {"km", km}});
+            return {200, nlohmann::json{{"airport", graph.airports[airport].code}, {"candidates", list}}.dump()};
+        }
+
+        if (req.path == "/weather")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+            if (!isSegment(body) || (body.contains("bad") && !body["bad"].is_boolean()) ||
+                (body.contains("description") && !body["description"].is_string()))
+            return {400, "{\"error\":\"expected {from, to, bad, description}\"}"};
+            int u = lookup(body["from"].get<string>());
+            int v = lookup(body["to"].get<string>());
+            if (u < 0 || v < 0 || !graph.findEdge(u, v))
+            return {404, "{\"error\":\"unknown segment\"}"};
+            bool bad = body.value("bad", false);
+            graph.updateWeather(u, v, bad, body.value("description", bad ? "Bad" : "Clear"));
+            vector<int> changed = {graph.findEdge(u, v)->id};
+            publishEdgeState(&changed);
+            return {200, nlohmann::json{{"updated", true}, {"weatherVersion", weatherVersion}}.dump()};
+        }
+
+        if (req.path == "/weather/penalty")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+            if (!isSegment(body) || (body.contains("minutes") && !body["minutes"].is_number()) ||
+                (body.contains("cost") && !body["cost"].is_number()))
+            return {400, "{\"error\":\"expected {from, to, minutes, cost}\"}"};
+            int u = lookup(body["from"].get<string>());
+            int v = lookup(body["to"].get<string>());
+            if (u < 0 || v < 0 || !graph.findEdge(u, v))
+            return {404, "{\"error\":\"unknown segment\"}"};
+            graph.setPenalty(u, v, body.value("minutes", 0.0f), body.value("cost", 0.0f));
+            vector<int> changed = {graph.findEdge(u, v)->id};
+            publishEdgeState(&changed);
+            return {200, nlohmann::json{{"updated", true}, {"weatherVersion", weatherVersion}}.dump()};
+        }
+
+        if (req.path == "/fares/adjustment")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+            if (!isSegment(body) || (body.contains("amount") && !body["amount"].is_number()))
+            return {400, "{\"error\":\"expected {from, to, amount}\"}"};
+            int u = lookup(body["from"].get<string>());
+            int v = lookup(body["to"].get<string>());
+            if (u < 0 || v < 0 || !graph.findEdge(u, v))
+            return {404, "{\"error\":\"unknown segment\"}"};
+            uint32_t arc = graph.arcOf(u, *graph.findEdge(u, v));
+            float previous = graph.fareAdjustment[arc];
+            graph.setFareAdjustment(u, v, body.value("amount", 0.0f));
+            if (!fares.empty() && !fares.update(arc, graph.arcFare(arc)))
+            {
+                graph.setFareAdjustment(u, v, previous);
+                return {409, "{\"error\":\"adjustment would create a negative fare cycle\"}"};
+            }
+            if (fares.empty())
+            refreshFares(nullptr);
+            return {200, nlohmann::json{{"updated", true}, {"negativeCycle", fares.empty()}, {"repairedAirports", fares.lastRepairSize()}}.dump()};
+        }
+
+        if (req.path == "/seats")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+            if (!isSegment(body) || (body.contains("seats") && !isIntegerIn(body["seats"], 0, MaxSeats)))
+            return {400, "{\"error\":\"expected {from, to, seats} with seats an integer from 0 to " + to_string(MaxSeats) + "\"}"};
+            int u = lookup(body["from"].get<string>());
+            int v = lookup(body["to"].get<string>());
+            if (u < 0 || v < 0 || !graph.findEdge(u, v))
+            return {404, "{\"error\":\"unknown segment\"}"};
+            graph.setSeats(u, v, body.contains("seats") ? body["seats"].get<int>() : FlightGraph::DefaultSeats);
+            return {200, nlohmann::json{{"updated", true}, {"seats", graph.arcSeats[graph.arcOf(u, *graph.findEdge(u, v))]}}.dump()};
+        }
+
+        if (req.path == "/flows")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+            if (body.is_discarded() || !body.contains("demands") || !body["demands"].is_array())
+            return {400, "{\"error\":\"expected {demands: [{src, dst, passengers}], metric}\"}"};
+            if (body["demands"].size() > MaxFlowDemands)
+            return {413, "{\"error\":\"at most " + to_string(MaxFlowDemands) + " demands per request\"}"};
+            vector<PassengerDemand> demands;
+            for (const auto &d : body["demands"])
+            {
+                if (!d.is_object() || !d.contains("src") || !d["src"].is_string() || !d.contains("dst") || !d["dst"].is_string())
+                return {400, "{\"error\":\"expected {demands: [{src, dst, passengers}], metric}\"}"};
+                int u = lookup(d["src"].get<string>()), v = lookup(d["dst"].get<string>());
+                if (u < 0 || v < 0)
+                return {400, "{\"error\":\"unknown src or dst airport\"}"};
+                const auto passengers = d.find("passengers");
+                if (passengers != d.end() && !isIntegerIn(*passengers, 0, MaxDemandPassengers))
+                return {400, "{\"error\":\"passengers must be an integer from 0 to " + to_string(MaxDemandPassengers) + "\"}"};
+                demands.push_back({u, v, passengers != d.end() ? passengers->get<int>() : 1});
+            }
+            if (body.contains("rounds") && !isIntegerIn(body["rounds"], 1, 16))
+            return {400, "{\"error\":\"rounds must be an integer from 1 to 16\"}"};
+            if (body.contains("metric") && (!body["metric"].is_string() || !knownMetric(body["metric"].get<string>())))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            string metric = body.value("metric", "time");
+            int rounds = body.contains("rounds") ? body["rounds"].get<int>() : 4;
+            auto state = edgeState.read();
+            FlowAssignment flow = graph.assignPassengers(passengerFlow, demands, *state, metric, rounds);
+            nlohmann::json groups = nlohmann::json::array();
+            for (const auto &g : flow.groups)
+            {
+                nlohmann::json group = routeToJson(graph, g.path);
+                group["passengers"] = g.passengers;
+                groups.push_back(group);
+            }
+            nlohmann::json j;
+            j["metric"] = metric;
+            j["served"] = flow.served;
+            j["stranded"] = flow.stranded;
+            j["totalCost"] = flow.cost;
+            j["groups"] = groups;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/backups")
+        {
+            if (req.method != "POST")
+            return {405, "{\"error\":\"use POST\"}"};
+            nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+            if (body.is_discarded() || !body.contains("itineraries") || !body["itineraries"].is_array())
+            return {400, "{\"error\":\"expected {itineraries: [{src, dst}], metric, disjoint}\"}"};
+            if (body["itineraries"].size() > MaxBackupItineraries)
+            return {413, "{\"error\":\"at most " + to_string(MaxBackupItineraries) + " itineraries per request\"}"};
+            vector<pair<int, int>> itineraries;
+            for (const auto &it : body["itineraries"])
+            {
+                if (!it.is_object() || !it.contains("src") || !it["src"].is_string() || !it.contains("dst") || !it["dst"].is_string())
+                return {400, "{\"error\":\"expected {itineraries: [{src, dst}], metric, disjoint}\"}"};
+                int u = lookup(it["src"].get<string>()), v = lookup(it["dst"].get<string>());
+                if (u < 0 || v < 0)
+                return {400, "{\"error\":\"unknown src or dst airport\"}"};
+                itineraries.push_back({u, v});
+            }
+            if ((body.contains("metric") && (!body["metric"].is_string() || !knownMetric(body["metric"].get<string>()))) ||
+                (body.contains("disjoint") && body["disjoint"] != "edge" && body["disjoint"] != "airport"))
+            return {400, "{\"error\":\"metric must be distance, cost or time, disjoint edge or airport\"}"};
+            string metric = body.value("metric", "distance");
+            bool airportDisjoint = body.value("disjoint", "edge") == "airport";
+            auto state = edgeState.read();
+            vector<DisjointPair> routes = graph.disjointRoutes(disjointPaths, itineraries, *state, metric, airportDisjoint,
+                                                               max(1, static_cast<int>(thread::hardware_concurrency())));
+            nlohmann::json results = nlohmann::json::array();
+            for (const DisjointPair &r : routes)
+            results.push_back(disjointToJson(graph, r));
+            return {200, nlohmann::json{{"metric", metric}, {"results", results}, {"weatherVersion", state->version}}.dump()};
+        }
+
+        if (req.path == "/metro")
+        {
+            // "JFK,EWR:35": airport codes, each with an optional access cost.
+            // Costs must be finite and non-negative: multiRoute stops once
+            // no egress can make a settled target cheaper.
+            bool badCost = false;
+            auto airports = [&](const string &list)
+            {
+                vector<pair<int, double>> out;
+                stringstream items(list);
+                for (string item; getline(items, item, ',');)
+                {
+                    size_t colon = item.find(':');
+                    int a = lookup(item.substr(0, colon));
+                    if (a < 0)
+                    return vector<pair<int, double>>();
+                    double cost = 0;
+                    if (colon != string::npos)
+                    {
+                        const char *text = item.c_str() + colon + 1;
+                        char *end;
+                        cost = strtod(text, &end);
+                        if (end == text || *end || !isfinite(cost) || cost < 0)
+                        {
+                            badCost = true;
+                            return vector<pair<int, double>>();
+                        }
+                    }
+                    out.push_back({a, cost});
+                }
+                return out;
+            };
+            vector<pair<int, double>> sources = airports(req.param("src")), targets = airports(req.param("dst"));
+            if (badCost)
+            return {400, "{\"error\":\"access costs must be finite and non-negative\"}"};
+            if (sources.empty() || targets.empty())
+            return {400, "{\"error\":\"unknown src or dst airport\"}"};
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            auto state = edgeState.read();
+            FlightGraph::MultiRoute r = graph.multiRoute(sources, targets, *state, metric);
+            nlohmann::json j = routeToJson(graph, r.path);
+            j["metric"] = metric;
+            if (!r.path.empty())
+            {
+                j["chosenSrc"] = graph.airports[r.source].code;
+                j["chosenDst"] = graph.airports[r.target].code;
+                j["value"] = r.value;
+            }
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/itinerary")
+        {
+            vector<int> stops = {lookup(req.param("home"))};
+            stringstream visits(req.param("visit"));
+            for (string code; getline(visits, code, ',');)
+            if (!code.empty())
+            stops.push_back(lookup(code));
+            if (find(stops.begin(), stops.end(), -1) != stops.end())
+            return {400, "{\"error\":\"unknown home or visit airport\"}"};
+            // The exact order costs 2^visits table entries per visit.
+            if (stops.size() > MaxItineraryVisits + 1)
+            return {400, "{\"error\":\"at most " + to_string(MaxItineraryVisits) + " visits per itinerary\"}"};
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            auto state = edgeState.read();
+            vector<int> path;
+            TourPlan plan = graph.planItinerary(stops, *state, metric, path, max(1, static_cast<int>(thread::hardware_concurrency())));
+            nlohmann::json j = routeToJson(graph, path);
+            vector<string> order;
+            for (int i : plan.order)
+            order.push_back(graph.airports[stops[i]].code);
+            j["metric"] = metric;
+            j["order"] = order;
+            j["exact"] = plan.exact;
+            if (!path.empty())
+            j["value"] = plan.cost;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/isochrone")
+        {
+            int src = lookup(req.param("src"));
+            if (src < 0)
+            return {400, "{\"error\":\"unknown src airport\"}"};
+            string metric = req.param("metric", "time");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            double bound = atof(req.param("bound", "240").c_str());
+            if (!isfinite(bound) || bound < 0)
+            return {400, "{\"error\":\"bound must be a non-negative number\"}"};
+            auto state = edgeState.read();
+            Isochrone iso = graph.isochrone(src, bound, *state, metric);
+            nlohmann::json reachable = nlohmann::json::array();
+            for (size_t i = 0; i < iso.airports.size(); ++i)
+            {
+                nlohmann::json a;
+                a["code"] = graph.airports[iso.airports[i]].code;
+                a["value"] = iso.value[i];
+                if (iso.parent[i] >= 0)
+                a["via"] = graph.airports[iso.parent[i]].code;
+                reachable.push_back(a);
+            }
+            nlohmann::json j;
+            j["from"] = graph.airports[src].code;
+            j["metric"] = metric;
+            j["bound"] = bound;
+            j["reachable"] = reachable;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        int src = lookup(req.param("src"));
+        int dst = lookup(req.param("dst"));
+        if (src < 0 || dst < 0)
+        return {400, "{\"error\":\"unknown src or dst airport\"}"};
+
+        if (req.path == "/route")
+        {
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            string algo = req.param("algo", "dijkstra");
+            auto state = edgeState.read();
+            vector<int> path;
+            AnytimeRoute anytime;
+            if (algo == "astar")
+            path = graph.astar(src, dst, *state, metric);
+            else if (algo == "anytime")
+            {
+                // NaN, negative or huge budgets would overflow the deadline.
+                double budget = atof(req.param("deadlineMs", "5").c_str());
+                budget = isfinite(budget) ? max(0.0, min(budget, 1000.0)) : 5.0;
+                auto deadline = chrono::steady_clock::now() + chrono::microseconds(static_cast<long long>(budget * 1000));
+                anytime = graph.anytimeRoute(src, dst, *state, metric, deadline);
+                path = anytime.path;
+            }
+            else if (algo == "bellman-ford")
+            path = graph.bellmanFord(src, dst, *state, metric);
+            else if (algo == "cch")
+            path = hierarchy.path(customized(metric, *state), src, dst);
+            else if (algo == "arcflags")
+            {
+                // Plain Dijkstra answers while flags for these closures build.
+                const ArcFlags *flags = flagsFor(metric, *state);
+                path = graph.dijkstra(src, dst, *state, metric, flags);
+                if (!flags)
+                algo = "dijkstra";
+            }
+            else if (algo == "johnson")
+            {
+                if (fares.empty())
+                return {409, "{\"error\":\"fare adjustments contain a negative cycle\"}"};
+                vector<pair<int, int>> explored;
+                path = graph.dijkstraReweighted(src, dst, fares, explored);
+                metric = "net-cost";
+            }
+            else
+            path = graph.dijkstra(src, dst, *state, metric);
+            nlohmann::json j = routeToJson(graph, path);
+            j["metric"] = metric;
+            j["algorithm"] = algo;
+            j["weatherVersion"] = state->version;
+            if (algo == "johnson")
+            {
+                double net = 0;
+                for (size_t i = 1; i < path.size(); ++i)
+                net += fares.weight(graph.arcOf(path[i - 1], *graph.findEdge(path[i - 1], path[i])));
+                j["netCost"] = net;
+            }
+            if (algo == "anytime" && !path.empty())
+            {
+                j["bound"] = anytime.bound;
+                j["epsilon"] = anytime.epsilon;
+                j["iterations"] = anytime.iterations;
+                j["expansions"] = anytime.expansions;
+                j["timedOut"] = anytime.timedOut;
+            }
+            double minutes = 0, cost = 0;
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                const EdgePenalty &p = graph.edgePenalty[graph.findEdge(path[i - 1], path[i])->id];
+                minutes += p.minutes;
+                cost += p.cost;
+            }
+            j["penaltyMinutes"] = minutes;
+            j["penaltyCost"] = cost;
+            j["penaltiesApplied"] = algo == "cch" && metric != "distance";
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/distance")
+        {
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            auto state = edgeState.read();
+            // Dijkstra answers while labels for these closures build.
+            const HubLabels *labels = labelsFor(metric, *state);
+            float d = HubLabels::Inf;
+            if (labels)
+            d = labels->distance(src, dst);
+            else
+            {
+                vector<int> path = graph.dijkstra(src, dst, *state, metric);
+                if (!path.empty())
+                d = 0;
+                for (size_t i = 1; i < path.size(); ++i)
+                {
+                    const EdgeInfo *e = graph.findEdge(path[i - 1], path[i]);
+                    d += static_cast<float>(metric == "distance" ? e->distance : metric == "cost" ? e->cost : e->time);
+                }
+            }
+            nlohmann::json j;
+            j["from"] = graph.airports[src].code;
+            j["to"] = graph.airports[dst].code;
+            j["metric"] = metric;
+            j["answeredFrom"] = labels ? "labels" : "dijkstra";
+            j["found"] = d != HubLabels::Inf;
+            if (d != HubLabels::Inf)
+            j["value"] = d;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/constrained")
+        {
+            string minimize = req.param("minimize", "time");
+            string limit = req.param("limit", "cost");
+            if (!knownMetric(minimize) || !knownMetric(limit))
+            return {400, "{\"error\":\"minimize and limit must be distance, cost or time\"}"};
+            double budget = atof(req.param("budget", "0").c_str());
+            auto state = edgeState.read();
+            ConstrainedRouter::Result r = graph.constrainedRoute(constrainedRouter, src, dst, minimize, limit, budget, *state);
+            nlohmann::json j = routeToJson(graph, r.path);
+            j["minimize"] = minimize;
+            j["limit"] = limit;
+            j["budget"] = budget;
+            j["labels"] = r.labels;
+            j["exhausted"] = r.exhausted;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/backup")
+        {
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            bool airportDisjoint = req.param("disjoint", "edge") == "airport";
+            auto state = edgeState.read();
+            nlohmann::json j = disjointToJson(graph, graph.disjointRoutes(disjointPaths, src, dst, *state, metric, airportDisjoint));
+            j["metric"] = metric;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/stops")
+        {
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            int maxStops = max(0, min(8, atoi(req.param("maxStops", "2").c_str())));
+            auto state = edgeState.read();
+            vector<vector<int>> routes = graph.hopLimitedRoutes(src, dst, maxStops + 1, *state, metric);
+            nlohmann::json options = nlohmann::json::array();
+            for (int k = 0; k <= maxStops; ++k)
+            {
+                nlohmann::json option = routeToJson(graph, routes[k]);
+                option["maxStops"] = k;
+                options.push_back(option);
+            }
+            nlohmann::json j;
+            j["metric"] = metric;
+            j["options"] = options;
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/routes")
+        {
+            auto state = edgeState.read();
+            vector<int> original = allOpenGraph.dijkstra(src, dst);
+            vector<int> shortest = graph.dijkstra(src, dst, *state, "distance");
+            nlohmann::json j;
+            j["shortest"] = routeToJson(graph, shortest);
+            j["cheapest"] = routeToJson(graph, graph.dijkstra(src, dst, *state, "cost"));
+            j["fastest"] = routeToJson(graph, graph.dijkstra(src, dst, *state, "time"));
+            j["original"] = routeToJson(graph, original);
+            j["rerouted"] = original != shortest;
+            j["closedSegments"] = graph.closuresAlong(original, *state);
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        if (req.path == "/reroute")
+        {
+            string metric = req.param("metric", "distance");
+            if (!knownMetric(metric))
+            return {400, "{\"error\":\"metric must be distance, cost or time\"}"};
+            int slot = metric == "cost" ? 1 : metric == "time" ? 2 : 0;
+            auto state = edgeState.read();
+            const ReplacementPaths *table = replacements.lookup(ReplacementCache::key(src, dst, slot), [&]
+                                                                { return allOpenGraph.replacementPaths(src, dst, metric); });
+            vector<int> original = table ? table->path : allOpenGraph.dijkstra(src, dst, metric);
+            if (original.empty())
+            return {404, "{\"error\":\"no route between these airports\"}"};
+            vector<int> path;
+            bool fromTable = table && table->route([&](int id)
+                                                   { return state->isOpen(id); }, path);
+            if (!fromTable)
+            path = graph.dijkstra(src, dst, *state, metric);
+            nlohmann::json j = routeToJson(graph, path);
+            j["metric"] = metric;
+            j["rerouted"] = path != original;
+            j["closedSegments"] = graph.closuresAlong(original, *state);
+            j["answeredFrom"] = fromTable ? "replacement-table" : "search";
+            j["weatherVersion"] = state->version;
+            return {200, j.dump()};
+        }
+
+        return {404, "{\"error\":\"unknown endpoint\"}"};
+    }
+};
+
+int runRouteServer(int port, bool fetchWeather)
+{
+    RouteService service(buildFlightNetwork());
+    if (fetchWeather)
+    {
+        cout << "Fetching weather for " << service.graph.airports.size() << " airports..." << endl;
+        service.refreshWeather();
+    }
+
+    HttpServer server(port, [&](const HttpRequest &req)
+                      { return service.handle(req); });
+    if (!server.start())
+    {
+        cerr << "Could not listen on port " << port << endl;
+        return 1;
+    }
+    printLine('=');
+    cout << "ROUTE SERVER LISTENING ON http://127.0.0.1:" << port << endl;
+    printLine('=');
+    cout << "  GET  /route?src=SEA&dst=JFK&metric=distance|cost|time&algo=dijkstra|astar|anytime|bellman-ford|cch|arcflags|johnson[&deadlineMs=5]" << endl;
+    cout << "  GET  /distance?src=SEA&dst=JFK&metric=distance|cost|time" << endl;
+    cout << "  GET  /constrained?src=SEA&dst=JFK&minimize=time&limit=cost&budget=400" << endl;
+    cout << "  GET  /stops?src=SEA&dst=JFK&metric=distance|cost|time&maxStops=2" << endl;
+    cout << "  GET  /backup?src=SEA&dst=JFK&metric=distance|cost|time&disjoint=edge|airport" << endl;
+    cout << "  GET  /metro?src=JFK,BOS:40&dst=LAX,SFO&metric=distance|cost|time" << endl;
+    cout << "  GET  /isochrone?src=SEA&metric=distance|cost|time&bound=240" << endl;
+    cout << "  GET  /itinerary?home=JFK&visit=DEN,SFO,IAH&metric=distance|cost|time" << endl;
+    cout << "  GET  /routes?src=SEA&dst=JFK" << endl;
+    cout << "  GET  /reroute?src=SEA&dst=JFK&metric=distance|cost|time" << endl;
+    cout << "  GET  /nearest?lat=40.7&lon=-74.0" << endl;
+    cout << "  GET  /diversions?airport=JFK&radius=300&limit=5" << endl;
+    cout << "  POST /weather  {\"from\":\"SEA\",\"to\":\"PDX\",\"bad\":true,\"description\":\"Rain\"}" << endl;
+    cout << "  POST /flows  {\"demands\":[{\"src\":\"SEA\",\"dst\":\"JFK\",\"passengers\":120}],\"metric\":\"time\"}  (other requests wait)" << endl;
+    cout << "  POST /seats  {\"from\":\"SEA\",\"to\":\"PDX\",\"seats\":40}  (one direction)" << endl;
+    cout << "  POST /backups  {\"itineraries\":[{\"src\":\"SEA\",\"dst\":\"JFK\"}],\"metric\":\"time\",\"disjoint\":\"edge\"|\"airport\"}" << endl;
+    cout << "  POST /fares/adjustment  {\"from\":\"SEA\",\"to\":\"PDX\",\"amount\":-30}  (one direction)" << endl;
+    cout << "  POST /weather/penalty  {\"from\":\"SEA\",\"to\":\"PDX\",\"minutes\":25,\"cost\":40}  (routed around by algo=cch only)" << endl;
+    cout << "  POST /weather/feed  one {\"t\":..,\"airport\":\"SEA\"|\"from\":..,\"to\":..,\"condition\":\"Rain\"} per line" << endl;
+    server.run();
+    return 0;
+}
+
+int runServerBenchmark(int port, double seconds, int connections, int depth)
+{
+    RouteService service(buildFlightNetwork());
+    HttpServer server(port, [&](const HttpRequest &req)
+                      { return service.handle(req); });
+    if (!server.start())
+    {
+        cerr << "Could not listen on port " << port << endl;
+        return 1;
+    }
+    thread loop([&]()
+                { server.run(); });
+
+    vector<string> targets;
+    const char *metrics[] = {"distance", "cost", "time"};
+    int n = service.graph.airports.size();
+    for (int i = 0; i < 256; ++i)
+    {
+        int s = rand() % n, d = rand() % n;
+        if (i % 4 == 3)
+        targets.push_back("/reroute?src=" + service.graph.airports[s].code + "&dst=" + service.graph.airports[d].code);
+        else
+        targets.push_back("/route?src=" + service.graph.airports[s].code + "&dst=" + service.graph.airports[d].code + "&metric=" + metrics[i % 3]);
+    }
+
+    HttpLoadReport r = runHttpLoad(port, targets, connections, depth, seconds);
+    server.stop();
+    loop.join();
+
+    printLine('=');
+    cout << "ROUTE SERVER BENCHMARK (" << connections << " connections, pipeline depth " << depth << ")" << endl;
+    printLine('=');
+    cout << fixed << setprecision(1);
+    cout << "Requests : " << r.requests << " in " << r.seconds << " s (errors: " << r.errors << ")" << endl;
+    cout << "QPS : " << r.qps << endl;
+    cout << "Latency p50 : " << r.p50us << " us" << endl;
+    cout << "Latency p99 : " << r.p99us << " us" << endl;
+    cout << "Latency p99.9 : " << r.p999us << " us" << endl;
+    cout << "Latency max : " << r.maxus << " us" << endl;
+    return r.errors == 0 ? 0 : 1;
+}
+
+// Synthetic OpenWeatherMap payloads for the local stand-in: forty 3-hour
+// forecast slots starting at today's midnight UTC, all clear skies, with the
+// full set of fields the real API returns so parsers see realistic input.
+nlohmann::json standInConditions(double temp)
+{
+    return {{"main", {{"temp", temp}, {"feels_like", temp - 0.6}, {"temp_min", temp - 1.2}, {"temp_max", temp + 0.8}, {"pressure", 1016}, {"sea_level", 1016}, {"grnd_level", 1009}, {"humidity", 60}, {"temp_kf", 0.42}}},
+            {"weather", {{{"id", 800}, {"main", "Clear"}, {"description", "clear sky"}, {"icon", "01d"}}}},
+            {"clouds", {{"all", 0}}},
+            {"wind", {{"speed", 3.2}, {"deg", 240}, {"gust", 5.1}}},
+            {"visibility", 10000}};
+}
+
+string standInForecast()
+{
+    time_t midnight = time(nullptr) / 86400 * 86400;
+    nlohmann::json list = nlohmann::json::array();
+    for (int i = 0; i < 40; ++i)
+    {
+        time_t t = midnight + i * 3 * 3600;
+        char dt_txt[32];
+        strftime(dt_txt, sizeof(dt_txt), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        nlohmann::json entry = standInConditions(18.5 + (i % 8 < 4 ? i % 8 : 8 - i % 8));
+        entry["dt"] = static_cast<long long>(t);
+        entry["pop"] = 0;
+        entry["sys"] = {{"pod", i % 8 < 4 ? "n" : "d"}};
+        entry["dt_txt"] = dt_txt;
+        list.push_back(entry);
+    }
+    nlohmann::json city = {{"id", 5809844}, {"name", "Stand-in"}, {"coord", {{"lat", 0}, {"lon", 0}}}, {"country", "--"}, {"population", 0}, {"timezone", 0}, {"sunrise", static_cast<long long>(midnight + 6 * 3600)}, {"sunset", static_cast<long long>(midnight + 18 * 3600)}};
+    return nlohmann::json{{"cod", "200"}, {"message", 0}, {"cnt", 40}, {"list", list}, {"city", city}}.dump();
+}
+
+string standInCurrent()
+{
+    nlohmann::json j = standInConditions(18.5);
+    j["coord"] = {{"lon", 0}, {"lat", 0}};
+    j["base"] = "stations";
+    j["dt"] = static_cast<long long>(time(nullptr));
+    j["sys"] = {{"country", "--"}, {"sunrise", 0}, {"sunset", 0}};
+    j["timezone"] = 0;
+    j["name"] = "Stand-in";
+    j["cod"] = 200;
+    return j.dump();
+}
+
+HttpResponse handleWeatherStandIn(const HttpRequest &req, int delayMs)
+{
+    if (delayMs > 0)
+        this_thread::sleep_for(chrono::milliseconds(delayMs));
+    if (req.path == "/forecast")
+        return {200, standInForecast()};
+    if (req.path == "/weather")
+        return {200, standInCurrent()};
+    return {404, "{\"cod\":\"404\"}"};
+}
+
+int runWeatherStandIn(int port, int delayMs)
+{
+    HttpServer server(port, [delayMs](const HttpRequest &req)
+                      { return handleWeatherStandIn(req, delayMs); });
+    if (!server.start())
+    {
+        cerr << "Could not listen on port " << port << endl;
+        return 1;
+    }
+    cout << "Weather stand-in on http://127.0.0.1:" << port << " (" << delayMs << " ms per request)" << endl;
+    cout << "Set OPENWEATHERMAP_BASE_URL=http://127.0.0.1:" << port << " to use it." << endl;
+    server.runThreadPerConnection();
+    return 0;
+}
+
+// Compares the old one-request-at-a-time pattern (two forecast calls per
+// segment) against prefetching every airport on the route through the client.
+int runWeatherBenchmark(int delayMs)
+{
+    const int port = 18081;
+    HttpServer server(port, [delayMs](const HttpRequest &req)
+                      { return handleWeatherStandIn(req, delayMs); });
+    if (!server.start())
+    {
+        cerr << "Could not listen on port " << port << endl;
+        return 1;
+    }
+    thread loop([&]()
+                { server.runThreadPerConnection(); });
+    string base = "http://127.0.0.1:" + to_string(port);
+#ifdef _WIN32
+    _putenv_s("OPENWEATHERMAP_BASE_URL", base.c_str());
+#else
+    setenv("OPENWEATHERMAP_BASE_URL", base.c_str(), 1);
+#endif
+
+    FlightGraph graph = buildFlightNetwork();
+    int n = graph.airports.size();
+    vector<int> route;
+    for (int s = 0; s < n; ++s)
+        for (int d = 0; d < n; ++d)
+        {
+            vector<int> p = graph.dijkstra(s, d, "distance");
+            if (p.size() > route.size())
+                route = p;
+        }
+    size_t segments = route.size() - 1;
+
+    auto t0 = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < segments; ++i)
+    {
+        for (int airport : {route[i], route[i + 1]})
+        {
+            ostringstream url;
+            url << base << "/forecast?lat=" << graph.airports[airport].latitude
+                << "&lon=" << graph.airports[airport].longitude
+                << "&appid=" << apiKey << "&units=metric";
+            cpr::Get(cpr::Url{url.str()});
+        }
+    }
+    auto t1 = chrono::high_resolution_clock::now();
 
-string getWeatherDescription(double lat, double lon, const string &apiKey)
-{
-    ostringstream url;
-    url << "http://api.openweathermap.org/data/2.5/weather?lat=" << lat
-        << "&lon=" << lon
-        << "&appid=" << apiKey
-        << "&units=metric";
-
-    cpr::Response r = cpr::Get(cpr::Url{url.str()});
-    if (r.status_code == 200)
-    {
-        nlohmann::json j = nlohmann::json::parse(r.text);
-        string main = j["weather"][0]["main"].get<string>();
-        string desc = j["weather"][0]["description"].get<string>();
-        double temp = j["main"]["temp"];
-        ostringstream oss;
-        oss << main << " (" << desc << "), " << temp << " C";
-        return oss.str();
-    }
-    else
+    WeatherClient client;
+    vector<shared_future<WeatherResponse>> pending;
+    for (size_t i = 0; i < segments; ++i)
     {
-        return "[Weather unavailable]";
+        pending.push_back(client.fetchForecast(graph.airports[route[i]].latitude, graph.airports[route[i]].longitude, apiKey));
+        pending.push_back(client.fetchForecast(graph.airports[route[i + 1]].latitude, graph.airports[route[i + 1]].longitude, apiKey));
     }
-}
+    for (auto &f : pending)
+        f.get();
+    auto t2 = chrono::high_resolution_clock::now();
 
-bool isBadWeather(const string &mainWeather)
-{
-    string mw = mainWeather;
-    transform(mw.begin(), mw.end(), mw.begin(), ::tolower);
-    return mw == "thunderstorm" || mw == "snow" || mw == "tornado" || mw == "squall" || mw == "ash" || mw == "sand" || mw == "dust" || mw == "heavy rain" || mw == "rain" || mw == "extreme";
-}
+    server.stop();
+    loop.join();
 
-string convertToAPIDate(const std::string &dateStr)
-{
-    int d, m, y;
-    char sep;
-    istringstream iss(dateStr);
-    iss >> d >> sep >> m >> sep >> y;
-    ostringstream oss;
-    oss << y << "-";
-    if (m < 10)
-    oss << "0";
-    oss << m << "-";
-    if (d < 10)
-    oss << "0";
-    oss << d;
-    return oss.str();
+    double serialMs = chrono::duration<double, milli>(t1 - t0).count();
+    double concurrentMs = chrono::duration<double, milli>(t2 - t1).count();
+    printLine('=');
+    cout << "WEATHER FETCH BENCHMARK (" << segments << " segments, " << delayMs << " ms simulated latency)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(1);
+    cout << "Serial, 2 calls per segment : " << 2 * segments << " requests, " << serialMs << " ms" << endl;
+    cout << "Concurrent + coalesced : " << client.requestsIssued() << " requests (" << client.requestsCoalesced() << " coalesced), " << concurrentMs << " ms" << endl;
+    cout << "Speedup : " << serialMs / concurrentMs << "x" << endl;
+    return 0;
 }
 
-struct DetailedWeather
+// Nearest-slot lookups: the old walk over the JSON list (sscanf + mktime and a
+// DOM copy per entry) against binary search over the pre-indexed series.
+int runForecastBenchmark(int lookups)
 {
-    string main;
-    string desc;
-    double temp;
-    int humidity;
-    double wind;
-};
+    string payload = standInForecast();
+    nlohmann::json j = nlohmann::json::parse(payload);
+    ForecastSeries series = parseForecastSeries(payload);
+
+    vector<pair<string, string>> queries;
+    time_t now = time(nullptr);
+    mt19937 rng(7);
+    for (int i = 0; i < 1024; ++i)
+    {
+        time_t t = now + static_cast<time_t>(rng() % (5 * 86400));
+        char date[16], hhmm[8];
+        strftime(date, sizeof(date), "%d/%m/%Y", gmtime(&t));
+        strftime(hhmm, sizeof(hhmm), "%H:%M", gmtime(&t));
+        queries.push_back({date, hhmm});
+    }
 
-auto getForecastWeather = [](double lat, double lon, const string &apiKey, const string &date, const string &time) -> DetailedWeather
-{
-    std::ostringstream url;
-    url << "http://api.openweathermap.org/data/2.5/forecast?lat=" << lat
-        << "&lon=" << lon
-        << "&appid=" << apiKey
-        << "&units=metric";
-    cpr::Response r = cpr::Get(cpr::Url{url.str()});
-    if (r.status_code == 200)
-    {
-        nlohmann::json j = nlohmann::json::parse(r.text);
+    size_t mismatches = 0;
+    double checksum = 0;
+    auto t0 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < lookups; ++i)
+    {
+        const auto &q = queries[i % queries.size()];
         std::tm flight_tm = {};
-
-        sscanf(date.c_str(), "%d/%d/%d", &flight_tm.tm_mday, &flight_tm.tm_mon, &flight_tm.tm_year);
+        sscanf(q.first.c_str(), "%d/%d/%d", &flight_tm.tm_mday, &flight_tm.tm_mon, &flight_tm.tm_year);
         flight_tm.tm_year -= 1900;
         flight_tm.tm_mon -= 1;
-        sscanf(time.c_str(), "%d:%d", &flight_tm.tm_hour, &flight_tm.tm_min);
-        flight_tm.tm_sec = 0;
-
+        sscanf(q.second.c_str(), "%d:%d", &flight_tm.tm_hour, &flight_tm.tm_min);
         time_t flight_time = mktime(&flight_tm);
-        time_t min_diff = LLONG_MAX;
+        time_t min_diff = numeric_limits<time_t>::max();
         nlohmann::json bestEntry;
         for (const auto &entry : j["list"])
         {
@@ -1072,34 +5080,348 @@ auto getForecastWeather = [](double lat, double lon, const string &apiKey, const
                 bestEntry = entry;
             }
         }
+        checksum += bestEntry["main"]["temp"].get<double>();
+        if (bestEntry["dt"].get<long long>() != series.time[series.closest(forecastQueryTime(q.first, q.second))])
+        ++mismatches;
+    }
+    auto t1 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < lookups; ++i)
+    {
+        const auto &q = queries[i % queries.size()];
+        checksum += series.temp[series.closest(forecastQueryTime(q.first, q.second))];
+    }
+    auto t2 = chrono::high_resolution_clock::now();
+
+    double domUs = chrono::duration<double, micro>(t1 - t0).count() / lookups;
+    double indexedUs = chrono::duration<double, micro>(t2 - t1).count() / lookups;
+    printLine('=');
+    cout << "FORECAST LOOKUP BENCHMARK (" << series.size() << " slots, " << lookups << " lookups)" << endl;
+    printLine('=');
+    cout << fixed << setprecision(3);
+    cout << "JSON walk + mktime : " << domUs << " us/lookup" << endl;
+    cout << "Indexed series : " << indexedUs << " us/lookup" << endl;
+    cout << setprecision(1) << "Speedup : " << domUs / indexedUs << "x" << endl;
+    cout << "Mismatched slots : " << mismatches << " (checksum " << checksum << ")" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Extracting the fields we use: full nlohmann DOM (the old path) against the
+// streaming scanner, over the stand-in payloads, saved responses or weather logs.
+int runParseBenchmark(int iterations, const vector<string> &files)
+{
+    vector<string> payloads;
+    for (const auto &f : files)
+    {
+        // A weather log contributes every successful response it recorded.
+        MappedFile log(f);
+        if (forEachWeatherLogRecord(log, [&](const WeatherLogRecord &rec, const char *body)
+                                    {
+                                        if (rec.status == 200)
+                                        payloads.emplace_back(body, rec.length); }))
+        continue;
+        ifstream in(f, ios::binary);
+        ostringstream text;
+        text << in.rdbuf();
+        if (!text.str().empty())
+        payloads.push_back(text.str());
+    }
+    if (payloads.empty())
+    payloads = {standInForecast(), standInCurrent()};
 
-        if (!bestEntry.is_null())
+    size_t bytes = 0, domRecords = 0, saxRecords = 0, mismatches = 0;
+    vector<WeatherRecord> dom, sax;
+    auto t0 = chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; ++it)
+    {
+        for (const auto &text : payloads)
         {
-            string main = bestEntry["weather"][0]["main"].get<string>();
-            string desc = bestEntry["weather"][0]["description"].get<string>();
-            double temp = bestEntry["main"]["temp"];
-            int humidity = bestEntry["main"]["humidity"];
-            double wind = bestEntry["wind"]["speed"];
-            return {main, desc, temp, humidity, wind};
+            nlohmann::json j = nlohmann::json::parse(text, nullptr, false);
+            if (j.is_discarded())
+            continue;
+            auto extract = [](const nlohmann::json &e)
+            {
+                WeatherRecord r;
+                r.time = e.value("dt", 0LL);
+                r.main = weatherMainCode(e["weather"][0]["main"].get<string>());
+                r.description = DescriptionTable::instance().intern(e["weather"][0]["description"].get<string>());
+                r.temp = e["main"]["temp"].get<float>();
+                r.humidity = static_cast<uint8_t>(e["main"]["humidity"].get<int>());
+                r.wind = e["wind"]["speed"].get<float>();
+                return r;
+            };
+            dom.clear();
+            if (j.contains("list"))
+            {
+                for (const auto &e : j["list"])
+                dom.push_back(extract(e));
+            }
+            else
+            dom.push_back(extract(j));
+            domRecords += dom.size();
+            bytes += text.size();
         }
     }
-    return {"--", "--", -1, -1, -1};
-};
+    auto t1 = chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; ++it)
+    {
+        for (const auto &text : payloads)
+        {
+            sax.clear();
+            if (text.find("\"list\"") != string::npos)
+            parseForecastRecords(text, sax);
+            else
+            {
+                sax.emplace_back();
+                parseCurrentRecord(text, sax.back());
+            }
+            saxRecords += sax.size();
+        }
+    }
+    auto t2 = chrono::high_resolution_clock::now();
 
-double haversine(double lat1, double lon1, double lat2, double lon2)
-{
-    const double R = 6371.0;
-    double dLat = (lat2 - lat1) * M_PI / 180.0;
-    double dLon = (lon2 - lon1) * M_PI / 180.0;
-    double a = sin(dLat / 2) * sin(dLat / 2) + cos(lat1 * M_PI / 180.0) * cos(lat2 * M_PI / 180.0) * sin(dLon / 2) * sin(dLon / 2);
-    double c = 2 * atan2(sqrt(a), sqrt(1 - a));
-    return R * c;
+    // Compare the two extractions once, payload by payload.
+    for (const auto &text : payloads)
+    {
+        nlohmann::json j = nlohmann::json::parse(text, nullptr, false);
+        vector<WeatherRecord> a;
+        if (parseForecastRecords(text, a) && j.contains("list"))
+        {
+            size_t k = 0;
+            for (const auto &e : j["list"])
+            {
+                if (k >= a.size() || a[k].time != e["dt"].get<long long>() || a[k].temp != e["main"]["temp"].get<float>() ||
+                    a[k].humidity != e["main"]["humidity"].get<int>() || a[k].wind != e["wind"]["speed"].get<float>() ||
+                    DescriptionTable::instance().text(a[k].description) != e["weather"][0]["description"].get<string>() ||
+                    weatherMainName(a[k].main) != e["weather"][0]["main"].get<string>())
+                ++mismatches;
+                ++k;
+            }
+        }
+    }
+
+    double domMs = chrono::duration<double, milli>(t1 - t0).count();
+    double saxMs = chrono::duration<double, milli>(t2 - t1).count();
+    printLine('=');
+    cout << "WEATHER PARSE BENCHMARK (" << payloads.size() << " payloads x " << iterations << ")" << endl;
+    printLine('=');
+    cout << fixed << setprecision(1);
+    cout << "DOM (nlohmann) : " << domMs << " ms, " << bytes / 1e6 / (domMs / 1e3) << " MB/s, " << domRecords << " records" << endl;
+    cout << "Streaming scanner : " << saxMs << " ms, " << bytes / 1e6 / (saxMs / 1e3) << " MB/s, " << saxRecords << " records" << endl;
+    cout << "Speedup : " << domMs / saxMs << "x" << endl;
+    cout << "Record size : " << sizeof(WeatherRecord) << " bytes, mismatched fields : " << mismatches << endl;
+    return mismatches == 0 && domRecords == saxRecords ? 0 : 1;
 }
 
 int main(int argc, char *argv[])
 {
     ios_base::sync_with_stdio(true);
 
+    if (argc >= 2 && string(argv[1]) == "--serve")
+    {
+        int port = argc >= 3 ? stoi(argv[2]) : 8080;
+        bool fetchWeather = !(argc >= 4 && string(argv[3]) == "--no-weather");
+        return runRouteServer(port, fetchWeather);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-geodesic")
+    {
+        return runGeodesicBenchmark(argc >= 3 ? stoi(argv[2]) : 10000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-storms")
+    {
+        return runStormBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 24);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-grid")
+    {
+        return runGridBenchmark(argc >= 3 ? stoi(argv[2]) : 2000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-ingest")
+    {
+        return runIngestBenchmark(argc >= 3 ? stoi(argv[2]) : 1000000, argc >= 4 ? stoi(argv[3]) : 2000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-snapshots")
+    {
+        int readers = argc >= 3 ? stoi(argv[2]) : max(1, static_cast<int>(thread::hardware_concurrency()) - 1);
+        return runSnapshotBenchmark(readers, argc >= 4 ? stod(argv[3]) : 3.0, argc >= 5 ? stod(argv[4]) : 20.0);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-cch")
+    {
+        return runCchBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 10000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-anytime")
+    {
+        return runAnytimeBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 300);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-isochrone")
+    {
+        return runIsochroneBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 300);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-flow")
+    {
+        return runFlowBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 20000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-disjoint")
+    {
+        return runDisjointBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 500);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-metro")
+    {
+        return runMetroBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 200);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-itinerary")
+    {
+        return runItineraryBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 18);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-constrained")
+    {
+        return runConstrainedBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 100);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-hops")
+    {
+        return runHopLimitBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 4);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-johnson")
+    {
+        return runJohnsonBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 100);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-replacement")
+    {
+        return runReplacementBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 200);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-hublabels")
+    {
+        return runHubLabelsBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 1000000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-arcflags")
+    {
+        return runArcFlagsBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, argc >= 4 ? stoi(argv[3]) : 5);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-spatial")
+    {
+        return runSpatialBenchmark(argc >= 3 ? stoi(argv[2]) : 10000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-serve")
+    {
+        double seconds = argc >= 3 ? stod(argv[2]) : 5.0;
+        int connections = argc >= 4 ? stoi(argv[3]) : 4;
+        int depth = argc >= 5 ? stoi(argv[4]) : 16;
+        return runServerBenchmark(18080, seconds, connections, depth);
+    }
+    if (argc >= 2 && string(argv[1]) == "--weather-standin")
+    {
+        int port = argc >= 3 ? stoi(argv[2]) : 8081;
+        return runWeatherStandIn(port, argc >= 4 ? stoi(argv[3]) : 0);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-forecast")
+    {
+        return runForecastBenchmark(argc >= 3 ? stoi(argv[2]) : 20000);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-parse")
+    {
+        vector<string> files(argv + min(argc, 3), argv + argc);
+        return runParseBenchmark(argc >= 3 ? stoi(argv[2]) : 2000, files);
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-weather")
+    {
+        return runWeatherBenchmark(argc >= 3 ? stoi(argv[2]) : 50);
+    }
+
+    if (argc >= 4 && string(argv[1]) == "--isochrone")
+    {
+        FlightGraph graph = buildFlightNetwork();
+        int src = resolveAirportIndex(argv[2], graph.airports);
+        if (src < 0 || src >= static_cast<int>(graph.airports.size()))
+        {
+            cerr << "Invalid airport for isochrone." << endl;
+            return 1;
+        }
+        double bound = atof(argv[3]);
+        string metric = argc >= 5 ? argv[4] : "time";
+        if (!isfinite(bound) || bound < 0 || (metric != "time" && metric != "distance" && metric != "cost"))
+        {
+            cerr << "Isochrone needs a non-negative bound and a metric of time, distance or cost." << endl;
+            return 1;
+        }
+        unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+        auto t1 = chrono::high_resolution_clock::now();
+        Isochrone iso = graph.isochrone(src, bound, *state, metric);
+        double us = chrono::duration<double, micro>(chrono::high_resolution_clock::now() - t1).count();
+
+        printLine('=');
+        cout << "REACHABLE FROM " << graph.airports[src].code << " WITHIN " << bound << " (" << metric << ")" << endl;
+        printLine('=');
+        vector<pair<int, int>> treeEdges;
+        for (size_t i = 0; i < iso.airports.size(); ++i)
+        {
+            cout << left << setw(6) << graph.airports[iso.airports[i]].code << right << setw(10) << fixed << setprecision(1) << iso.value[i];
+            if (iso.parent[i] >= 0)
+            {
+                cout << "  via " << graph.airports[iso.parent[i]].code;
+                treeEdges.push_back({iso.parent[i], iso.airports[i]});
+            }
+            cout << endl;
+        }
+        ostringstream metrics;
+        metrics << "\nReachable: " << iso.airports.size() << " airports within " << bound << " (" << metric << ")   Computation: " << us << " μs";
+        visualizeGraph(graph, {}, {}, false, treeEdges, metrics.str(), src, src, 0, "", "", &iso);
+        return 0;
+    }
+    if (argc >= 4 && string(argv[1]) == "--itinerary")
+    {
+        FlightGraph graph = buildFlightNetwork();
+        int n = graph.airports.size();
+        vector<int> stops = {resolveAirportIndex(argv[2], graph.airports)};
+        stringstream visits(argv[3]);
+        for (string code; getline(visits, code, ',');)
+        if (!code.empty())
+        stops.push_back(resolveAirportIndex(code, graph.airports));
+        for (int stop : stops)
+        {
+            if (stop < 0 || stop >= n)
+            {
+                cerr << "Invalid airport in itinerary." << endl;
+                return 1;
+            }
+        }
+        string metric = argc >= 5 ? argv[4] : "distance";
+        unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+        vector<int> path;
+        auto t1 = chrono::high_resolution_clock::now();
+        TourPlan plan = graph.planItinerary(stops, *state, metric, path, max(1, static_cast<int>(thread::hardware_concurrency())));
+        double us = chrono::duration<double, micro>(chrono::high_resolution_clock::now() - t1).count();
+        if (path.empty())
+        {
+            cerr << "No round trip reaches every stop." << endl;
+            return 1;
+        }
+
+        double totalLength = 0.0, totalCost = 0.0, totalTime = 0.0;
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            const EdgeInfo *e = graph.findEdge(path[i - 1], path[i]);
+            totalLength += e->distance;
+            totalCost += e->cost;
+            totalTime += e->time;
+        }
+        printLine('=');
+        cout << "ITINERARY (" << stops.size() - 1 << " stops, " << (plan.exact ? "exact order" : "heuristic order") << " by " << metric << ")" << endl;
+        printLine('=');
+        cout << "Order : ";
+        for (size_t i = 0; i < plan.order.size(); ++i)
+        cout << (i ? " -> " : "") << graph.airports[stops[plan.order[i]]].code;
+        cout << endl;
+        cout << "Path : ";
+        for (int airport : path)
+        cout << graph.airports[airport].code << " ";
+        cout << endl;
+
+        ostringstream metrics;
+        metrics << "\nLength: " << totalLength << "   Cost: $" << totalCost << "   Time: " << totalTime << " min   Computation: " << us << " μs";
+        cout << metrics.str().substr(1) << endl;
+        vector<pair<int, int>> exploredEdges;
+        visualizeGraph(graph, path, path, false, exploredEdges, metrics.str(), stops[0], stops[0], totalTime);
+        return 0;
+    }
+
     int src = -1, dst = -1;
     bool useCommandLineArgs = false;
 
@@ -1128,76 +5450,8 @@ int main(int argc, char *argv[])
         }
     }
 
-    FlightGraph graph;
-
-    vector<Airport> airports = {
-
-        {"SEA", "SEATTLE TACOMA INTERNATIONAL AIRPORT", sf::Vector2f(225, 269), 47.4502, -122.3088},
-        {"PDX", "PORTLAND INTERNATIONAL AIRPORT", sf::Vector2f(153, 369), 45.5898, -122.5951},
-        {"SFO", "SAN FRANCISCO INTERNATIONAL AIRPORT", sf::Vector2f(82, 586), 37.6213, -122.3790},
-        {"LAS", "HARRY REID INTERNATIONAL AIRPORT", sf::Vector2f(250, 624), 36.0840, -115.1537},
-        {"SLC", "SALT LAKE CITY INTERNATIONAL AIRPORT", sf::Vector2f(378, 558), 40.7899, -111.9791},
-        {"LAX", "LOS ANGELES INTERNATIONAL AIRPORT", sf::Vector2f(166, 721), 33.9416, -118.4085},
-        {"MSP", "MINNEAPOLIS SAINT PAUL INTERNATIONAL AIRPORT", sf::Vector2f(831, 405), 44.8848, -93.2223},
-        {"MCI", "KANSAS CITY INTERNATIONAL AIRPORT", sf::Vector2f(742, 642), 39.2976, -94.7139},
-        {"JFK", "JOHN F. KENNEDY INTERNATIONAL AIRPORT", sf::Vector2f(1324, 511), 40.6413, -73.7781},
-        {"BOS", "BOSTON LOGAN INTERNATIONAL AIRPORT", sf::Vector2f(1393, 448), 42.3656, -71.0096},
-        {"CLE", "CLEVELAND HOPKINS INTERNATIONAL AIRPORT", sf::Vector2f(1150, 550), 41.4117, -81.8498},
-        {"CLT", "CHARLOTTE DOUGLAS INTERNATIONAL AIRPORT", sf::Vector2f(1237, 727), 35.2140, -80.9431},
-        {"MIA", "MIAMI INTERNATIONAL AIRPORT", sf::Vector2f(1259, 1016), 25.7959, -80.2870},
-        {"IAH", "GEORGE BUSH INTERCONTINENTAL AIRPORT", sf::Vector2f(786, 962), 29.9902, -95.3368},
-        {"STL", "ST. LOUIS LAMBERT INTERNATIONAL AIRPORT", sf::Vector2f(905, 647), 38.7500, -90.3700},
-        {"TPA", "TAMPA INTERNATIONAL AIRPORT", sf::Vector2f(1160, 991), 27.9755, -82.5332},
-        {"DEN", "DENVER INTERNATIONAL AIRPORT", sf::Vector2f(549, 616), 39.8561, -104.6737},
-        {"PHX", "PHOENIX SKY HARBOR INTERNATIONAL AIRPORT", sf::Vector2f(342, 778), 33.4373, -112.0078},
-        {"DFW", "DALLAS/FORT WORTH INTERNATIONAL AIRPORT", sf::Vector2f(756, 853), 32.8998, -97.0403},
-        {"AUG", "AUGUSTA STATE AIRPORT", sf::Vector2f(1413, 331), 44.3206, -69.7973}
-    };
-
-    for (const auto &ap : airports)
-    {
-        graph.addAirport(ap.code, ap.position.x, ap.position.y, ap.latitude, ap.longitude);
-    }
-
-    int n = airports.size();
-
-    for (int i = 0; i < n; ++i)
-    {
-        for (int j = i + 1; j < n; ++j)
-        {
-            const auto &pi = graph.airports[i].position;
-            const auto &pj = graph.airports[j].position;
-            double dx = pi.x - pj.x;
-            double dy = pi.y - pj.y;
-            double dist = sqrt(dx * dx + dy * dy);
-
-            if (dist > 800)
-            continue;
-
-            string code1 = graph.airports[i].code;
-            string code2 = graph.airports[j].code;
-
-            if ((code1 == "STL" && code2 == "SEA") || (code1 == "SEA" && code2 == "STL"))
-            continue;
-            if ((code1 == "TPA" && code2 == "SEA") || (code1 == "SEA" && code2 == "TPA"))
-            continue;
-            if ((code1 == "MIA" && code2 == "SEA") || (code1 == "SEA" && code2 == "MIA"))
-            continue;
-            if ((code1 == "BOS" && code2 == "LAX") || (code1 == "LAX" && code2 == "BOS"))
-            continue;
-            if ((code1 == "CLE" && code2 == "LAX") || (code1 == "LAX" && code2 == "CLE"))
-            continue;
-
-            double cost = 100 + (rand() % 200);
-            double time = 30 + (rand() % 120);
-            double distance = haversine(graph.airports[i].latitude, graph.airports[i].longitude, graph.airports[j].latitude, graph.airports[j].longitude);
-            double avgSpeed = 800.0;
-            double duration = distance / avgSpeed * 60.0;
-            if (duration < 10.0)
-            duration = 10.0;
-            graph.addEdge(i, j, dist, cost, duration);
-        }
-    }
+    FlightGraph graph = buildFlightNetwork();
+    int n = graph.airports.size();
 
     printLine('=');
     cout << "WELCOME TO FLIGHT SIMULATOR" << endl;
@@ -1261,16 +5515,7 @@ int main(int argc, char *argv[])
     cout << "Selected Route : " << graph.airports[src].code << " to " << graph.airports[dst].code << endl;
 
     FlightGraph allOpenGraph = graph;
-    for (int i = 0; i < allOpenGraph.airports.size(); ++i)
-    {
-        for (int j = 0; j < allOpenGraph.airports.size(); ++j)
-        {
-            if (i != j)
-            {
-                allOpenGraph.pathAvailable[i][j] = true;
-            }
-        }
-    }
+    allOpenGraph.openAllEdges();
     vector<int> originalPath = allOpenGraph.dijkstra(src, dst);
 
     cout << "Path : ";
@@ -1325,14 +5570,21 @@ int main(int argc, char *argv[])
     }
 
     bool rerouted = false;
+    vector<char> airportBad(n, false);
 
     vector<int> tempPath = graph.dijkstra(src, dst);
+
+    // Issue every forecast the table needs up front; airports already in the
+    // cache are skipped and the rest are fetched concurrently.
+    for (int airport : tempPath)
+    forecastCache.prefetch(graph.airports[airport].code, graph.airports[airport].latitude, graph.airports[airport].longitude, apiKey);
+
     for (size_t i = 0; i + 1 < tempPath.size(); ++i)
     {
         int u = tempPath[i];
         int v = tempPath[i + 1];
         double timeOfFlight = 0.0;
-        double distance = haversine(graph.airports[u].latitude, graph.airports[u].longitude, graph.airports[v].latitude, graph.airports[v].longitude);
+        double distance = graph.geo.distanceKm(u, v);
         for (const auto &e : graph.adj[u])
         {
             if (e.to == v)
@@ -1352,7 +5604,7 @@ int main(int argc, char *argv[])
         tm *dep_tm = localtime(&dep_t);
         tm *arr_tm = localtime(&arr_t);
         char dateBuf[11], depBuf[6], arrBuf[6];
-        snprintf(dateBuf, sizeof(dateBuf), "%02d/%02d/%04d", dep_tm->tm_mday, dep_tm->tm_mon + 1, dep_tm->tm_year + 1900);
+        strftime(dateBuf, sizeof(dateBuf), "%d/%m/%Y", dep_tm);
         if (i == 0 && argc >= 5)
         {
             strncpy(depBuf, initialDepTimeStr.c_str(), sizeof(depBuf));
@@ -1360,20 +5612,27 @@ int main(int argc, char *argv[])
         }
         else
         {
-            snprintf(depBuf, sizeof(depBuf), "%02d:%02d", dep_tm->tm_hour, dep_tm->tm_min);
+            strftime(depBuf, sizeof(depBuf), "%H:%M", dep_tm);
         }
-        snprintf(arrBuf, sizeof(arrBuf), "%02d:%02d", arr_tm->tm_hour, arr_tm->tm_min);
+        strftime(arrBuf, sizeof(arrBuf), "%H:%M", arr_tm);
         string bookedDate = dateBuf;
         string depTime = depBuf;
         string arrTime = arrBuf;
 
-        DetailedWeather depWeather = getForecastWeather(graph.airports[u].latitude, graph.airports[u].longitude, apiKey, bookedDate, depTime);
-        DetailedWeather arrWeather = getForecastWeather(graph.airports[v].latitude, graph.airports[v].longitude, apiKey, bookedDate, arrTime);
+        DetailedWeather depWeather = forecastFor(graph.airports[u], bookedDate, depTime);
+        DetailedWeather arrWeather = forecastFor(graph.airports[v], bookedDate, arrTime);
         bool badDep = isBadWeather(depWeather.main);
         bool badArr = isBadWeather(arrWeather.main);
-        if (badDep || badArr)
+        airportBad[u] = airportBad[u] || badDep;
+        airportBad[v] = airportBad[v] || badArr;
+        WeatherMain enRoute = WeatherMain::Clear;
+        if (weatherGrid && graph.hasEdgeCells())
+        enRoute = graph.weatherAlong(*weatherGrid, weatherGrid->sliceAt(dep_t), graph.findEdge(u, v)->id);
+        if (badDep || badArr || isBadCondition(enRoute))
         {
             string desc = (badDep ? depWeather.main : "") + (badDep && badArr ? ", " : "") + (badArr ? arrWeather.main : "");
+            if (isBadCondition(enRoute))
+            desc += (desc.empty() ? "" : ", ") + weatherMainName(enRoute) + " en route";
             graph.updateWeather(u, v, true, desc);
         }
         else
@@ -1398,6 +5657,18 @@ int main(int argc, char *argv[])
     printLine('-', totalTableWidth);
     cout << "Note : Weather Data is based on the closest Available Forecast for Each Segment." << endl;
 
+    if (airportBad[dst])
+    {
+        auto candidates = graph.diversionCandidates(dst, 300.0, [&](int a)
+                                                    { return (bool)airportBad[a]; });
+        cout << "Bad Weather expected at " << graph.airports[dst].code << ". Diversion Airports within 300 km : ";
+        if (candidates.empty())
+        cout << "[NONE]";
+        for (auto [v, km] : candidates)
+        cout << graph.airports[v].code << " (" << lround(km) << " km) ";
+        cout << endl;
+    }
+
     vector<pair<string, vector<int>>> weatherSafePaths;
     vector<pair<string, string>> metricNames = {{"distance", "Shortest"}, {"cost", "Cheapest"}, {"time", "Fastest"}};
     for (const auto &[metric, label] : metricNames)
@@ -1509,22 +5780,35 @@ int main(int argc, char *argv[])
     cout << "1) Dijkstra      -   FAST, CLASSIC SHORTEST PATH\n";
     cout << "2) A* (A-Star)   -   USES HEURISTIC, OFTEN FASTER\n";
     cout << "3) Bellman-Ford  -   HANDLES NEGATIVE WEIGHTS\n";
+    cout << "4) Anytime A*    -   ANSWERS BY A DEADLINE, WITH A BOUND\n";
     cout << "------------------------------\n";
-    cout << "Enter choice [ 1-3, default 1 ] : ";
+    cout << "Enter choice [ 1-4, default 1 ] : ";
 
     int algo = 1;
     string algoInput;
     getline(cin >> ws, algoInput);
 
-    if (!algoInput.empty() && (algoInput[0] == '2' || algoInput[0] == '3'))
+    if (!algoInput.empty() && algoInput[0] >= '2' && algoInput[0] <= '4')
     algo = algoInput[0] - '0';
 
     using namespace std::chrono;
+    // Anytime A* re-plans the chosen metric within a 5 ms budget and reports
+    // how close to optimal it could prove the result.
+    AnytimeRoute anytime;
+    auto t1 = high_resolution_clock::now();
+    if (algo == 4)
+    {
+        string selectedMetric = weatherSafePaths[metricChoice - 1].first;
+        unique_ptr<EdgeState> state = graph.snapshotEdgeState(1);
+        t1 = high_resolution_clock::now();
+        anytime = graph.anytimeRoute(src, dst, *state, selectedMetric, steady_clock::now() + milliseconds(5));
+        if (!anytime.path.empty())
+        path = anytime.path;
+    }
+    auto t2 = high_resolution_clock::now();
     double totalCost = 0.0;
     double totalLength = 0.0;
     double totalTime = 0.0;
-    auto t1 = high_resolution_clock::now();
-    auto t2 = high_resolution_clock::now();
     double us = duration_cast<microseconds>(t2 - t1).count();
  
     for (size_t i = 1; i < path.size(); ++i)
@@ -1545,6 +5829,9 @@ int main(int argc, char *argv[])
     ostringstream metrics;
     metrics << "\nLength: " << totalLength << "   Cost: $" << totalCost << "   Time: " << totalTime << " min   Computation: " << us << " μs";
 
+    if (algo == 4 && !anytime.path.empty())
+    metrics << "   Bound: <= " << fixed << setprecision(2) << anytime.bound << "x optimal" << (anytime.timedOut ? " (deadline)" : "");
+
     string bookedDate, bookedTime;
     if (argc >= 5)
     {
@@ -1556,8 +5843,8 @@ int main(int argc, char *argv[])
 
     if (!bookedDate.empty() && !bookedTime.empty())
     {
-        auto depWeather = getForecastWeather(graph.airports[src].latitude, graph.airports[src].longitude, apiKey, bookedDate, bookedTime);
-        auto arrWeather = getForecastWeather(graph.airports[dst].latitude, graph.airports[dst].longitude, apiKey, bookedDate, bookedTime);
+        auto depWeather = forecastFor(graph.airports[src], bookedDate, bookedTime);
+        auto arrWeather = forecastFor(graph.airports[dst], bookedDate, bookedTime);
         cout << "Weather at " << graph.airports[src].code << " [ " << bookedDate << ", " << bookedTime << " ] : " << depWeather.main << " (" << depWeather.desc << ", " << depWeather.temp << " deg C)" << endl;
         cout << "Weather at " << graph.airports[dst].code << " [ " << bookedDate << ", " << bookedTime << " ] : " << arrWeather.main << " (" << arrWeather.desc << ", " << arrWeather.temp << " deg C)" << endl;
     }
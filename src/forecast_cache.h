@@ -0,0 +1,360 @@
+#pragma once
+
+// Per-airport cache of parsed OpenWeatherMap 5-day / 3-hour forecasts, shared
+// by flight_booking and flight_simulator. Each airport's whole series is parsed
+// once and kept for a TTL (3 hours by default, the forecast's own update
+// interval). The cache is written to a small binary file so the next process
+// starts warm; point AEROROUTE_FORECAST_CACHE elsewhere, or set
+// AEROROUTE_FORECAST_TTL in seconds. Replay and storm runs (weather_provider.h)
+// keep the cache in memory only, so they never mix with live data.
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include "weather_provider.h"
+#include "weather_records.h"
+
+// Reads up to `width` digits at p (skipping one leading separator), advancing p.
+inline int parseField(const char *&p, int width)
+{
+    while (*p && (*p < '0' || *p > '9'))
+        ++p;
+    int v = 0;
+    for (int i = 0; i < width && *p >= '0' && *p <= '9'; ++i)
+        v = v * 10 + (*p++ - '0');
+    return v;
+}
+
+// "dd/mm/yyyy" and "HH:MM" as seconds on the same clock as the forecast's
+// `dt`. Forecast slots are UTC and were always compared field-for-field with
+// the requested wall-clock time, so no timezone is applied on either side.
+inline long long forecastQueryTime(const std::string &date, const std::string &time)
+{
+    const char *p = date.c_str();
+    int d = parseField(p, 2), m = parseField(p, 2), y = parseField(p, 4);
+    const char *q = time.c_str();
+    int hh = parseField(q, 2), mm = parseField(q, 2);
+    return daysFromCivil(y, m, d) * 86400 + hh * 3600 + mm * 60;
+}
+
+// One airport's forecast as parallel arrays sorted by time. Conditions are
+// WeatherMain codes and descriptions are ids in the DescriptionTable.
+struct ForecastSeries
+{
+    long long fetchedAt = 0;
+    std::vector<long long> time;
+    std::vector<WeatherMain> condition;
+    std::vector<uint16_t> description;
+    std::vector<float> temp;
+    std::vector<uint8_t> humidity;
+    std::vector<float> wind;
+
+    size_t size() const { return time.size(); }
+    bool empty() const { return time.empty(); }
+    const std::string &main(size_t i) const { return weatherMainName(condition[i]); }
+    const std::string &desc(size_t i) const { return DescriptionTable::instance().text(description[i]); }
+
+    void add(const WeatherRecord &r)
+    {
+        time.push_back(r.time);
+        condition.push_back(r.main);
+        description.push_back(r.description);
+        temp.push_back(r.temp);
+        humidity.push_back(r.humidity);
+        wind.push_back(r.wind);
+    }
+
+    // Index of the slot nearest to t (the earlier one on a tie), or -1.
+    int closest(long long t) const
+    {
+        if (time.empty())
+            return -1;
+        size_t hi = std::lower_bound(time.begin(), time.end(), t) - time.begin();
+        if (hi == 0)
+            return 0;
+        if (hi == time.size())
+            return static_cast<int>(hi - 1);
+        return t - time[hi - 1] <= time[hi] - t ? static_cast<int>(hi - 1) : static_cast<int>(hi);
+    }
+};
+
+inline ForecastSeries parseForecastSeries(const std::string &text)
+{
+    thread_local std::vector<WeatherRecord> records;
+    records.clear();
+    ForecastSeries series;
+    series.fetchedAt = static_cast<long long>(std::time(nullptr));
+    if (!parseForecastRecords(text, records))
+        return series;
+    if (!std::is_sorted(records.begin(), records.end(), [](const WeatherRecord &a, const WeatherRecord &b)
+                        { return a.time < b.time; }))
+        std::stable_sort(records.begin(), records.end(), [](const WeatherRecord &a, const WeatherRecord &b)
+                         { return a.time < b.time; });
+    for (const auto &r : records)
+        series.add(r);
+    return series;
+}
+
+inline std::string forecastCachePath()
+{
+    if (weatherMode() == "replay" || weatherMode() == "storm")
+        return "";
+    const char *env = getenv("AEROROUTE_FORECAST_CACHE");
+    return env && *env ? env : "forecast_cache.bin";
+}
+
+inline long long forecastCacheTtl()
+{
+    const char *env = getenv("AEROROUTE_FORECAST_TTL");
+    return env && *env ? atoll(env) : 3 * 3600;
+}
+
+class ForecastCache
+{
+public:
+    ForecastCache(WeatherProvider &client, std::string path = forecastCachePath(), long long ttlSeconds = forecastCacheTtl())
+        : client(client), path(std::move(path)), ttl(ttlSeconds)
+    {
+        // Construct the table first so it outlives a global cache saving on exit.
+        DescriptionTable::instance();
+        load();
+    }
+
+    ~ForecastCache()
+    {
+        if (dirty && !path.empty())
+            save();
+    }
+
+    ForecastCache(const ForecastCache &) = delete;
+    ForecastCache &operator=(const ForecastCache &) = delete;
+
+    // Starts fetching the airport's series unless a fresh copy is cached, so
+    // several airports can be requested before the first get().
+    void prefetch(const std::string &code, double lat, double lon, const std::string &apiKey)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Slot &slot = slots[code];
+        if (!isFresh(slot) && !slot.pending.valid())
+            slot.pending = client.fetchForecast(lat, lon, apiKey);
+    }
+
+    // The airport's series; empty when the API could not be reached.
+    std::shared_ptr<const ForecastSeries> get(const std::string &code, double lat, double lon, const std::string &apiKey)
+    {
+        std::shared_future<WeatherResponse> pending;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            Slot &slot = slots[code];
+            if (isFresh(slot))
+            {
+                ++hitCount;
+                return slot.series;
+            }
+            if (!slot.pending.valid())
+                slot.pending = client.fetchForecast(lat, lon, apiKey);
+            pending = slot.pending;
+        }
+
+        const WeatherResponse &r = pending.get();
+        auto series = std::make_shared<ForecastSeries>();
+        if (r.status == 200)
+            *series = parseForecastSeries(r.text);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        Slot &slot = slots[code];
+        ++missCount;
+        if (slot.pending.valid())
+        {
+            slot.pending = std::shared_future<WeatherResponse>();
+            if (!series->empty())
+            {
+                slot.series = series;
+                dirty = true;
+            }
+        }
+        // Offline: a stale series beats none at all.
+        if (series->empty() && slot.series)
+            return slot.series;
+        return isFresh(slot) ? slot.series : series;
+    }
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+
+    // File layout: "AFC3", the description table (u16 count, strings), u32
+    // airport count, then per airport the code, i64 fetch time, u32 slot count
+    // and each column as one block. Strings are u8-length prefixed; numbers
+    // are native-endian.
+    bool save()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (path.empty())
+            return false;
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+            out.write("AFC3", 4);
+            DescriptionTable &descriptions = DescriptionTable::instance();
+            uint16_t texts = static_cast<uint16_t>(descriptions.size());
+            writePod(out, texts);
+            for (uint16_t id = 0; id < texts; ++id)
+                writeString(out, descriptions.text(id));
+            uint32_t count = 0;
+            for (const auto &kv : slots)
+                count += kv.second.series ? 1 : 0;
+            writePod(out, count);
+            for (const auto &kv : slots)
+            {
+                if (!kv.second.series)
+                    continue;
+                const ForecastSeries &s = *kv.second.series;
+                writeString(out, kv.first);
+                writePod(out, s.fetchedAt);
+                writePod(out, static_cast<uint32_t>(s.size()));
+                writeColumn(out, s.time);
+                writeColumn(out, s.condition);
+                writeColumn(out, s.description);
+                writeColumn(out, s.temp);
+                writeColumn(out, s.humidity);
+                writeColumn(out, s.wind);
+            }
+            if (!out)
+                return false;
+        }
+        std::remove(path.c_str());
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            return false;
+        dirty = false;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<const ForecastSeries> series;
+        std::shared_future<WeatherResponse> pending;
+    };
+
+    WeatherProvider &client;
+    std::string path;
+    long long ttl;
+    std::unordered_map<std::string, Slot> slots;
+    std::mutex mtx;
+    bool dirty = false;
+    std::atomic<size_t> hitCount{0};
+    std::atomic<size_t> missCount{0};
+
+    bool isFresh(const Slot &slot) const
+    {
+        return slot.series && static_cast<long long>(std::time(nullptr)) - slot.series->fetchedAt < ttl;
+    }
+
+    template <typename T>
+    static void writePod(std::ofstream &out, T value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static bool readPod(std::ifstream &in, T &value)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+    }
+
+    template <typename T>
+    static void writeColumn(std::ofstream &out, const std::vector<T> &v)
+    {
+        out.write(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+    }
+
+    // Whether `bytes` more can be read, so a count from a damaged file never
+    // sizes an allocation the file cannot fill.
+    static bool fits(std::ifstream &in, uint64_t bytes)
+    {
+        std::streampos at = in.tellg();
+        if (at < 0 || !in.seekg(0, std::ios::end))
+            return false;
+        std::streampos end = in.tellg();
+        in.seekg(at);
+        return end >= at && static_cast<uint64_t>(end - at) >= bytes;
+    }
+
+    template <typename T>
+    static bool readColumn(std::ifstream &in, std::vector<T> &v, uint32_t n)
+    {
+        if (!fits(in, uint64_t(n) * sizeof(T)))
+            return false;
+        v.resize(n);
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(v.data()), n * sizeof(T)));
+    }
+
+    static void writeString(std::ofstream &out, const std::string &s)
+    {
+        uint8_t len = static_cast<uint8_t>(std::min<size_t>(s.size(), 255));
+        writePod(out, len);
+        out.write(s.data(), len);
+    }
+
+    static bool readString(std::ifstream &in, std::string &s)
+    {
+        uint8_t len;
+        if (!readPod(in, len) || !fits(in, len))
+            return false;
+        s.resize(len);
+        return static_cast<bool>(in.read(&s[0], len));
+    }
+
+    // A missing or damaged file just means a cold start.
+    void load()
+    {
+        if (path.empty())
+            return;
+        std::ifstream in(path, std::ios::binary);
+        char magic[4];
+        uint32_t count;
+        uint16_t texts;
+        if (!in.read(magic, 4) || std::string(magic, 4) != "AFC3" || !readPod(in, texts) || !fits(in, texts))
+            return;
+        // File description ids are remapped into this process's table.
+        std::vector<uint16_t> remap(texts);
+        for (auto &id : remap)
+        {
+            std::string text;
+            if (!readString(in, text))
+                return;
+            id = DescriptionTable::instance().intern(text);
+        }
+        if (!readPod(in, count))
+            return;
+        std::unordered_map<std::string, Slot> loaded;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            std::string code;
+            auto series = std::make_shared<ForecastSeries>();
+            uint32_t n;
+            if (!readString(in, code) || !readPod(in, series->fetchedAt) || !readPod(in, n) ||
+                !readColumn(in, series->time, n) || !readColumn(in, series->condition, n) || !readColumn(in, series->description, n) ||
+                !readColumn(in, series->temp, n) || !readColumn(in, series->humidity, n) || !readColumn(in, series->wind, n))
+                return;
+            for (auto &c : series->condition)
+                if (c >= WeatherMain::Count)
+                    c = WeatherMain::Unknown;
+            for (auto &d : series->description)
+                d = d < remap.size() ? remap[d] : 0;
+            loaded[code].series = series;
+        }
+        slots.swap(loaded);
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+// Static k-d tree over airport unit-sphere positions (see geodesic.h).
+// Straight-line chord length is monotonic in great-circle distance, so a
+// plain 3-d tree answers radius and k-nearest queries on the sphere exactly.
+// The tree is implicit: points are stored in tree order, the median of every
+// range being its splitting node, so the index is a few flat arrays that copy
+// along with the graph that owns it.
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <numeric>
+#include "geodesic.h"
+
+class GeoIndex
+{
+public:
+    void build(const GeoPoints &points)
+    {
+        order.resize(points.size());
+        std::iota(order.begin(), order.end(), 0);
+        axis.assign(points.size(), 0);
+        x = points.x;
+        y = points.y;
+        z = points.z;
+        buildRange(0, static_cast<int>(order.size()));
+
+        // Re-lay the coordinates out in tree order so queries walk memory linearly.
+        std::vector<double> tx(order.size()), ty(order.size()), tz(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            tx[i] = points.x[order[i]];
+            ty[i] = points.y[order[i]];
+            tz[i] = points.z[order[i]];
+        }
+        x.swap(tx);
+        y.swap(ty);
+        z.swap(tz);
+    }
+
+    size_t size() const { return order.size(); }
+
+    // All points within radiusKm of q, in no particular order.
+    void within(const UnitVector &q, double radiusKm, std::vector<int> &out) const
+    {
+        if (!order.empty())
+            withinRange(0, static_cast<int>(order.size()), q, kmToChord2(radiusKm), out);
+    }
+
+    // The k points closest to q (excluding `skip`), nearest first.
+    void nearest(const UnitVector &q, size_t k, std::vector<int> &out, int skip = -1) const
+    {
+        out.clear();
+        if (order.empty() || k == 0)
+            return;
+        std::priority_queue<std::pair<double, int>> best;
+        nearestRange(0, static_cast<int>(order.size()), q, k, skip, best);
+        out.resize(best.size());
+        for (size_t i = best.size(); i > 0; --i)
+        {
+            out[i - 1] = best.top().second;
+            best.pop();
+        }
+    }
+
+private:
+    std::vector<int> order;
+    std::vector<unsigned char> axis;
+    std::vector<double> x, y, z;
+
+    // During build() x/y/z are indexed by point id, afterwards by tree slot.
+    double coord(int p, int a) const
+    {
+        return a == 0 ? x[p] : a == 1 ? y[p] : z[p];
+    }
+
+    static double component(const UnitVector &q, int a)
+    {
+        return a == 0 ? q.x : a == 1 ? q.y : q.z;
+    }
+
+    double chord2(int slot, const UnitVector &q) const
+    {
+        double dx = x[slot] - q.x, dy = y[slot] - q.y, dz = z[slot] - q.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    void buildRange(int lo, int hi)
+    {
+        if (hi - lo <= 1)
+            return;
+        double lower[3] = {1e9, 1e9, 1e9}, upper[3] = {-1e9, -1e9, -1e9};
+        for (int i = lo; i < hi; ++i)
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                lower[a] = std::min(lower[a], coord(order[i], a));
+                upper[a] = std::max(upper[a], coord(order[i], a));
+            }
+        }
+        int a = 0;
+        for (int c = 1; c < 3; ++c)
+            if (upper[c] - lower[c] > upper[a] - lower[a])
+                a = c;
+
+        int mid = (lo + hi) / 2;
+        std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](int p, int q)
+                         { return coord(p, a) < coord(q, a); });
+        axis[mid] = static_cast<unsigned char>(a);
+        buildRange(lo, mid);
+        buildRange(mid + 1, hi);
+    }
+
+    void withinRange(int lo, int hi, const UnitVector &q, double limit, std::vector<int> &out) const
+    {
+        if (lo >= hi)
+            return;
+        int mid = (lo + hi) / 2;
+        if (chord2(mid, q) <= limit)
+            out.push_back(order[mid]);
+        if (hi - lo == 1)
+            return;
+        double diff = component(q, axis[mid]) - coord(mid, axis[mid]);
+        if (diff <= 0 || diff * diff <= limit)
+            withinRange(lo, mid, q, limit, out);
+        if (diff >= 0 || diff * diff <= limit)
+            withinRange(mid + 1, hi, q, limit, out);
+    }
+
+    void nearestRange(int lo, int hi, const UnitVector &q, size_t k, int skip, std::priority_queue<std::pair<double, int>> &best) const
+    {
+        if (lo >= hi)
+            return;
+        int mid = (lo + hi) / 2;
+        int p = order[mid];
+        if (p != skip)
+        {
+            double d = chord2(mid, q);
+            if (best.size() < k)
+                best.push({d, p});
+            else if (d < best.top().first)
+            {
+                best.pop();
+                best.push({d, p});
+            }
+        }
+        if (hi - lo == 1)
+            return;
+        double diff = component(q, axis[mid]) - coord(mid, axis[mid]);
+        int nearLo = diff < 0 ? lo : mid + 1, nearHi = diff < 0 ? mid : hi;
+        int farLo = diff < 0 ? mid + 1 : lo, farHi = diff < 0 ? hi : mid;
+        nearestRange(nearLo, nearHi, q, k, skip, best);
+        if (best.size() < k || diff * diff < best.top().first)
+            nearestRange(farLo, farHi, q, k, skip, best);
+    }
+};
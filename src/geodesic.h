@@ -0,0 +1,172 @@
+#pragma once
+
+// Great-circle kernels over airports stored as unit-sphere xyz.
+// Positions are kept as a struct-of-arrays so one-to-many queries stream
+// through x/y/z with AVX-512 or AVX2 when the compiler targets them, and a
+// plain loop otherwise. Radius tests compare squared chord lengths, so edge
+// generation and nearest-airport lookups need no trigonometry at all;
+// only converting a chord to kilometres costs one asin.
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+const double EarthRadiusKm = 6371.0;
+
+struct UnitVector
+{
+    double x;
+    double y;
+    double z;
+};
+
+inline UnitVector unitVector(double latDeg, double lonDeg)
+{
+    const double toRad = 3.14159265358979323846 / 180.0;
+    double lat = latDeg * toRad, lon = lonDeg * toRad;
+    double c = std::cos(lat);
+    return {c * std::cos(lon), c * std::sin(lon), std::sin(lat)};
+}
+
+inline double chord2ToKm(double chord2)
+{
+    return 2.0 * EarthRadiusKm * std::asin(std::min(1.0, 0.5 * std::sqrt(chord2)));
+}
+
+inline double kmToChord2(double km)
+{
+    double s = std::sin(std::min(km / EarthRadiusKm, 3.14159265358979323846) * 0.5);
+    return 4.0 * s * s;
+}
+
+inline double greatCircleKm(const UnitVector &a, const UnitVector &b)
+{
+    double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return chord2ToKm(dx * dx + dy * dy + dz * dz);
+}
+
+inline const char *geodesicKernelName()
+{
+#if defined(__AVX512F__)
+    return "avx512";
+#elif defined(__AVX2__)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
+
+struct GeoPoints
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+
+    size_t size() const { return x.size(); }
+
+    void add(double latDeg, double lonDeg)
+    {
+        UnitVector p = unitVector(latDeg, lonDeg);
+        x.push_back(p.x);
+        y.push_back(p.y);
+        z.push_back(p.z);
+    }
+
+    UnitVector at(size_t i) const { return {x[i], y[i], z[i]}; }
+
+    double distanceKm(size_t a, size_t b) const { return greatCircleKm(at(a), at(b)); }
+
+    // Squared chord length from q to every point in [begin, end), written to out[0..end-begin).
+    void chord2From(const UnitVector &q, size_t begin, size_t end, double *out) const
+    {
+        size_t i = begin;
+#if defined(__AVX512F__)
+        __m512d qx = _mm512_set1_pd(q.x), qy = _mm512_set1_pd(q.y), qz = _mm512_set1_pd(q.z);
+        for (; i + 8 <= end; i += 8)
+        {
+            __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(&x[i]), qx);
+            __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(&y[i]), qy);
+            __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(&z[i]), qz);
+            __m512d d2 = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+            _mm512_storeu_pd(out + (i - begin), d2);
+        }
+#elif defined(__AVX2__)
+        __m256d qx = _mm256_set1_pd(q.x), qy = _mm256_set1_pd(q.y), qz = _mm256_set1_pd(q.z);
+        for (; i + 4 <= end; i += 4)
+        {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&x[i]), qx);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&y[i]), qy);
+            __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(&z[i]), qz);
+#ifdef __FMA__
+            __m256d d2 = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+#else
+            __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+#endif
+            _mm256_storeu_pd(out + (i - begin), d2);
+        }
+#endif
+        for (; i < end; ++i)
+        {
+            double dx = x[i] - q.x, dy = y[i] - q.y, dz = z[i] - q.z;
+            out[i - begin] = dx * dx + dy * dy + dz * dz;
+        }
+    }
+
+    // Great-circle kilometres from q to every point in [begin, end).
+    void distancesKm(const UnitVector &q, size_t begin, size_t end, double *out) const
+    {
+        chord2From(q, begin, end, out);
+        for (size_t k = 0; k < end - begin; ++k)
+            out[k] = chord2ToKm(out[k]);
+    }
+
+    void distancesKm(size_t from, std::vector<double> &out) const
+    {
+        out.resize(size());
+        distancesKm(at(from), 0, size(), out.data());
+    }
+
+    // Indices of all points within radiusKm of q, found by comparing chords.
+    void within(const UnitVector &q, double radiusKm, std::vector<int> &out) const
+    {
+        const size_t block = 512;
+        double chord2[block];
+        double limit = kmToChord2(radiusKm);
+        for (size_t begin = 0; begin < size(); begin += block)
+        {
+            size_t end = std::min(size(), begin + block);
+            chord2From(q, begin, end, chord2);
+            for (size_t k = 0; k < end - begin; ++k)
+                if (chord2[k] <= limit)
+                    out.push_back(static_cast<int>(begin + k));
+        }
+    }
+
+    int nearest(const UnitVector &q, int skip = -1) const
+    {
+        const size_t block = 512;
+        double chord2[block];
+        double best = std::numeric_limits<double>::infinity();
+        int bestIndex = -1;
+        for (size_t begin = 0; begin < size(); begin += block)
+        {
+            size_t end = std::min(size(), begin + block);
+            chord2From(q, begin, end, chord2);
+            for (size_t k = 0; k < end - begin; ++k)
+            {
+                if (chord2[k] < best && static_cast<int>(begin + k) != skip)
+                {
+                    best = chord2[k];
+                    bestIndex = static_cast<int>(begin + k);
+                }
+            }
+        }
+        return bestIndex;
+    }
+};
@@ -0,0 +1,729 @@
+#pragma once
+
+// Small HTTP/1.1 server used by the long-running route service.
+// One thread drives an event loop (epoll on Linux, poll/WSAPoll elsewhere);
+// connections are kept alive and pipelined requests are answered in order,
+// with all responses produced by one read flushed in a single send.
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define AEROROUTE_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+typedef int socket_t;
+#define AEROROUTE_INVALID_SOCKET (-1)
+#endif
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;
+    std::string body;
+    std::unordered_map<std::string, std::string> params;
+    bool keepAlive = true;
+
+    std::string param(const std::string &key, const std::string &fallback = "") const
+    {
+        auto it = params.find(key);
+        return it == params.end() ? fallback : it->second;
+    }
+};
+
+struct HttpResponse
+{
+    int status = 200;
+    std::string body;
+    std::string contentType = "application/json";
+};
+
+typedef std::function<HttpResponse(const HttpRequest &)> HttpHandler;
+
+namespace http_detail
+{
+    inline bool socketsReady()
+    {
+#ifdef _WIN32
+        static bool ready = []()
+        {
+            WSADATA wsa;
+            return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+        }();
+        return ready;
+#else
+        return true;
+#endif
+    }
+
+    inline void closeSocket(socket_t s)
+    {
+#ifdef _WIN32
+        closesocket(s);
+#else
+        close(s);
+#endif
+    }
+
+    inline void setNonBlocking(socket_t s, bool enabled = true)
+    {
+#ifdef _WIN32
+        u_long mode = enabled ? 1 : 0;
+        ioctlsocket(s, FIONBIO, &mode);
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        fcntl(s, F_SETFL, enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+    }
+
+    inline void setReceiveTimeout(socket_t s, int ms)
+    {
+#ifdef _WIN32
+        DWORD timeout = ms;
+#else
+        timeval timeout{ms / 1000, (ms % 1000) * 1000};
+#endif
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+    }
+
+    inline void setNoDelay(socket_t s)
+    {
+        int one = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&one), sizeof(one));
+    }
+
+    inline bool wouldBlock()
+    {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+    }
+
+    inline std::string urlDecode(const std::string &s)
+    {
+        std::string out;
+        out.reserve(s.size());
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            if (s[i] == '+')
+                out += ' ';
+            else if (s[i] == '%' && i + 2 < s.size())
+            {
+                out += static_cast<char>(strtol(s.substr(i + 1, 2).c_str(), nullptr, 16));
+                i += 2;
+            }
+            else
+                out += s[i];
+        }
+        return out;
+    }
+
+    inline void parseQuery(const std::string &query, std::unordered_map<std::string, std::string> &params)
+    {
+        size_t start = 0;
+        while (start < query.size())
+        {
+            size_t amp = query.find('&', start);
+            if (amp == std::string::npos)
+                amp = query.size();
+            std::string pair = query.substr(start, amp - start);
+            size_t eq = pair.find('=');
+            if (eq == std::string::npos)
+                params[urlDecode(pair)] = "";
+            else
+                params[urlDecode(pair.substr(0, eq))] = urlDecode(pair.substr(eq + 1));
+            start = amp + 1;
+        }
+    }
+
+    inline bool iequalsPrefix(const char *line, size_t len, const char *name)
+    {
+        size_t n = strlen(name);
+        if (len < n)
+            return false;
+        for (size_t i = 0; i < n; ++i)
+            if (tolower(static_cast<unsigned char>(line[i])) != name[i])
+                return false;
+        return true;
+    }
+
+    // Largest request body accepted; anything bigger is answered 413 unread.
+    constexpr size_t MaxBodyBytes = 8 << 20;
+
+    // Parses one request from the front of buf. Returns the number of bytes
+    // consumed, 0 if the request is still incomplete, -1 on a malformed one
+    // or -2 when its body is over MaxBodyBytes.
+    inline long parseRequest(const std::string &buf, size_t offset, HttpRequest &req)
+    {
+        size_t headerEnd = buf.find("\r\n\r\n", offset);
+        if (headerEnd == std::string::npos)
+            return buf.size() - offset > 64 * 1024 ? -1 : 0;
+
+        size_t lineEnd = buf.find("\r\n", offset);
+        size_t sp1 = buf.find(' ', offset);
+        size_t sp2 = sp1 == std::string::npos ? std::string::npos : buf.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos || sp2 > lineEnd)
+            return -1;
+
+        req.method = buf.substr(offset, sp1 - offset);
+        std::string target = buf.substr(sp1 + 1, sp2 - sp1 - 1);
+        req.keepAlive = buf.compare(sp2 + 1, 8, "HTTP/1.0") != 0;
+        size_t q = target.find('?');
+        req.path = target.substr(0, q);
+        req.params.clear();
+        if (q != std::string::npos)
+            parseQuery(target.substr(q + 1), req.params);
+
+        size_t contentLength = 0;
+        size_t pos = lineEnd + 2;
+        while (pos < headerEnd)
+        {
+            size_t eol = buf.find("\r\n", pos);
+            const char *line = buf.data() + pos;
+            size_t len = eol - pos;
+            if (iequalsPrefix(line, len, "content-length:"))
+                contentLength = strtoul(line + 15, nullptr, 10);
+            else if (iequalsPrefix(line, len, "connection:"))
+            {
+                std::string value = buf.substr(pos + 11, len - 11);
+                std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+                if (value.find("close") != std::string::npos)
+                    req.keepAlive = false;
+                else if (value.find("keep-alive") != std::string::npos)
+                    req.keepAlive = true;
+            }
+            pos = eol + 2;
+        }
+
+        if (contentLength > MaxBodyBytes)
+            return -2;
+        size_t bodyStart = headerEnd + 4;
+        if (buf.size() < bodyStart + contentLength)
+            return 0;
+        req.body = buf.substr(bodyStart, contentLength);
+        return static_cast<long>(bodyStart + contentLength - offset);
+    }
+
+    inline const char *statusText(int status)
+    {
+        switch (status)
+        {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 409:
+            return "Conflict";
+        case 413:
+            return "Payload Too Large";
+        default:
+            return "Internal Server Error";
+        }
+    }
+
+    // Reply to a request parseRequest refused (its negative result).
+    inline HttpResponse rejection(long parsed)
+    {
+        if (parsed == -2)
+            return {413, "{\"error\":\"request body too large\"}"};
+        return {400, "{\"error\":\"malformed request\"}"};
+    }
+
+    inline void appendResponse(std::string &out, const HttpResponse &res, bool keepAlive)
+    {
+        out += "HTTP/1.1 ";
+        out += std::to_string(res.status);
+        out += ' ';
+        out += statusText(res.status);
+        out += "\r\nContent-Type: ";
+        out += res.contentType;
+        out += "\r\nContent-Length: ";
+        out += std::to_string(res.body.size());
+        out += keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+        out += res.body;
+    }
+}
+
+class HttpServer
+{
+public:
+    HttpServer(int port, HttpHandler handler) : port(port), handler(std::move(handler)) {}
+
+    ~HttpServer()
+    {
+        for (auto &[fd, conn] : connections)
+            http_detail::closeSocket(fd);
+        if (listener != AEROROUTE_INVALID_SOCKET)
+            http_detail::closeSocket(listener);
+#ifdef __linux__
+        if (epollFd >= 0)
+            close(epollFd);
+#endif
+    }
+
+    bool start()
+    {
+        if (!http_detail::socketsReady())
+            return false;
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == AEROROUTE_INVALID_SOCKET)
+            return false;
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&one), sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<unsigned short>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listener, 512) != 0)
+            return false;
+        http_detail::setNonBlocking(listener);
+
+#ifdef __linux__
+        epollFd = epoll_create1(0);
+        if (epollFd < 0)
+            return false;
+        watch(listener, false);
+#endif
+        return true;
+    }
+
+    void stop() { running = false; }
+
+    size_t requestsServed() const { return served; }
+
+    void run()
+    {
+        running = true;
+        std::vector<std::pair<socket_t, int>> ready;
+        while (running)
+        {
+            ready.clear();
+            waitForEvents(ready, 200);
+            for (auto [fd, events] : ready)
+            {
+                if (fd == listener)
+                {
+                    acceptAll();
+                    continue;
+                }
+                if (events & EventRead)
+                    onReadable(fd);
+                if ((events & EventWrite) && connections.count(fd))
+                    flush(fd);
+            }
+        }
+    }
+
+    // Blocking variant for test stand-ins whose handlers may sleep: every
+    // connection gets its own thread, so one slow response never delays another.
+    void runThreadPerConnection()
+    {
+        running = true;
+        // Finished workers are joined on the next pass, so handles do not
+        // pile up under sustained load; the rest are joined at shutdown.
+        struct Worker
+        {
+            std::thread thread;
+            std::shared_ptr<std::atomic<bool>> done;
+        };
+        std::vector<Worker> workers;
+        while (running)
+        {
+            for (size_t i = 0; i < workers.size();)
+            {
+                if (!workers[i].done->load())
+                {
+                    ++i;
+                    continue;
+                }
+                workers[i].thread.join();
+                workers[i] = std::move(workers.back());
+                workers.pop_back();
+            }
+            pollfd pfd{listener, POLLIN, 0};
+#ifdef _WIN32
+            int n = WSAPoll(&pfd, 1, 200);
+#else
+            int n = poll(&pfd, 1, 200);
+#endif
+            if (n <= 0)
+                continue;
+            socket_t client = accept(listener, nullptr, nullptr);
+            if (client == AEROROUTE_INVALID_SOCKET)
+                continue;
+            http_detail::setNonBlocking(client, false);
+            http_detail::setNoDelay(client);
+            http_detail::setReceiveTimeout(client, 200);
+            auto done = std::make_shared<std::atomic<bool>>(false);
+            workers.push_back({std::thread([this, client, done]()
+                                           {
+                                               serveBlocking(client);
+                                               *done = true; }),
+                               done});
+        }
+        for (auto &w : workers)
+            w.thread.join();
+    }
+
+private:
+    enum
+    {
+        EventRead = 1,
+        EventWrite = 2
+    };
+
+    struct Connection
+    {
+        std::string in;
+        std::string out;
+        bool closeAfterWrite = false;
+        bool wantWrite = false;
+    };
+
+    int port;
+    HttpHandler handler;
+    socket_t listener = AEROROUTE_INVALID_SOCKET;
+    std::unordered_map<socket_t, Connection> connections;
+    std::atomic<bool> running{false};
+    size_t served = 0;
+#ifdef __linux__
+    int epollFd = -1;
+
+    void watch(socket_t fd, bool wantWrite, bool modify = false)
+    {
+        epoll_event ev{};
+        ev.events = static_cast<uint32_t>(EPOLLIN) | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, modify ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+    }
+#endif
+
+    void waitForEvents(std::vector<std::pair<socket_t, int>> &ready, int timeoutMs)
+    {
+#ifdef __linux__
+        epoll_event events[256];
+        int n = epoll_wait(epollFd, events, 256, timeoutMs);
+        for (int i = 0; i < n; ++i)
+        {
+            int flags = 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                flags |= EventRead;
+            if (events[i].events & EPOLLOUT)
+                flags |= EventWrite;
+            socket_t fd = events[i].data.fd;
+            ready.push_back({fd, flags});
+        }
+#else
+        std::vector<pollfd> fds;
+        fds.reserve(connections.size() + 1);
+        fds.push_back({listener, POLLIN, 0});
+        for (auto &[fd, conn] : connections)
+            fds.push_back({fd, static_cast<short>(POLLIN | (conn.wantWrite ? POLLOUT : 0)), 0});
+#ifdef _WIN32
+        int n = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeoutMs);
+#else
+        int n = poll(fds.data(), fds.size(), timeoutMs);
+#endif
+        for (int i = 0; n > 0 && i < static_cast<int>(fds.size()); ++i)
+        {
+            int flags = 0;
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                flags |= EventRead;
+            if (fds[i].revents & POLLOUT)
+                flags |= EventWrite;
+            if (flags)
+                ready.push_back({fds[i].fd, flags});
+        }
+#endif
+    }
+
+    void serveBlocking(socket_t client)
+    {
+        std::string in, out;
+        char buf[16384];
+        HttpRequest req;
+        bool open = true;
+        while (open && running)
+        {
+            long used = http_detail::parseRequest(in, 0, req);
+            if (used > 0)
+            {
+                in.erase(0, used);
+                out.clear();
+                http_detail::appendResponse(out, handler(req), req.keepAlive);
+                send(client, out.data(), static_cast<int>(out.size()), 0);
+                open = req.keepAlive;
+                continue;
+            }
+            if (used < 0)
+            {
+                out.clear();
+                http_detail::appendResponse(out, http_detail::rejection(used), false);
+                send(client, out.data(), static_cast<int>(out.size()), 0);
+                break;
+            }
+            int n = recv(client, buf, sizeof(buf), 0);
+            if (n > 0)
+                in.append(buf, n);
+            else if (n == 0 || !http_detail::wouldBlock())
+                break;
+        }
+        http_detail::closeSocket(client);
+    }
+
+    void acceptAll()
+    {
+        while (true)
+        {
+            socket_t client = accept(listener, nullptr, nullptr);
+            if (client == AEROROUTE_INVALID_SOCKET)
+                return;
+            http_detail::setNonBlocking(client);
+            http_detail::setNoDelay(client);
+            connections[client];
+#ifdef __linux__
+            watch(client, false);
+#endif
+        }
+    }
+
+    void drop(socket_t fd)
+    {
+#ifdef __linux__
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+        http_detail::closeSocket(fd);
+        connections.erase(fd);
+    }
+
+    void onReadable(socket_t fd)
+    {
+        auto it = connections.find(fd);
+        if (it == connections.end())
+            return;
+        Connection &conn = it->second;
+
+        char buf[16384];
+        while (true)
+        {
+            int n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0)
+            {
+                conn.in.append(buf, n);
+                continue;
+            }
+            if (n < 0 && http_detail::wouldBlock())
+                break;
+            drop(fd);
+            return;
+        }
+
+        // Answer every complete request in the buffer before writing anything,
+        // so a pipelined burst costs one send instead of one per request.
+        size_t offset = 0;
+        HttpRequest req;
+        while (!conn.closeAfterWrite)
+        {
+            long used = http_detail::parseRequest(conn.in, offset, req);
+            if (used < 0)
+            {
+                http_detail::appendResponse(conn.out, http_detail::rejection(used), false);
+                conn.closeAfterWrite = true;
+                break;
+            }
+            if (used == 0)
+                break;
+            offset += used;
+            HttpResponse res = handler(req);
+            http_detail::appendResponse(conn.out, res, req.keepAlive);
+            ++served;
+            if (!req.keepAlive)
+                conn.closeAfterWrite = true;
+        }
+        conn.in.erase(0, offset);
+        flush(fd);
+    }
+
+    void flush(socket_t fd)
+    {
+        Connection &conn = connections[fd];
+        size_t sent = 0;
+        while (sent < conn.out.size())
+        {
+            int n = send(fd, conn.out.data() + sent, static_cast<int>(conn.out.size() - sent), 0);
+            if (n > 0)
+            {
+                sent += n;
+                continue;
+            }
+            if (n < 0 && http_detail::wouldBlock())
+                break;
+            drop(fd);
+            return;
+        }
+        conn.out.erase(0, sent);
+
+        if (conn.out.empty() && conn.closeAfterWrite)
+        {
+            drop(fd);
+            return;
+        }
+        bool wantWrite = !conn.out.empty();
+        if (wantWrite != conn.wantWrite)
+        {
+            conn.wantWrite = wantWrite;
+#ifdef __linux__
+            watch(fd, wantWrite, true);
+#endif
+        }
+    }
+};
+
+struct HttpLoadReport
+{
+    size_t requests = 0;
+    size_t errors = 0;
+    double seconds = 0;
+    double qps = 0;
+    double p50us = 0;
+    double p99us = 0;
+    double p999us = 0;
+    double maxus = 0;
+};
+
+// Closed-loop load generator: each connection keeps `depth` pipelined GETs
+// in flight and records per-request latency from send to full response.
+inline HttpLoadReport runHttpLoad(int port, const std::vector<std::string> &targets, int connectionsCount, int depth, double seconds)
+{
+    using clock = std::chrono::steady_clock;
+    HttpLoadReport report;
+    if (!http_detail::socketsReady() || targets.empty())
+        return report;
+
+    std::vector<std::vector<double>> latencies(connectionsCount);
+    std::vector<size_t> errors(connectionsCount, 0);
+    std::vector<std::thread> workers;
+    auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+    auto began = clock::now();
+
+    for (int c = 0; c < connectionsCount; ++c)
+    {
+        workers.emplace_back([&, c]()
+        {
+            socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<unsigned short>(port));
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (connect(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            {
+                ++errors[c];
+                http_detail::closeSocket(s);
+                return;
+            }
+            http_detail::setNoDelay(s);
+
+            std::string in;
+            char buf[65536];
+            size_t next = c;
+            std::vector<clock::time_point> sentAt;
+            while (clock::now() < deadline)
+            {
+                std::string batch;
+                sentAt.clear();
+                for (int d = 0; d < depth; ++d)
+                {
+                    batch += "GET " + targets[next++ % targets.size()] + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+                }
+                auto t0 = clock::now();
+                if (send(s, batch.data(), static_cast<int>(batch.size()), 0) != static_cast<int>(batch.size()))
+                {
+                    ++errors[c];
+                    break;
+                }
+                int received = 0;
+                while (received < depth)
+                {
+                    size_t headerEnd = in.find("\r\n\r\n");
+                    if (headerEnd != std::string::npos)
+                    {
+                        size_t cl = in.find("Content-Length: ");
+                        size_t length = cl < headerEnd ? strtoul(in.c_str() + cl + 16, nullptr, 10) : 0;
+                        if (in.size() >= headerEnd + 4 + length)
+                        {
+                            if (in.compare(9, 3, "200") != 0)
+                                ++errors[c];
+                            in.erase(0, headerEnd + 4 + length);
+                            latencies[c].push_back(std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+                            ++received;
+                            continue;
+                        }
+                    }
+                    int n = recv(s, buf, sizeof(buf), 0);
+                    if (n <= 0)
+                    {
+                        ++errors[c];
+                        http_detail::closeSocket(s);
+                        return;
+                    }
+                    in.append(buf, n);
+                }
+            }
+            http_detail::closeSocket(s);
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+
+    std::vector<double> all;
+    for (int c = 0; c < connectionsCount; ++c)
+    {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        report.errors += errors[c];
+    }
+    report.seconds = std::chrono::duration<double>(clock::now() - began).count();
+    report.requests = all.size();
+    if (all.empty())
+        return report;
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p)
+    { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+    report.qps = report.requests / report.seconds;
+    report.p50us = pct(0.50);
+    report.p99us = pct(0.99);
+    report.p999us = pct(0.999);
+    report.maxus = all.back();
+    return report;
+}
@@ -0,0 +1,294 @@
+#pragma once
+
+// Hub labels: an exact distance oracle for one metric over an undirected
+// graph. Every airport keeps a label: (hub, distance) pairs sorted by hub,
+// chosen so that for any s and t some shared hub lies on a shortest s-t
+// path. A query is then a merge over two short arrays with no search at all.
+//
+// Labels are built by pruned Dijkstra searches (pruned landmark labeling)
+// from each airport in hierarchy order, most important first: a search
+// stops wherever the labels built so far already explain the distance.
+// Because the graph is undirected one label per airport serves as both its
+// forward and backward label.
+//
+// A label set saves to a flat file (magic "AHL2", node and entry counts, a
+// caller-chosen key such as a hash of the closures it was built for, then
+// the per-airport offsets, all hubs and all distances) that load() checks,
+// maps and queries in place.
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "mapped_file.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+class HubLabels
+{
+public:
+    static constexpr float Inf = std::numeric_limits<float>::infinity();
+    // Labels are padded to whole SIMD blocks with this hub and Inf distance.
+    static constexpr int32_t Pad = std::numeric_limits<int32_t>::max();
+    static constexpr uint32_t Block = 8;
+
+    HubLabels() = default;
+    HubLabels(HubLabels &&) = default;
+    HubLabels &operator=(HubLabels &&) = default;
+
+    // Copies share a mapped file and own a copy of built labels.
+    HubLabels(const HubLabels &other)
+        : count(other.count), entries(other.entries), largest(other.largest), first(other.first), hubs(other.hubs), dists(other.dists),
+          firstStore(other.firstStore), hubStore(other.hubStore), distStore(other.distStore), mapped(other.mapped)
+    {
+        if (!mapped && count)
+        {
+            first = firstStore.data();
+            hubs = hubStore.data();
+            dists = distStore.data();
+        }
+    }
+    HubLabels &operator=(const HubLabels &other) { return *this = HubLabels(other); }
+
+    // `order` lists nodes least important first (a CCH order will do); edges
+    // with an infinite weight are left out.
+    void build(int n, const std::vector<std::pair<int, int>> &edges, const std::vector<double> &weight, const std::vector<int> &order)
+    {
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<std::vector<std::pair<int, double>>> adj(n);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            if (weight[e] == inf)
+                continue;
+            adj[edges[e].first].push_back({edges[e].second, weight[e]});
+            adj[edges[e].second].push_back({edges[e].first, weight[e]});
+        }
+
+        std::vector<std::vector<std::pair<int32_t, double>>> labels(n);
+        std::vector<double> dist(n, inf), viaRoot(n, inf);
+        std::vector<int> reached;
+        using Item = std::pair<double, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+        for (int k = 0; k < n; ++k)
+        {
+            int root = order[n - 1 - k];
+            for (const auto &[h, d] : labels[root])
+                viaRoot[h] = d;
+            dist[root] = 0;
+            reached.push_back(root);
+            pq.push({0, root});
+            while (!pq.empty())
+            {
+                auto [d, u] = pq.top();
+                pq.pop();
+                if (d > dist[u])
+                    continue;
+                bool covered = false;
+                for (const auto &[h, dh] : labels[u])
+                {
+                    if (viaRoot[h] + dh <= d)
+                    {
+                        covered = true;
+                        break;
+                    }
+                }
+                if (covered)
+                    continue;
+                labels[u].push_back({k, d});
+                for (const auto &[v, w] : adj[u])
+                {
+                    if (d + w < dist[v])
+                    {
+                        if (dist[v] == inf)
+                            reached.push_back(v);
+                        dist[v] = d + w;
+                        pq.push({dist[v], v});
+                    }
+                }
+            }
+            for (int v : reached)
+                dist[v] = inf;
+            reached.clear();
+            for (const auto &[h, d] : labels[root])
+                viaRoot[h] = inf;
+        }
+
+        mapped.reset();
+        count = static_cast<uint32_t>(n);
+        entries = 0;
+        largest = 0;
+        firstStore.assign(n + 1, 0);
+        for (int v = 0; v < n; ++v)
+            firstStore[v + 1] = firstStore[v] + padded(labels[v].size());
+        hubStore.assign(firstStore[n], Pad);
+        distStore.assign(firstStore[n], Inf);
+        for (int v = 0; v < n; ++v)
+        {
+            for (size_t i = 0; i < labels[v].size(); ++i)
+            {
+                hubStore[firstStore[v] + i] = labels[v][i].first;
+                distStore[firstStore[v] + i] = static_cast<float>(labels[v][i].second);
+            }
+            entries += labels[v].size();
+            largest = std::max(largest, labels[v].size());
+        }
+        first = firstStore.data();
+        hubs = hubStore.data();
+        dists = distStore.data();
+    }
+
+    bool empty() const { return count == 0; }
+    uint32_t nodes() const { return count; }
+    size_t labelEntries() const { return entries; }
+    size_t largestLabel() const { return largest; }
+    size_t bytes() const { return (count + 1) * sizeof(uint32_t) + (count ? first[count] : 0) * (sizeof(int32_t) + sizeof(float)); }
+
+    // Exact s-t distance (to float precision), Inf if disconnected.
+    float distance(int s, int t) const
+    {
+        const int32_t *ha = hubs + first[s], *hb = hubs + first[t];
+        const float *da = dists + first[s], *db = dists + first[t];
+        const int32_t *endA = hubs + first[s + 1], *endB = hubs + first[t + 1];
+#if defined(__AVX2__)
+        // 8x8 block merge: compare a block of A against all eight rotations
+        // of a block of B, keep the cheapest matching sum, then advance
+        // whichever block ends on the smaller hub.
+        __m256 best = _mm256_set1_ps(Inf);
+        const __m256 inf = _mm256_set1_ps(Inf);
+        while (ha < endA && hb < endB)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ha));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hb));
+            __m256 wa = _mm256_loadu_ps(da);
+            __m256 wb = _mm256_loadu_ps(db);
+            __m256i rot = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+            for (int r = 0; r < 8; ++r)
+            {
+                __m256 eq = _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b));
+                best = _mm256_min_ps(best, _mm256_blendv_ps(inf, _mm256_add_ps(wa, wb), eq));
+                b = _mm256_permutevar8x32_epi32(b, rot);
+                wb = _mm256_permutevar8x32_ps(wb, rot);
+            }
+            int32_t lastA = ha[Block - 1], lastB = hb[Block - 1];
+            if (lastA <= lastB)
+                ha += Block, da += Block;
+            if (lastB <= lastA)
+                hb += Block, db += Block;
+        }
+        __m128 m = _mm_min_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+        m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+        return _mm_cvtss_f32(m);
+#else
+        float best = Inf;
+        while (ha < endA && hb < endB && *ha != Pad && *hb != Pad)
+        {
+            if (*ha < *hb)
+                ++ha, ++da;
+            else if (*hb < *ha)
+                ++hb, ++db;
+            else
+            {
+                best = std::min(best, *da + *db);
+                ++ha, ++da, ++hb, ++db;
+            }
+        }
+        return best;
+#endif
+    }
+
+    bool save(const std::string &path, uint64_t key = 0) const
+    {
+        std::string tmp = path + ".tmp";
+        FILE *f = fopen(tmp.c_str(), "wb");
+        if (!f)
+            return false;
+        uint32_t header[HeaderBytes / 4] = {0, count};
+        memcpy(header, Magic, 4);
+        uint64_t total = count ? first[count] : 0;
+        memcpy(&header[2], &total, sizeof(total));
+        memcpy(&header[4], &key, sizeof(key));
+        bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+                  fwrite(first, sizeof(uint32_t), count + 1, f) == count + 1 &&
+                  fwrite(hubs, sizeof(int32_t), total, f) == total &&
+                  fwrite(dists, sizeof(float), total, f) == total;
+        ok = fclose(f) == 0 && ok;
+        if (!ok)
+        {
+            remove(tmp.c_str());
+            return false;
+        }
+        remove(path.c_str());
+        return rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // Maps a saved label set for a graph of `nodes` airports and queries it
+    // in place, setting `key` to the one it was saved with; false, leaving
+    // the labels untouched, on a missing, truncated or inconsistent file.
+    bool load(const std::string &path, uint32_t nodes, uint64_t *key = nullptr)
+    {
+        std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+        const char *p = file->data();
+        if (!p || file->size() < HeaderBytes || memcmp(p, Magic, 4) != 0)
+            return false;
+        uint32_t n;
+        uint64_t total, saved;
+        memcpy(&n, p + 4, sizeof(n));
+        memcpy(&total, p + 8, sizeof(total));
+        memcpy(&saved, p + 16, sizeof(saved));
+        if (n != nodes || total > file->size() / 8)
+            return false;
+        size_t offsets = (static_cast<size_t>(n) + 1) * 4;
+        if (file->size() < HeaderBytes + offsets + total * 8)
+            return false;
+        // Offsets start at 0, never decrease, end at the entry count and
+        // cover whole blocks, so every label read stays inside the file.
+        const uint32_t *start = reinterpret_cast<const uint32_t *>(p + HeaderBytes);
+        if (start[0] != 0 || start[n] != total)
+            return false;
+        for (uint32_t v = 0; v < n; ++v)
+            if (start[v + 1] < start[v] || (start[v + 1] - start[v]) % Block != 0)
+                return false;
+        *this = HubLabels();
+        count = n;
+        first = start;
+        hubs = reinterpret_cast<const int32_t *>(p + HeaderBytes + offsets);
+        dists = reinterpret_cast<const float *>(p + HeaderBytes + offsets + total * 4);
+        if (key)
+            *key = saved;
+        for (uint32_t v = 0; v < n; ++v)
+        {
+            size_t size = 0;
+            while (first[v] + size < first[v + 1] && hubs[first[v] + size] != Pad)
+                ++size;
+            entries += size;
+            largest = std::max(largest, size);
+        }
+        mapped = std::move(file);
+        return true;
+    }
+
+private:
+    static constexpr char Magic[4] = {'A', 'H', 'L', '2'};
+    static constexpr size_t HeaderBytes = 24;
+
+    uint32_t count = 0;
+    size_t entries = 0;
+    size_t largest = 0;
+    const uint32_t *first = nullptr;
+    const int32_t *hubs = nullptr;
+    const float *dists = nullptr;
+    std::vector<uint32_t> firstStore;
+    std::vector<int32_t> hubStore;
+    std::vector<float> distStore;
+    std::shared_ptr<const MappedFile> mapped;
+
+    static uint32_t padded(size_t size) { return static_cast<uint32_t>((size + Block - 1) / Block * Block); }
+};
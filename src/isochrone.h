@@ -0,0 +1,99 @@
+#pragma once
+
+// Isochrones: every airport reachable from one source within a bound on some
+// metric ("within 4 hours", "under $300"), with its value and predecessor.
+//
+// The search is Dijkstra that never queues anything past the bound, so it
+// costs only what it reaches. Its arrays are sized for the whole network
+// once and reset through the list of airports touched, and each thread
+// keeps its own search (BoundedSearch::local()), so repeated isochrones do
+// no allocation beyond their results.
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <functional>
+
+struct Isochrone
+{
+    int source = -1;
+    double bound = 0;
+    std::vector<int> airports; // reachable, in order of value
+    std::vector<double> value;
+    std::vector<int> parent;   // predecessor airport, -1 at the source
+};
+
+class BoundedSearch
+{
+public:
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    // This thread's search.
+    static BoundedSearch &local()
+    {
+        static thread_local BoundedSearch search;
+        return search;
+    }
+
+    // `arcs(u, relax)` calls relax(v, w) for every open arc u->v, w >= 0.
+    template <typename Arcs>
+    Isochrone run(int n, int source, double bound, Arcs arcs)
+    {
+        if (static_cast<int>(dist.size()) < n)
+        {
+            dist.resize(n, Inf);
+            parent.resize(n, -1);
+            done.resize(n, 0);
+        }
+        Isochrone result;
+        result.source = source;
+        result.bound = bound;
+        heap.clear();
+        auto push = [&](double d, int v)
+        {
+            heap.push_back({d, v});
+            std::push_heap(heap.begin(), heap.end(), std::greater<>());
+        };
+        dist[source] = 0;
+        parent[source] = -1;
+        touched.push_back(source);
+        push(0, source);
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+            auto [d, u] = heap.back();
+            heap.pop_back();
+            if (done[u] || d > dist[u])
+                continue;
+            done[u] = 1;
+            result.airports.push_back(u);
+            result.value.push_back(d);
+            result.parent.push_back(parent[u]);
+            arcs(u, [&](int v, double w)
+                 {
+                     double alt = d + w;
+                     if (alt > bound || alt >= dist[v])
+                         return;
+                     if (dist[v] == Inf)
+                         touched.push_back(v);
+                     dist[v] = alt;
+                     parent[v] = u;
+                     push(alt, v); });
+        }
+        for (int v : touched)
+        {
+            dist[v] = Inf;
+            parent[v] = -1;
+            done[v] = 0;
+        }
+        touched.clear();
+        return result;
+    }
+
+private:
+    std::vector<double> dist;
+    std::vector<int> parent;
+    std::vector<char> done;
+    std::vector<int> touched;
+    std::vector<std::pair<double, int>> heap;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+// Visiting order for a multi-city trip: start at stop 0, visit every other
+// stop once in any order, return to stop 0, minimizing the summed leg costs.
+//
+// Up to `exactLimit` visits the order is exact, by Held-Karp dynamic
+// programming over subsets: best[S][j] is the cheapest way to leave stop 0,
+// visit exactly the set S and end at j in S. Subsets of one size depend only
+// on the size below, so each size is one parallel sweep. The table is kept
+// in float (2^20 subsets x 20 ends = 80 MB at the limit) and the order is
+// read back by finding, step by step, the predecessor that reproduces each
+// entry. Larger trips get nearest-neighbour plus 2-opt, which is fast but
+// not guaranteed optimal.
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <bitset>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+struct TourPlan
+{
+    std::vector<int> order; // stop indices, starting and ending with 0
+    double cost = std::numeric_limits<double>::infinity();
+    bool exact = false;
+};
+
+// Index of the lowest set bit of r != 0.
+inline int lowestBit(uint32_t r)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, r);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(r);
+#endif
+}
+
+// `leg[i][j]` = cost from stop i to stop j (infinite when unreachable).
+inline TourPlan planTour(const std::vector<std::vector<double>> &leg, int threads = 1, int exactLimit = 20)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    int stops = static_cast<int>(leg.size());
+    TourPlan plan;
+    auto total = [&](const std::vector<int> &order)
+    {
+        double sum = 0;
+        for (size_t i = 1; i < order.size(); ++i)
+            sum += leg[order[i - 1]][order[i]];
+        return sum;
+    };
+    if (stops <= 1)
+    {
+        plan.order = {0, 0};
+        plan.cost = 0;
+        plan.exact = true;
+        return plan;
+    }
+
+    int k = stops - 1; // visits, numbered 0..k-1 here and 1..k in `leg`
+    if (k <= exactLimit)
+    {
+        const float finf = std::numeric_limits<float>::infinity();
+        size_t subsets = size_t(1) << k;
+        std::vector<float> best(subsets * k, finf);
+        for (int j = 0; j < k; ++j)
+            best[(size_t(1) << j) * k + j] = static_cast<float>(leg[0][j + 1]);
+
+        // cost[p * k + j]: visit p to visit j.
+        std::vector<float> cost(size_t(k) * k);
+        for (int p = 0; p < k; ++p)
+            for (int j = 0; j < k; ++j)
+                cost[size_t(p) * k + j] = static_cast<float>(leg[p + 1][j + 1]);
+
+        std::vector<std::vector<uint32_t>> bySize(k + 1);
+        for (uint32_t s = 1; s < subsets; ++s)
+            bySize[std::bitset<32>(s).count()].push_back(s);
+        threads = std::max(1, threads);
+        for (int size = 2; size <= k; ++size)
+        {
+            const std::vector<uint32_t> &layer = bySize[size];
+            auto sweep = [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    uint32_t s = layer[i];
+                    for (int j = 0; j < k; ++j)
+                    {
+                        if (!(s >> j & 1))
+                            continue;
+                        uint32_t rest = s & ~(1u << j);
+                        float b = finf;
+                        const float *from = &best[size_t(rest) * k];
+                        for (uint32_t r = rest; r; r &= r - 1)
+                        {
+                            int p = lowestBit(r);
+                            b = std::min(b, from[p] + cost[size_t(p) * k + j]);
+                        }
+                        best[size_t(s) * k + j] = b;
+                    }
+                }
+            };
+            int used = static_cast<int>(std::min<size_t>(threads, layer.size() / 256 + 1));
+            std::vector<std::thread> pool;
+            for (int t = 1; t < used; ++t)
+                pool.emplace_back(sweep, layer.size() * t / used, layer.size() * (t + 1) / used);
+            sweep(0, layer.size() / used);
+            for (auto &t : pool)
+                t.join();
+        }
+
+        uint32_t all = static_cast<uint32_t>(subsets - 1);
+        int last = -1;
+        float closing = finf;
+        for (int j = 0; j < k; ++j)
+        {
+            float c = best[size_t(all) * k + j] + static_cast<float>(leg[j + 1][0]);
+            if (c < closing)
+                closing = c, last = j;
+        }
+        if (last < 0)
+            return plan;
+        std::vector<int> reversed = {0};
+        for (uint32_t s = all; last >= 0;)
+        {
+            reversed.push_back(last + 1);
+            uint32_t rest = s & ~(1u << last);
+            int prev = -1;
+            for (int p = 0; p < k && rest; ++p)
+                if ((rest >> p & 1) && best[size_t(rest) * k + p] + cost[size_t(p) * k + last] == best[size_t(s) * k + last])
+                    prev = p;
+            s = rest;
+            last = prev;
+        }
+        reversed.push_back(0);
+        plan.order.assign(reversed.rbegin(), reversed.rend());
+        plan.cost = total(plan.order);
+        plan.exact = true;
+        return plan;
+    }
+
+    // Nearest neighbour from stop 0, then 2-opt until no reversal helps.
+    std::vector<int> order = {0};
+    std::vector<char> used(stops, 0);
+    used[0] = 1;
+    for (int step = 1; step < stops; ++step)
+    {
+        int at = order.back(), next = -1;
+        for (int j = 1; j < stops; ++j)
+            if (!used[j] && (next < 0 || leg[at][j] < leg[at][next]))
+                next = j;
+        used[next] = 1;
+        order.push_back(next);
+    }
+    order.push_back(0);
+    for (bool improved = true; improved;)
+    {
+        improved = false;
+        for (int i = 1; i + 1 < static_cast<int>(order.size()) - 1; ++i)
+        {
+            for (int j = i + 1; j < static_cast<int>(order.size()) - 1; ++j)
+            {
+                double before = leg[order[i - 1]][order[i]] + leg[order[j]][order[j + 1]];
+                double after = leg[order[i - 1]][order[j]] + leg[order[i]][order[j + 1]];
+                if (after < before - 1e-9)
+                {
+                    std::reverse(order.begin() + i, order.begin() + j + 1);
+                    improved = true;
+                }
+            }
+        }
+    }
+    plan.order = order;
+    plan.cost = total(order);
+    if (plan.cost == inf)
+        plan.order.clear();
+    return plan;
+}
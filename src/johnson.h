@@ -0,0 +1,203 @@
+#pragma once
+
+// Johnson reweighting: vertex potentials h that make every arc's reduced
+// weight w(u,v) + h(u) - h(v) non-negative, so graphs with signed arc weights
+// (fare credits, repositioning rebates) can be searched with Dijkstra. A
+// path's reduced length differs from its real one by h(s) - h(t) only, so
+// shortest paths are the same and distances convert back exactly.
+//
+// Potentials come from one SPFA pass (Bellman-Ford with a work queue) from a
+// virtual source joined to every airport at weight 0, which also detects
+// negative cycles. After that, raising an arc weight needs no repair, and
+// lowering one below what the potentials allow is fixed by a Dijkstra over
+// reduced weights from the arc's head that only visits airports whose
+// potential has to drop.
+
+#include <vector>
+#include <queue>
+#include <deque>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+class JohnsonReweighting
+{
+public:
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    JohnsonReweighting() = default;
+
+    // `edges[e]` = (u, v) of edge e; arc 2e runs u->v and arc 2e+1 v->u,
+    // `arcWeight[a]` is its signed weight (Inf when closed). False, leaving
+    // the reweighting empty, when the arcs contain a negative cycle.
+    bool reset(int n, const std::vector<std::pair<int, int>> &edges, const std::vector<double> &arcWeight)
+    {
+        tail.resize(edges.size() * 2);
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            tail[2 * e] = edges[e].first;
+            tail[2 * e + 1] = edges[e].second;
+        }
+        first.assign(n + 1, 0);
+        for (int u : tail)
+            ++first[u + 1];
+        for (int v = 0; v < n; ++v)
+            first[v + 1] += first[v];
+        out.resize(tail.size());
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (uint32_t a = 0; a < tail.size(); ++a)
+            out[fill[tail[a]]++] = a;
+        weights = arcWeight;
+
+        // SPFA from the virtual source: every airport starts at 0 and in the
+        // queue. A potential whose path from the source reaches n arcs is on
+        // a negative cycle.
+        h.assign(n, 0.0);
+        std::vector<int> hops(n, 0);
+        std::vector<char> queued(n, 1);
+        std::deque<int> work;
+        for (int v = 0; v < n; ++v)
+            work.push_back(v);
+        relaxCount = 0;
+        while (!work.empty())
+        {
+            int u = work.front();
+            work.pop_front();
+            queued[u] = 0;
+            for (uint32_t k = first[u]; k < first[u + 1]; ++k)
+            {
+                uint32_t a = out[k];
+                int v = head(a);
+                ++relaxCount;
+                if (weights[a] == Inf || h[u] + weights[a] >= h[v])
+                    continue;
+                h[v] = h[u] + weights[a];
+                hops[v] = hops[u] + 1;
+                if (hops[v] >= n)
+                {
+                    clear();
+                    return false;
+                }
+                if (!queued[v])
+                {
+                    queued[v] = 1;
+                    work.push_back(v);
+                }
+            }
+        }
+        reducedWeights.resize(weights.size());
+        for (uint32_t a = 0; a < weights.size(); ++a)
+            refresh(a);
+        return true;
+    }
+
+    bool empty() const { return h.empty(); }
+    double potential(int v) const { return h[v]; }
+    double weight(uint32_t arc) const { return weights[arc]; }
+    // Non-negative, Inf when closed.
+    double reduced(uint32_t arc) const { return reducedWeights[arc]; }
+    const std::vector<double> &reduced() const { return reducedWeights; }
+
+    // Real s-t distance from the reduced one.
+    double restore(int s, int t, double reducedDistance) const
+    {
+        return reducedDistance == Inf ? Inf : reducedDistance - h[s] + h[t];
+    }
+
+    // Sets one arc's weight and repairs the potentials. False, with nothing
+    // changed, when the new weight would close a negative cycle.
+    bool update(uint32_t arc, double weight)
+    {
+        int u = tail[arc], v = head(arc);
+        double r = weight + h[u] - h[v];
+        lastRepair = 0;
+        if (weight == Inf || r >= 0)
+        {
+            weights[arc] = weight;
+            refresh(arc);
+            return true;
+        }
+
+        // d(x) = r + reduced distance v~>x, expanded only while negative: those
+        // are the airports whose potential must drop by -d(x). Reaching u with
+        // d(u) < 0 means the arc closes a negative cycle.
+        dist.resize(h.size(), Inf);
+        std::vector<int> lowered;
+        using Item = std::pair<double, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+        dist[v] = r;
+        lowered.push_back(v);
+        pq.push({r, v});
+        bool cycle = false;
+        while (!pq.empty() && !cycle)
+        {
+            auto [d, x] = pq.top();
+            pq.pop();
+            if (d > dist[x])
+                continue;
+            if (x == u)
+            {
+                cycle = true;
+                break;
+            }
+            for (uint32_t k = first[x]; k < first[x + 1]; ++k)
+            {
+                uint32_t a = out[k];
+                int y = head(a);
+                double alt = d + reducedWeights[a];
+                if (alt < 0 && alt < dist[y])
+                {
+                    if (dist[y] == Inf)
+                        lowered.push_back(y);
+                    dist[y] = alt;
+                    pq.push({alt, y});
+                }
+            }
+        }
+        if (!cycle)
+        {
+            weights[arc] = weight;
+            for (int x : lowered)
+                h[x] += dist[x];
+            for (int x : lowered)
+            {
+                for (uint32_t k = first[x]; k < first[x + 1]; ++k)
+                {
+                    refresh(out[k]);
+                    refresh(out[k] ^ 1);
+                }
+            }
+            refresh(arc);
+            lastRepair = lowered.size();
+        }
+        for (int x : lowered)
+            dist[x] = Inf;
+        return !cycle;
+    }
+
+    // Arcs looked at by the last reset(), airports re-potentialed by the last update().
+    size_t relaxations() const { return relaxCount; }
+    size_t lastRepairSize() const { return lastRepair; }
+
+private:
+    std::vector<int> tail;
+    std::vector<uint32_t> first, out;
+    std::vector<double> weights, reducedWeights, h, dist;
+    size_t relaxCount = 0, lastRepair = 0;
+
+    int head(uint32_t arc) const { return tail[arc ^ 1]; }
+
+    // Clamped at 0: potentials that are exact in real arithmetic can leave a
+    // reduced weight a rounding error below it.
+    void refresh(uint32_t arc)
+    {
+        reducedWeights[arc] = weights[arc] == Inf ? Inf : std::max(0.0, weights[arc] + h[tail[arc]] - h[head(arc)]);
+    }
+
+    void clear()
+    {
+        h.clear();
+        weights.clear();
+        reducedWeights.clear();
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+// Read-only memory mapping of a whole file, for the binary logs and indexes
+// that are read in place instead of being parsed into heap structures.
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file; empty when the file cannot be mapped.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return;
+        bytes = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        length = bytes ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                bytes = static_cast<const char *>(p);
+                length = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (bytes)
+            munmap(const_cast<char *>(bytes), length);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
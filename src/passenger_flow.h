@@ -0,0 +1,330 @@
+#pragma once
+
+// Passenger flow assignment: spread origin-destination demand over the seats
+// left on each flight so that as many passengers as possible travel on cheap
+// routes. It is a heuristic, not a least-cost assignment: see routeCommodity.
+//
+// Exact multi-commodity min-cost flow is a linear program; this uses the
+// usual incremental assignment instead. Passengers from one origin form one
+// commodity (a single source with many sinks), which is an ordinary
+// min-cost flow. Each round routes a share of every origin's remaining
+// demand on the seats left by earlier rounds, so no origin claims a scarce
+// flight outright just by going first. Within a commodity the flow comes
+// from successive shortest paths with Johnson-style potentials: after one
+// Dijkstra over reduced costs, every tree path to a sink with demand left is
+// a shortest path, so one search can feed many destinations.
+
+#include <vector>
+#include <queue>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+struct PassengerDemand
+{
+    int origin, destination;
+    int passengers;
+};
+
+struct FlowAssignment
+{
+    struct Group
+    {
+        int origin, destination;
+        int passengers;
+        std::vector<int> path; // airports
+        double cost = 0;       // per passenger
+    };
+    std::vector<Group> groups;  // passengers sharing one path
+    std::vector<int> arcLoad;   // seats taken per arc
+    long long served = 0, stranded = 0;
+    double cost = 0;            // summed over served passengers
+    size_t searches = 0;
+};
+
+class PassengerFlow
+{
+public:
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    PassengerFlow() = default;
+
+    // `edges[e]` = (u, v); arc 2e runs u->v and arc 2e+1 v->u.
+    PassengerFlow(int n, const std::vector<std::pair<int, int>> &edges) : first(n + 1, 0), out(edges.size() * 2), heads(edges.size() * 2)
+    {
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            heads[2 * e] = edges[e].second;
+            heads[2 * e + 1] = edges[e].first;
+            ++first[edges[e].first + 1];
+            ++first[edges[e].second + 1];
+        }
+        for (int v = 0; v < n; ++v)
+            first[v + 1] += first[v];
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (uint32_t a = 0; a < heads.size(); ++a)
+            out[fill[heads[a ^ 1]]++] = a;
+    }
+
+    // `arcCost[a]` >= 0 per passenger (Inf when closed), `arcSeats[a]` seats
+    // available. Demand that no remaining seats can carry is stranded.
+    FlowAssignment assign(const std::vector<PassengerDemand> &demands, const std::vector<double> &arcCost, const std::vector<int> &arcSeats,
+                          int rounds = 4) const
+    {
+        int n = static_cast<int>(first.size()) - 1;
+        FlowAssignment result;
+        result.arcLoad.assign(heads.size(), 0);
+        std::map<int, std::map<int, int>> remaining; // origin -> destination -> passengers
+        for (const PassengerDemand &d : demands)
+        {
+            if (d.passengers <= 0)
+                continue;
+            if (d.origin == d.destination)
+                result.served += d.passengers;
+            else
+                remaining[d.origin][d.destination] += d.passengers;
+        }
+
+        Workspace w(n, heads.size());
+        std::map<std::tuple<int, int, std::vector<int>>, int> grouped;
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (auto &[origin, sinks] : remaining)
+            {
+                // This round's share, the rest in the last round.
+                std::map<int, int> quota;
+                for (const auto &[destination, passengers] : sinks)
+                {
+                    int share = round + 1 == rounds ? passengers : (passengers + rounds - round - 1) / (rounds - round);
+                    if (share > 0)
+                        quota[destination] = share;
+                }
+                if (quota.empty())
+                    continue;
+                routeCommodity(origin, quota, arcCost, arcSeats, result, w);
+                for (const auto &[path, passengers] : w.paths)
+                {
+                    sinks[path.back()] -= passengers;
+                    grouped[{origin, path.back(), path}] += passengers;
+                }
+            }
+        }
+        for (const auto &[origin, sinks] : remaining)
+            for (const auto &[destination, passengers] : sinks)
+                result.stranded += passengers;
+        for (const auto &[key, passengers] : grouped)
+        {
+            FlowAssignment::Group g{std::get<0>(key), std::get<1>(key), passengers, std::get<2>(key), 0};
+            for (size_t i = 1; i < g.path.size(); ++i)
+                g.cost += arcCost[arcBetween(g.path[i - 1], g.path[i], arcCost)];
+            result.served += passengers;
+            result.cost += g.cost * passengers;
+            result.groups.push_back(std::move(g));
+        }
+        return result;
+    }
+
+private:
+    std::vector<uint32_t> first, out; // arcs leaving each airport
+    std::vector<int> heads;
+
+    struct Workspace
+    {
+        std::vector<double> dist, potential;
+        std::vector<int> via;                // arc into v, or -2 - arc when cancelling flow on it
+        std::vector<int> flow;               // this commodity's passengers per arc
+        std::vector<char> marked;
+        std::vector<uint32_t> touchedArcs;
+        std::vector<std::pair<std::vector<int>, int>> paths; // delivered this call
+        Workspace(int n, size_t arcs) : dist(n), potential(n), via(n), flow(arcs, 0), marked(arcs, 0) {}
+    };
+
+    int tail(uint32_t arc) const { return heads[arc ^ 1]; }
+
+    // Cheapest open arc u->v (there is one edge per airport pair in practice).
+    uint32_t arcBetween(int u, int v, const std::vector<double> &arcCost) const
+    {
+        uint32_t best = 0;
+        double c = Inf;
+        for (uint32_t k = first[u]; k < first[u + 1]; ++k)
+            if (heads[out[k]] == v && arcCost[out[k]] <= c)
+                best = out[k], c = arcCost[out[k]];
+        return best;
+    }
+
+    // Flow from `origin` to the sinks in `quota`, within the seats not yet
+    // taken in `result.arcLoad`; fills w.paths with what was delivered and
+    // adds it to the load. Each search feeds every sink along its tree path,
+    // in sink order, so when seats run short an earlier sink can take a seat
+    // a later one needed more: the result is exact only while seats suffice.
+    void routeCommodity(int origin, std::map<int, int> quota, const std::vector<double> &arcCost, const std::vector<int> &arcSeats,
+                        FlowAssignment &result, Workspace &w) const
+    {
+        int n = static_cast<int>(first.size()) - 1;
+        std::fill(w.potential.begin(), w.potential.end(), 0.0);
+        w.paths.clear();
+        auto residual = [&](uint32_t a)
+        { return arcSeats[a] - result.arcLoad[a] - w.flow[a]; };
+        using Item = std::pair<double, int>;
+        while (!quota.empty())
+        {
+            // Dijkstra over reduced costs on the residual graph: open arcs
+            // with seats left, and this commodity's own flow backwards.
+            std::fill(w.dist.begin(), w.dist.end(), Inf);
+            std::fill(w.via.begin(), w.via.end(), -1);
+            std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+            w.dist[origin] = 0;
+            pq.push({0, origin});
+            size_t sinksLeft = quota.size();
+            double last = 0;
+            ++result.searches;
+            while (!pq.empty() && sinksLeft > 0)
+            {
+                auto [d, u] = pq.top();
+                pq.pop();
+                if (d > w.dist[u])
+                    continue;
+                last = d;
+                sinksLeft -= quota.count(u);
+                for (uint32_t k = first[u]; k < first[u + 1]; ++k)
+                {
+                    uint32_t a = out[k];
+                    int v = heads[a];
+                    if (arcCost[a] != Inf && residual(a) > 0)
+                    {
+                        double alt = d + std::max(0.0, arcCost[a] + w.potential[u] - w.potential[v]);
+                        if (alt < w.dist[v])
+                        {
+                            w.dist[v] = alt;
+                            w.via[v] = static_cast<int>(a);
+                            pq.push({alt, v});
+                        }
+                    }
+                    // Flow this commodity sent v->u can be taken back.
+                    uint32_t back = a ^ 1;
+                    if (w.flow[back] > 0)
+                    {
+                        double alt = d + std::max(0.0, -arcCost[back] + w.potential[u] - w.potential[v]);
+                        if (alt < w.dist[v])
+                        {
+                            w.dist[v] = alt;
+                            w.via[v] = -2 - static_cast<int>(back);
+                            pq.push({alt, v});
+                        }
+                    }
+                }
+            }
+            // Unsettled airports get the last settled distance, which keeps
+            // reduced costs non-negative (see DisjointPaths).
+            for (int v = 0; v < n; ++v)
+                w.potential[v] += std::min(w.dist[v], last);
+
+            // Feed every reachable sink along its tree path while seats last.
+            bool progressed = false;
+            for (auto it = quota.begin(); it != quota.end();)
+            {
+                int sink = it->first;
+                if (w.dist[sink] == Inf)
+                {
+                    it = quota.erase(it);
+                    continue;
+                }
+                int amount = it->second;
+                for (int v = sink; v != origin;)
+                {
+                    int how = w.via[v];
+                    if (how >= 0)
+                    {
+                        amount = std::min(amount, residual(how));
+                        v = tail(how);
+                    }
+                    else
+                    {
+                        amount = std::min(amount, w.flow[-2 - how]);
+                        v = heads[-2 - how];
+                    }
+                }
+                if (amount > 0)
+                {
+                    progressed = true;
+                    for (int v = sink; v != origin;)
+                    {
+                        int how = w.via[v];
+                        if (how >= 0)
+                        {
+                            if (!w.marked[how])
+                                w.marked[how] = 1, w.touchedArcs.push_back(how);
+                            w.flow[how] += amount;
+                            v = tail(how);
+                        }
+                        else
+                        {
+                            w.flow[-2 - how] -= amount;
+                            v = heads[-2 - how];
+                        }
+                    }
+                    it->second -= amount;
+                }
+                it = it->second == 0 ? quota.erase(it) : std::next(it);
+            }
+            if (!progressed)
+                break;
+        }
+        decompose(origin, result, w);
+    }
+
+    // Splits this commodity's arc flow into origin-to-sink paths, adds it to
+    // the shared load and clears it. Costs are positive, so the flow has no
+    // cycles and walking back from a sink along arcs that still carry flow
+    // always ends at the origin.
+    void decompose(int origin, FlowAssignment &result, Workspace &w) const
+    {
+        std::map<int, int> delivered;
+        for (uint32_t a : w.touchedArcs)
+        {
+            w.marked[a] = 0;
+            if (w.flow[a] <= 0)
+                continue;
+            result.arcLoad[a] += w.flow[a];
+            delivered[heads[a]] += w.flow[a];
+            delivered[tail(a)] -= w.flow[a];
+        }
+        delivered.erase(origin);
+        std::vector<uint32_t> arcs;
+        for (auto &[sink, excess] : delivered)
+        {
+            while (excess > 0)
+            {
+                arcs.clear();
+                int at = sink, amount = excess;
+                for (size_t steps = 0; at != origin && steps < heads.size(); ++steps)
+                {
+                    uint32_t in = UINT32_MAX;
+                    for (uint32_t k = first[at]; k < first[at + 1] && in == UINT32_MAX; ++k)
+                        if (w.flow[out[k] ^ 1] > 0)
+                            in = out[k] ^ 1;
+                    if (in == UINT32_MAX)
+                        break;
+                    arcs.push_back(in);
+                    amount = std::min(amount, w.flow[in]);
+                    at = tail(in);
+                }
+                if (at != origin)
+                    break;
+                std::vector<int> path = {origin};
+                for (auto a = arcs.rbegin(); a != arcs.rend(); ++a)
+                {
+                    w.flow[*a] -= amount;
+                    path.push_back(heads[*a]);
+                }
+                excess -= amount;
+                w.paths.push_back({std::move(path), amount});
+            }
+        }
+        for (uint32_t a : w.touchedArcs)
+            w.flow[a] = 0;
+        w.touchedArcs.clear();
+    }
+};
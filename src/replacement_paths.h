@@ -0,0 +1,287 @@
+#pragma once
+
+// Replacement paths: for the shortest s-t path P, the best s-t route that
+// avoids each single edge of P, all found in one batched pass.
+//
+// One Dijkstra from s and one from t give two shortest-path trees that both
+// contain P. Label every airport with the last P airport on its tree path
+// from s (a) and the first P airport on its tree path to t (b). A non-tree
+// edge u-v then closes the detour s~>u -> v~>t, which leaves P after a(u),
+// rejoins it at b(v), and so avoids every P edge in between. On an
+// undirected graph the best detour around edge i is the cheapest of these
+// whose range covers i. Every edge is looked at once and covers at most
+// |P| positions, and flight paths are a handful of hops long.
+//
+// The table answers "the usual route minus one closed segment" without a
+// search, and keeps answering while other closures stay off the route used.
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+struct ReplacementPaths
+{
+    static constexpr double Inf = std::numeric_limits<double>::infinity();
+
+    int source = -1, target = -1;
+    std::vector<int> path;                     // s..t airports, empty when unreachable
+    std::vector<int> pathEdges;                // pathEdges[i] joins path[i] and path[i + 1]
+    double length = Inf;
+    std::vector<double> detourLength;          // per path edge, Inf when s and t fall apart without it
+    std::vector<std::vector<int>> detour;      // airports of the best route avoiding it
+    std::vector<std::vector<int>> detourEdges;
+
+    // Route with the edges `open` rejects removed: the shortest path when it
+    // is untouched, the detour around its one closed edge when that detour is
+    // still open. False when the closures go beyond what the table covers.
+    template <typename IsOpen>
+    bool route(IsOpen open, std::vector<int> &out) const
+    {
+        int closed = -1;
+        for (size_t i = 0; i < pathEdges.size(); ++i)
+        {
+            if (open(pathEdges[i]))
+                continue;
+            if (closed >= 0)
+                return false;
+            closed = static_cast<int>(i);
+        }
+        if (closed < 0)
+        {
+            out = path;
+            return true;
+        }
+        for (int e : detourEdges[closed])
+            if (!open(e))
+                return false;
+        out = detour[closed];
+        return true;
+    }
+};
+
+// `edges[e]` = (u, v) of undirected edge e, `weight[e]` its cost (Inf when
+// closed).
+inline ReplacementPaths computeReplacementPaths(int n, const std::vector<std::pair<int, int>> &edges, const std::vector<double> &weight, int s, int t)
+{
+    const double Inf = ReplacementPaths::Inf;
+    ReplacementPaths result;
+    result.source = s;
+    result.target = t;
+
+    std::vector<uint32_t> first(n + 1, 0);
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        if (weight[e] == Inf)
+            continue;
+        ++first[edges[e].first + 1];
+        ++first[edges[e].second + 1];
+    }
+    for (int v = 0; v < n; ++v)
+        first[v + 1] += first[v];
+    std::vector<std::pair<int, int>> arcs(first[n]); // (head, edge id)
+    std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        if (weight[e] == Inf)
+            continue;
+        arcs[fill[edges[e].first]++] = {edges[e].second, static_cast<int>(e)};
+        arcs[fill[edges[e].second]++] = {edges[e].first, static_cast<int>(e)};
+    }
+
+    struct Tree
+    {
+        std::vector<double> dist;
+        std::vector<int> parentEdge; // edge towards the root, -1 at the root
+        std::vector<int> order;      // airports in settling order
+    };
+    auto grow = [&](int root)
+    {
+        Tree tree{std::vector<double>(n, Inf), std::vector<int>(n, -1), {}};
+        using Item = std::pair<double, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<>> pq;
+        tree.dist[root] = 0;
+        pq.push({0, root});
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > tree.dist[u])
+                continue;
+            tree.order.push_back(u);
+            for (uint32_t k = first[u]; k < first[u + 1]; ++k)
+            {
+                auto [v, e] = arcs[k];
+                if (d + weight[e] < tree.dist[v])
+                {
+                    tree.dist[v] = d + weight[e];
+                    tree.parentEdge[v] = e;
+                    pq.push({tree.dist[v], v});
+                }
+            }
+        }
+        return tree;
+    };
+    auto other = [&](int e, int u)
+    { return edges[e].first == u ? edges[e].second : edges[e].first; };
+
+    Tree fromS = grow(s);
+    if (fromS.dist[t] == Inf)
+        return result;
+    for (int at = t; at != s; at = other(fromS.parentEdge[at], at))
+    {
+        result.path.push_back(at);
+        result.pathEdges.push_back(fromS.parentEdge[at]);
+    }
+    result.path.push_back(s);
+    std::reverse(result.path.begin(), result.path.end());
+    std::reverse(result.pathEdges.begin(), result.pathEdges.end());
+    result.length = fromS.dist[t];
+    int k = static_cast<int>(result.pathEdges.size());
+    std::vector<int> pos(n, -1);
+    for (int i = 0; i <= k; ++i)
+        pos[result.path[i]] = i;
+
+    // The tree from t is made to follow P as well; P is shortest, so every
+    // P edge is tight towards t.
+    Tree fromT = grow(t);
+    for (int i = 0; i < k; ++i)
+        fromT.parentEdge[result.path[i]] = result.pathEdges[i];
+
+    auto label = [&](const Tree &tree)
+    {
+        std::vector<int> at(n, -1);
+        for (int v : tree.order)
+            at[v] = pos[v] >= 0 ? pos[v] : at[other(tree.parentEdge[v], v)];
+        return at;
+    };
+    std::vector<int> a = label(fromS), b = label(fromT);
+
+    std::vector<char> onPath(edges.size(), 0);
+    for (int e : result.pathEdges)
+        onPath[e] = 1;
+    struct Best
+    {
+        double length = ReplacementPaths::Inf;
+        int u = -1, v = -1, edge = -1;
+    };
+    std::vector<Best> best(k);
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        if (weight[e] == Inf || onPath[e])
+            continue;
+        for (int side = 0; side < 2; ++side)
+        {
+            int u = side ? edges[e].second : edges[e].first;
+            int v = side ? edges[e].first : edges[e].second;
+            if (a[u] < 0 || b[v] < 0 || a[u] >= b[v])
+                continue;
+            double length = fromS.dist[u] + weight[e] + fromT.dist[v];
+            for (int i = a[u]; i < b[v]; ++i)
+                if (length < best[i].length)
+                    best[i] = {length, u, v, static_cast<int>(e)};
+        }
+    }
+
+    result.detourLength.assign(k, Inf);
+    result.detour.assign(k, {});
+    result.detourEdges.assign(k, {});
+    for (int i = 0; i < k; ++i)
+    {
+        if (best[i].edge < 0)
+            continue;
+        std::vector<int> &nodes = result.detour[i];
+        std::vector<int> &ids = result.detourEdges[i];
+        for (int at = best[i].u; at != s; at = other(fromS.parentEdge[at], at))
+        {
+            nodes.push_back(at);
+            ids.push_back(fromS.parentEdge[at]);
+        }
+        nodes.push_back(s);
+        std::reverse(nodes.begin(), nodes.end());
+        std::reverse(ids.begin(), ids.end());
+        ids.push_back(best[i].edge);
+        for (int at = best[i].v; at != t; at = other(fromT.parentEdge[at], at))
+        {
+            nodes.push_back(at);
+            ids.push_back(fromT.parentEdge[at]);
+        }
+        nodes.push_back(t);
+        result.detourLength[i] = best[i].length;
+    }
+    return result;
+}
+
+// Replacement tables for the origin-destination pairs asked for most. A pair
+// is tabled once it has been requested `admitAfter` times; when full, it
+// takes the place of the least requested table only if asked for more often.
+class ReplacementCache
+{
+public:
+    explicit ReplacementCache(size_t capacity = 256, uint32_t admitAfter = 2)
+        : capacity(capacity), admitAfter(admitAfter) {}
+
+    static uint64_t key(int src, int dst, int metric)
+    {
+        return (static_cast<uint64_t>(metric) << 48) | (static_cast<uint64_t>(src) << 24) | static_cast<uint64_t>(dst);
+    }
+
+    // Table for `key`, built with `build()` once the pair is popular enough;
+    // nullptr until then. The pointer stays valid until the next lookup.
+    template <typename Build>
+    const ReplacementPaths *lookup(uint64_t key, Build build)
+    {
+        uint32_t seen = ++requests[key];
+        // Request counts age so yesterday's popular pairs can be displaced.
+        if (requests.size() > 64 * capacity)
+        {
+            for (auto r = requests.begin(); r != requests.end();)
+                r = (r->second /= 2) == 0 ? requests.erase(r) : std::next(r);
+        }
+        auto it = tables.find(key);
+        if (it != tables.end())
+        {
+            ++hitCount;
+            it->second.requests = seen;
+            return &it->second.paths;
+        }
+        ++missCount;
+        if (seen < admitAfter || capacity == 0)
+            return nullptr;
+        if (tables.size() >= capacity)
+        {
+            auto victim = tables.begin();
+            for (auto t = tables.begin(); t != tables.end(); ++t)
+                if (t->second.requests < victim->second.requests)
+                    victim = t;
+            if (victim->second.requests >= seen)
+                return nullptr;
+            tables.erase(victim);
+        }
+        ++buildCount;
+        Table &t = tables[key];
+        t.paths = build();
+        t.requests = seen;
+        return &t.paths;
+    }
+
+    size_t size() const { return tables.size(); }
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+    size_t builds() const { return buildCount; }
+
+private:
+    struct Table
+    {
+        ReplacementPaths paths;
+        uint32_t requests = 0;
+    };
+
+    size_t capacity;
+    uint32_t admitAfter;
+    std::unordered_map<uint64_t, Table> tables;
+    std::unordered_map<uint64_t, uint32_t> requests;
+    size_t hitCount = 0, missCount = 0, buildCount = 0;
+};
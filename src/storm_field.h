@@ -0,0 +1,229 @@
+#pragma once
+
+// Procedural weather: storm cells drifting along great circles over the
+// network's lat/lon domain. Every cell slot lives for `lifetimeHours`, grows
+// and decays over that span, and is then reborn elsewhere. Each incarnation is
+// derived from (seed, slot, generation) alone, so the field can be evaluated
+// at any time in any order and the same seed always gives the same storms.
+//
+// at(t) resolves the field to a StormSnapshot: cell centres as unit vectors
+// and squared-chord radii, after which "is this airport / segment bad" is a
+// handful of dot products per cell with no trigonometry.
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include "geodesic.h"
+
+struct StormFieldConfig
+{
+    unsigned seed = 1;
+    int cells = 24;
+    double speedKmh = 60.0;
+    double lifetimeHours = 12.0;
+    double maxRadiusKm = 250.0;
+    // Default domain: the contiguous US, where the network lives.
+    double latMin = 24.0;
+    double latMax = 50.0;
+    double lonMin = -125.0;
+    double lonMax = -66.0;
+    // Epoch second the field starts at; cells are already mid-life there.
+    long long start = 0;
+};
+
+// "seed=7,cells=40,speed=80,lifetime=6,radius=300" from AEROROUTE_STORMS.
+inline StormFieldConfig stormConfigFromEnv()
+{
+    StormFieldConfig c;
+    const char *env = getenv("AEROROUTE_STORMS");
+    if (!env)
+        return c;
+    std::istringstream in(env);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            continue;
+        std::string key = item.substr(0, eq);
+        double value = atof(item.c_str() + eq + 1);
+        if (key == "seed")
+            c.seed = static_cast<unsigned>(value);
+        else if (key == "cells")
+            c.cells = static_cast<int>(value);
+        else if (key == "speed")
+            c.speedKmh = value;
+        else if (key == "lifetime")
+            c.lifetimeHours = value;
+        else if (key == "radius")
+            c.maxRadiusKm = value;
+        else if (key == "start")
+            c.start = static_cast<long long>(value);
+    }
+    return c;
+}
+
+enum class StormKind : uint8_t
+{
+    Rain,
+    Thunderstorm,
+    Snow
+};
+
+inline const char *stormKindName(StormKind k)
+{
+    return k == StormKind::Thunderstorm ? "Thunderstorm" : k == StormKind::Snow ? "Snow" : "Rain";
+}
+
+inline const char *stormKindDescription(StormKind k)
+{
+    return k == StormKind::Thunderstorm ? "thunderstorm with heavy rain" : k == StormKind::Snow ? "heavy snow" : "heavy intensity rain";
+}
+
+// The field resolved at one instant. Cells are stored as a struct-of-arrays;
+// `limit` is the squared chord of the cell's current radius.
+struct StormSnapshot
+{
+    double time = 0;
+    std::vector<double> x, y, z, limit, sinRadius;
+    std::vector<StormKind> kind;
+
+    size_t size() const { return x.size(); }
+
+    // First cell covering p, or -1.
+    int cellAt(const UnitVector &p) const
+    {
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            double dx = x[i] - p.x, dy = y[i] - p.y, dz = z[i] - p.z;
+            if (dx * dx + dy * dy + dz * dz <= limit[i])
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    bool isBad(const UnitVector &p) const { return cellAt(p) >= 0; }
+
+    // First cell touching the great-circle arc a-b, or -1. `n` is the unit
+    // normal a x b / |a x b|, precomputed per edge by the caller.
+    int cellOnArc(const UnitVector &a, const UnitVector &b, const UnitVector &n) const
+    {
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            double dx = x[i] - a.x, dy = y[i] - a.y, dz = z[i] - a.z;
+            if (dx * dx + dy * dy + dz * dz <= limit[i])
+                return static_cast<int>(i);
+            dx = x[i] - b.x, dy = y[i] - b.y, dz = z[i] - b.z;
+            if (dx * dx + dy * dy + dz * dz <= limit[i])
+                return static_cast<int>(i);
+            // Off the endpoints: the cell must reach the great circle, and its
+            // foot point must fall between a and b.
+            double off = x[i] * n.x + y[i] * n.y + z[i] * n.z;
+            if (std::fabs(off) > sinRadius[i])
+                continue;
+            double px = x[i] - off * n.x, py = y[i] - off * n.y, pz = z[i] - off * n.z;
+            double sideA = n.x * (a.y * pz - a.z * py) + n.y * (a.z * px - a.x * pz) + n.z * (a.x * py - a.y * px);
+            double sideB = n.x * (py * b.z - pz * b.y) + n.y * (pz * b.x - px * b.z) + n.z * (px * b.y - py * b.x);
+            if (sideA >= 0 && sideB >= 0)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+};
+
+inline UnitVector arcNormal(const UnitVector &a, const UnitVector &b)
+{
+    UnitVector n = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    double len = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    if (len == 0)
+        return {0, 0, 0};
+    return {n.x / len, n.y / len, n.z / len};
+}
+
+class StormField
+{
+public:
+    explicit StormField(const StormFieldConfig &config = StormFieldConfig()) : cfg(config) {}
+
+    const StormFieldConfig &config() const { return cfg; }
+
+    void at(long long epochSeconds, StormSnapshot &out) const
+    {
+        const double pi = 3.14159265358979323846;
+        double lifetime = cfg.lifetimeHours * 3600.0;
+        double t = static_cast<double>(epochSeconds - cfg.start);
+        out.time = static_cast<double>(epochSeconds);
+        out.x.clear();
+        out.y.clear();
+        out.z.clear();
+        out.limit.clear();
+        out.sinRadius.clear();
+        out.kind.clear();
+        for (int slot = 0; slot < cfg.cells; ++slot)
+        {
+            // Stagger slots so cells are born and die at different times.
+            double phase = lifetime * unit(hash(cfg.seed, slot, 0x9e37));
+            double local = t + phase;
+            long long generation = static_cast<long long>(std::floor(local / lifetime));
+            double age = local - generation * lifetime;
+            double strength = std::sin(pi * age / lifetime);
+            double radiusKm = cfg.maxRadiusKm * (0.4 + 0.6 * unit(hash(cfg.seed, slot, generation, 1))) * strength;
+            if (radiusKm <= 0)
+                continue;
+
+            double lat = cfg.latMin + (cfg.latMax - cfg.latMin) * unit(hash(cfg.seed, slot, generation, 2));
+            double lon = cfg.lonMin + (cfg.lonMax - cfg.lonMin) * unit(hash(cfg.seed, slot, generation, 3));
+            double heading = 2 * pi * unit(hash(cfg.seed, slot, generation, 4));
+            double speed = cfg.speedKmh * (0.5 + 0.5 * unit(hash(cfg.seed, slot, generation, 5)));
+            double travelled = speed * age / 3600.0 / EarthRadiusKm;
+
+            // Walk `travelled` radians from the birth point along the heading.
+            double toRad = pi / 180.0;
+            double sl = std::sin(lat * toRad), cl = std::cos(lat * toRad);
+            double so = std::sin(lon * toRad), co = std::cos(lon * toRad);
+            UnitVector p0 = {cl * co, cl * so, sl};
+            UnitVector north = {-sl * co, -sl * so, cl};
+            UnitVector east = {-so, co, 0};
+            double ch = std::cos(heading), sh = std::sin(heading);
+            UnitVector dir = {ch * north.x + sh * east.x, ch * north.y + sh * east.y, ch * north.z + sh * east.z};
+            double ct = std::cos(travelled), st = std::sin(travelled);
+
+            out.x.push_back(ct * p0.x + st * dir.x);
+            out.y.push_back(ct * p0.y + st * dir.y);
+            out.z.push_back(ct * p0.z + st * dir.z);
+            out.limit.push_back(kmToChord2(radiusKm));
+            out.sinRadius.push_back(std::sin(radiusKm / EarthRadiusKm));
+            uint64_t k = hash(cfg.seed, slot, generation, 6) % 10;
+            out.kind.push_back(k < 5 ? StormKind::Thunderstorm : k < 8 ? StormKind::Rain : StormKind::Snow);
+        }
+    }
+
+    StormSnapshot at(long long epochSeconds) const
+    {
+        StormSnapshot s;
+        at(epochSeconds, s);
+        return s;
+    }
+
+private:
+    StormFieldConfig cfg;
+
+    static uint64_t hash(uint64_t a, uint64_t b, uint64_t c, uint64_t d = 0)
+    {
+        uint64_t h = a * 0x9E3779B97F4A7C15ull ^ (b + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+        h ^= (c + 0x85EBCA77C2B2AE63ull) * 0x94D049BB133111EBull;
+        h ^= (d + 0x27D4EB2F165667C5ull) * 0xD6E8FEB86659FD93ull;
+        h ^= h >> 31;
+        h *= 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        return h;
+    }
+
+    static double unit(uint64_t h)
+    {
+        return static_cast<double>(h >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
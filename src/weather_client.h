@@ -0,0 +1,165 @@
+#pragma once
+
+// Asynchronous OpenWeatherMap client shared by flight_booking and flight_simulator.
+// WeatherProvider is the interface both programs fetch through; WeatherClient is
+// the live HTTP backend (see weather_provider.h for record and replay). A small pool of worker threads each owns one cpr::Session, so connections to
+// the API host stay alive between requests. Requests for a URL that is already
+// in flight join the existing fetch instead of issuing a second one.
+// Set OPENWEATHERMAP_BASE_URL to point the client at a local stand-in.
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <cpr/cpr.h>
+
+struct WeatherResponse
+{
+    long status = 0;
+    std::string text;
+};
+
+enum class WeatherEndpoint : uint8_t
+{
+    Current,
+    Forecast
+};
+
+class WeatherProvider
+{
+public:
+    virtual ~WeatherProvider() = default;
+
+    virtual std::shared_future<WeatherResponse> fetch(WeatherEndpoint endpoint, double lat, double lon, const std::string &apiKey) = 0;
+
+    std::shared_future<WeatherResponse> fetchForecast(double lat, double lon, const std::string &apiKey)
+    {
+        return fetch(WeatherEndpoint::Forecast, lat, lon, apiKey);
+    }
+
+    std::shared_future<WeatherResponse> fetchCurrent(double lat, double lon, const std::string &apiKey)
+    {
+        return fetch(WeatherEndpoint::Current, lat, lon, apiKey);
+    }
+};
+
+inline std::string weatherBaseUrl()
+{
+    const char *env = getenv("OPENWEATHERMAP_BASE_URL");
+    return env && *env ? env : "http://api.openweathermap.org/data/2.5";
+}
+
+class WeatherClient : public WeatherProvider
+{
+public:
+    explicit WeatherClient(size_t workers = 8) : workerCount(workers) {}
+
+    ~WeatherClient()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (auto &t : threads)
+            t.join();
+    }
+
+    WeatherClient(const WeatherClient &) = delete;
+    WeatherClient &operator=(const WeatherClient &) = delete;
+
+    std::shared_future<WeatherResponse> fetch(WeatherEndpoint endpoint, double lat, double lon, const std::string &apiKey) override
+    {
+        return fetchUrl(endpointUrl(endpoint == WeatherEndpoint::Forecast ? "forecast" : "weather", lat, lon, apiKey));
+    }
+
+    std::shared_future<WeatherResponse> fetchUrl(const std::string &url)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = inFlight.find(url);
+        if (it != inFlight.end())
+        {
+            ++coalesced;
+            return it->second;
+        }
+        if (threads.empty())
+        {
+            for (size_t i = 0; i < workerCount; ++i)
+                threads.emplace_back([this]()
+                                     { work(); });
+        }
+        auto promise = std::make_shared<std::promise<WeatherResponse>>();
+        std::shared_future<WeatherResponse> future = promise->get_future().share();
+        inFlight[url] = future;
+        queue.push_back({url, promise});
+        ++issued;
+        ready.notify_one();
+        return future;
+    }
+
+    size_t requestsIssued() const { return issued; }
+    size_t requestsCoalesced() const { return coalesced; }
+
+private:
+    struct Job
+    {
+        std::string url;
+        std::shared_ptr<std::promise<WeatherResponse>> promise;
+    };
+
+    size_t workerCount;
+    std::vector<std::thread> threads;
+    std::deque<Job> queue;
+    std::unordered_map<std::string, std::shared_future<WeatherResponse>> inFlight;
+    std::mutex mtx;
+    std::condition_variable ready;
+    bool stopping = false;
+    std::atomic<size_t> issued{0};
+    std::atomic<size_t> coalesced{0};
+
+    static std::string endpointUrl(const char *endpoint, double lat, double lon, const std::string &apiKey)
+    {
+        std::ostringstream url;
+        url << weatherBaseUrl() << "/" << endpoint << "?lat=" << lat
+            << "&lon=" << lon
+            << "&appid=" << apiKey
+            << "&units=metric";
+        return url.str();
+    }
+
+    void work()
+    {
+        cpr::Session session;
+        session.SetTimeout(cpr::Timeout{10000});
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                ready.wait(lock, [this]()
+                           { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            session.SetUrl(cpr::Url{job.url});
+            cpr::Response r = session.Get();
+            WeatherResponse response{r.status_code, std::move(r.text)};
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                inFlight.erase(job.url);
+            }
+            job.promise->set_value(std::move(response));
+        }
+    }
+};
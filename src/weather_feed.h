@@ -0,0 +1,208 @@
+#pragma once
+
+// Streaming weather updates. A feed is newline-delimited JSON, one event per
+// line, about either an airport or an edge:
+//
+//   {"t":1700000000,"airport":"SEA","condition":"Thunderstorm"}
+//   {"t":1700000060,"from":"SEA","to":"PDX","condition":"Clear"}
+//
+// WeatherFeed takes arbitrary chunks of that text, parses complete lines with
+// the streaming scanner from weather_records.h, and keeps only the newest event
+// per airport or edge within a window of feed time. When the window closes,
+// the surviving events go to the owner's apply step in one batch, and the ids
+// of edges whose state actually changed are handed to every subscriber.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include "weather_records.h"
+
+struct WeatherEvent
+{
+    long long time = 0;
+    int airport = -1;
+    int edge = -1;
+    WeatherMain condition = WeatherMain::Unknown;
+};
+
+// Maps codes in the feed to the graph's airport indices and edge ids. Raw
+// "edge" ids are accepted only in [0, edgeCount).
+struct WeatherFeedResolver
+{
+    std::unordered_map<std::string_view, int> airportIndex;
+    std::function<int(int, int)> edgeId;
+    size_t edgeCount = 0;
+};
+
+// One line to one event; false for malformed or unresolvable lines,
+// including an "edge" that is not an integer id of an existing edge.
+inline bool parseWeatherEvent(const char *line, const WeatherFeedResolver &resolver, WeatherEvent &event)
+{
+    weather_detail::Scanner s{line};
+    int from = -1, to = -1;
+    bool valid = true;
+    event = WeatherEvent();
+    auto airport = [&](std::string_view code)
+    {
+        auto it = resolver.airportIndex.find(code);
+        return it == resolver.airportIndex.end() ? -1 : it->second;
+    };
+    s.object([&](std::string_view key)
+             {
+                 if (key == "t")
+                 {
+                     double t = s.number();
+                     valid = valid && std::fabs(t) < 1e15;
+                     event.time = valid ? static_cast<long long>(t) : 0;
+                 }
+                 else if (key == "airport")
+                     event.airport = airport(s.string());
+                 else if (key == "from")
+                     from = airport(s.string());
+                 else if (key == "to")
+                     to = airport(s.string());
+                 else if (key == "edge")
+                 {
+                     double id = s.number();
+                     valid = valid && id >= 0 && id < static_cast<double>(resolver.edgeCount) && id == std::floor(id);
+                     event.edge = valid ? static_cast<int>(id) : -1;
+                 }
+                 else if (key == "condition")
+                     event.condition = weatherMainCode(s.string());
+                 else
+                     s.skip(); });
+    if (!s.ok || !valid || event.condition == WeatherMain::Unknown)
+        return false;
+    if (from >= 0 && to >= 0 && resolver.edgeId)
+        event.edge = resolver.edgeId(from, to);
+    return (event.airport >= 0) != (event.edge >= 0);
+}
+
+struct WeatherFeedStats
+{
+    size_t lines = 0;
+    size_t rejected = 0;
+    size_t coalesced = 0;
+    size_t applied = 0;
+    size_t batches = 0;
+    size_t changedEdges = 0;
+};
+
+class WeatherFeed
+{
+public:
+    using ApplyFn = std::function<void(const std::vector<WeatherEvent> &, std::vector<int> &changed)>;
+    using SubscriberFn = std::function<void(const std::vector<int> &changed)>;
+
+    WeatherFeed(WeatherFeedResolver resolver, size_t airports, size_t edges, ApplyFn apply, long long windowSeconds = 60)
+        : resolver(std::move(resolver)), apply(std::move(apply)), window(windowSeconds),
+          airportSlot(airports, -1), edgeSlot(edges, -1)
+    {
+        this->resolver.edgeCount = edges;
+    }
+
+    void subscribe(SubscriberFn fn) { subscribers.push_back(std::move(fn)); }
+
+    // Feeds a chunk of NDJSON; a trailing partial line waits for the next chunk.
+    void ingest(const char *data, size_t length)
+    {
+        size_t begin = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (data[i] != '\n')
+                continue;
+            if (!carry.empty())
+            {
+                carry.append(data + begin, i - begin);
+                line(carry);
+                carry.clear();
+            }
+            else
+            {
+                lineBuffer.assign(data + begin, i - begin);
+                line(lineBuffer);
+            }
+            begin = i + 1;
+        }
+        carry.append(data + begin, length - begin);
+    }
+
+    void ingest(const std::string &text) { ingest(text.data(), text.size()); }
+
+    // Applies whatever the current window holds, including an unterminated last line.
+    void flush()
+    {
+        if (!carry.empty())
+        {
+            line(carry);
+            carry.clear();
+        }
+        closeWindow();
+    }
+
+    const WeatherFeedStats &stats() const { return counters; }
+
+private:
+    WeatherFeedResolver resolver;
+    ApplyFn apply;
+    long long window;
+    std::vector<SubscriberFn> subscribers;
+    std::vector<WeatherEvent> pending;
+    std::vector<int> airportSlot, edgeSlot;
+    std::vector<int> changed;
+    std::string carry, lineBuffer;
+    long long windowStart = 0;
+    WeatherFeedStats counters;
+
+    void line(const std::string &text)
+    {
+        if (text.empty() || text.find_first_not_of(" \t\r") == std::string::npos)
+            return;
+        ++counters.lines;
+        WeatherEvent event;
+        if (!parseWeatherEvent(text.c_str(), resolver, event))
+        {
+            ++counters.rejected;
+            return;
+        }
+        if (pending.empty())
+            windowStart = event.time;
+        else if (event.time - windowStart >= window)
+        {
+            closeWindow();
+            windowStart = event.time;
+        }
+
+        int &slot = event.edge >= 0 ? edgeSlot[event.edge] : airportSlot[event.airport];
+        if (slot >= 0)
+        {
+            ++counters.coalesced;
+            if (event.time >= pending[slot].time)
+                pending[slot] = event;
+            return;
+        }
+        slot = static_cast<int>(pending.size());
+        pending.push_back(event);
+    }
+
+    void closeWindow()
+    {
+        if (pending.empty())
+            return;
+        changed.clear();
+        apply(pending, changed);
+        counters.applied += pending.size();
+        counters.changedEdges += changed.size();
+        ++counters.batches;
+        for (const auto &e : pending)
+            (e.edge >= 0 ? edgeSlot[e.edge] : airportSlot[e.airport]) = -1;
+        pending.clear();
+        if (!changed.empty())
+            for (const auto &fn : subscribers)
+                fn(changed);
+    }
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+// Gridded weather: a lat/lon raster of WeatherMain codes, one layer per time
+// slice, plus a per-edge list of the raster cells its great-circle track
+// crosses. The edge table depends only on geometry, so it is built once when
+// the network loads; after that, "which edges cross bad weather at time t" is
+// a gather of one mask word per listed cell followed by a segmented OR, with no
+// trigonometry and no per-airport lookups.
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "geodesic.h"
+#include "storm_field.h"
+#include "weather_records.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+class WeatherGrid
+{
+public:
+    WeatherGrid() = default;
+
+    WeatherGrid(double latMin, double latMax, double lonMin, double lonMax, double cellDeg, long long start, int sliceSeconds, int slices)
+        : latMin(latMin), lonMin(lonMin), cellDeg(cellDeg), start(start), sliceSeconds(sliceSeconds),
+          rows(static_cast<int>(std::ceil((latMax - latMin) / cellDeg))),
+          cols(static_cast<int>(std::ceil((lonMax - lonMin) / cellDeg))),
+          sliceCount(slices),
+          codes(static_cast<size_t>(slices) * rows * cols, static_cast<uint8_t>(WeatherMain::Clear))
+    {
+    }
+
+    int cellCount() const { return rows * cols; }
+    int slices() const { return sliceCount; }
+    double cellSizeDeg() const { return cellDeg; }
+
+    // Cell holding a position; positions off the raster clamp to its border.
+    int cellIndex(double lat, double lon) const
+    {
+        int r = std::min(rows - 1, std::max(0, static_cast<int>((lat - latMin) / cellDeg)));
+        int c = std::min(cols - 1, std::max(0, static_cast<int>((lon - lonMin) / cellDeg)));
+        return r * cols + c;
+    }
+
+    // Slice in effect at epoch second t, clamped to the covered span.
+    int sliceAt(long long t) const
+    {
+        long long k = (t - start) / sliceSeconds;
+        return static_cast<int>(std::min<long long>(sliceCount - 1, std::max<long long>(0, k)));
+    }
+
+    long long sliceTime(int slice) const { return start + static_cast<long long>(slice) * sliceSeconds; }
+
+    WeatherMain at(int slice, int cell) const { return static_cast<WeatherMain>(codes[static_cast<size_t>(slice) * rows * cols + cell]); }
+    void set(int slice, int cell, WeatherMain m) { codes[static_cast<size_t>(slice) * rows * cols + cell] = static_cast<uint8_t>(m); }
+
+    // Bad-weather mask of one slice, one 32-bit lane per cell for the gather.
+    void badMask(int slice, std::vector<int32_t> &mask) const
+    {
+        mask.resize(cellCount());
+        const uint8_t *layer = &codes[static_cast<size_t>(slice) * rows * cols];
+        for (int i = 0; i < cellCount(); ++i)
+            mask[i] = isBadCondition(static_cast<WeatherMain>(layer[i])) ? 1 : 0;
+    }
+
+    // Moves the covered span to begin at epoch second `from` and burns the
+    // field in again; edge cell lists stay valid, the geometry is unchanged.
+    void refresh(const StormField &field, long long from)
+    {
+        start = from;
+        rasterize(field);
+    }
+
+    // Burns every storm cell into every slice: each storm only visits the
+    // raster cells inside its lat/lon bounding box.
+    void rasterize(const StormField &field)
+    {
+        const double pi = 3.14159265358979323846;
+        StormSnapshot snapshot;
+        for (int slice = 0; slice < sliceCount; ++slice)
+        {
+            std::fill(codes.begin() + static_cast<size_t>(slice) * rows * cols, codes.begin() + static_cast<size_t>(slice + 1) * rows * cols,
+                      static_cast<uint8_t>(WeatherMain::Clear));
+            field.at(sliceTime(slice), snapshot);
+            for (size_t s = 0; s < snapshot.size(); ++s)
+            {
+                double lat = std::asin(std::max(-1.0, std::min(1.0, snapshot.z[s]))) * 180.0 / pi;
+                double lon = std::atan2(snapshot.y[s], snapshot.x[s]) * 180.0 / pi;
+                double radiusDeg = std::asin(std::min(1.0, snapshot.sinRadius[s])) * 180.0 / pi;
+                double lonSpan = radiusDeg / std::max(0.05, std::cos(std::min(89.0, std::fabs(lat) + radiusDeg) * pi / 180.0));
+                int r0 = std::max(0, static_cast<int>((lat - radiusDeg - latMin) / cellDeg));
+                int r1 = std::min(rows - 1, static_cast<int>((lat + radiusDeg - latMin) / cellDeg));
+                int c0 = std::max(0, static_cast<int>((lon - lonSpan - lonMin) / cellDeg));
+                int c1 = std::min(cols - 1, static_cast<int>((lon + lonSpan - lonMin) / cellDeg));
+                WeatherMain code = weatherMainCode(stormKindName(snapshot.kind[s]));
+                for (int r = r0; r <= r1; ++r)
+                {
+                    for (int c = c0; c <= c1; ++c)
+                    {
+                        UnitVector p = unitVector(latMin + (r + 0.5) * cellDeg, lonMin + (c + 0.5) * cellDeg);
+                        double dx = snapshot.x[s] - p.x, dy = snapshot.y[s] - p.y, dz = snapshot.z[s] - p.z;
+                        if (dx * dx + dy * dy + dz * dz <= snapshot.limit[s])
+                            set(slice, r * cols + c, code);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    double latMin = 0, lonMin = 0, cellDeg = 1;
+    long long start = 0;
+    int sliceSeconds = 10800;
+    int rows = 0, cols = 0, sliceCount = 0;
+    std::vector<uint8_t> codes;
+};
+
+// Raster cells under each edge, stored CSR-style: edge e owns
+// cells[offsets[e] .. offsets[e + 1]).
+struct EdgeCellTable
+{
+    std::vector<uint32_t> offsets{0};
+    std::vector<int32_t> cells;
+
+    size_t edges() const { return offsets.size() - 1; }
+
+    // Samples the great circle a-b at half-cell spacing and keeps each cell
+    // once, in track order.
+    void addEdge(const WeatherGrid &grid, const UnitVector &a, const UnitVector &b)
+    {
+        const double pi = 3.14159265358979323846;
+        double dot = std::max(-1.0, std::min(1.0, a.x * b.x + a.y * b.y + a.z * b.z));
+        double angle = std::acos(dot);
+        double step = grid.cellSizeDeg() * pi / 180.0 * 0.5;
+        int samples = std::max(1, static_cast<int>(std::ceil(angle / step)));
+        double s = std::sin(angle);
+        size_t first = cells.size();
+        for (int k = 0; k <= samples; ++k)
+        {
+            double t = static_cast<double>(k) / samples;
+            double wa = s > 1e-12 ? std::sin((1 - t) * angle) / s : 1 - t;
+            double wb = s > 1e-12 ? std::sin(t * angle) / s : t;
+            double x = wa * a.x + wb * b.x, y = wa * a.y + wb * b.y, z = wa * a.z + wb * b.z;
+            double lat = std::asin(std::max(-1.0, std::min(1.0, z))) * 180.0 / pi;
+            double lon = std::atan2(y, x) * 180.0 / pi;
+            int cell = grid.cellIndex(lat, lon);
+            if (std::find(cells.begin() + first, cells.end(), cell) == cells.end())
+                cells.push_back(cell);
+        }
+        offsets.push_back(static_cast<uint32_t>(cells.size()));
+    }
+
+    // out[e] = 1 when any cell under edge e is set in mask (see badMask).
+    void crossing(const std::vector<int32_t> &mask, std::vector<uint8_t> &out, std::vector<int32_t> &scratch) const
+    {
+        size_t n = cells.size();
+        scratch.resize(n);
+        const int32_t *base = mask.data();
+        size_t i = 0;
+#if defined(__AVX512F__)
+        for (; i + 16 <= n; i += 16)
+        {
+            __m512i idx = _mm512_loadu_si512(reinterpret_cast<const void *>(&cells[i]));
+            _mm512_storeu_si512(reinterpret_cast<void *>(&scratch[i]), _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, idx, base, 4));
+        }
+#elif defined(__AVX2__)
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&cells[i]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(&scratch[i]), _mm256_i32gather_epi32(base, idx, 4));
+        }
+#endif
+        for (; i < n; ++i)
+            scratch[i] = base[cells[i]];
+
+        out.resize(edges());
+        for (size_t e = 0; e < edges(); ++e)
+        {
+            int32_t any = 0;
+            for (uint32_t k = offsets[e]; k < offsets[e + 1]; ++k)
+                any |= scratch[k];
+            out[e] = static_cast<uint8_t>(any);
+        }
+    }
+};
@@ -0,0 +1,302 @@
+#pragma once
+
+// Record and replay backends for WeatherProvider (see weather_client.h).
+//
+//   AEROROUTE_WEATHER=live     fetch from OpenWeatherMap (default)
+//   AEROROUTE_WEATHER=record   fetch live and append every response to the log
+//   AEROROUTE_WEATHER=replay   answer from the log only, never touching the network
+//   AEROROUTE_WEATHER=storm    synthesize responses from a moving storm field
+//                              (storm_field.h, tuned with AEROROUTE_STORMS)
+//
+// The log (AEROROUTE_WEATHER_LOG, default weather_log.bin) is an append-only
+// sequence of fixed headers followed by the raw response body. Replay maps the
+// file read-only, indexes it once by endpoint and airport position, and serves
+// the latest response recorded at or before its clock (AEROROUTE_REPLAY_TIME,
+// epoch seconds; by default the newest one), so the same log always yields the
+// same weather.
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include "weather_client.h"
+#include "storm_field.h"
+#include "mapped_file.h"
+
+#pragma pack(push, 1)
+struct WeatherLogRecord
+{
+    int64_t recordedAt;
+    double lat;
+    double lon;
+    uint8_t endpoint;
+    uint8_t reserved[3];
+    int32_t status;
+    uint32_t length;
+};
+#pragma pack(pop)
+
+const char WeatherLogMagic[4] = {'A', 'W', 'L', '1'};
+
+inline std::string weatherLogPath()
+{
+    const char *env = getenv("AEROROUTE_WEATHER_LOG");
+    return env && *env ? env : "weather_log.bin";
+}
+
+inline std::string weatherMode()
+{
+    const char *env = getenv("AEROROUTE_WEATHER");
+    return env && *env ? env : "live";
+}
+
+// Calls f(record, body) for every complete record of a mapped log; a torn
+// final record (the recorder was killed mid-write) is ignored.
+template <typename F>
+bool forEachWeatherLogRecord(const MappedFile &log, F f)
+{
+    if (log.size() < sizeof(WeatherLogMagic) || memcmp(log.data(), WeatherLogMagic, sizeof(WeatherLogMagic)) != 0)
+        return false;
+    size_t offset = sizeof(WeatherLogMagic);
+    while (offset + sizeof(WeatherLogRecord) <= log.size())
+    {
+        WeatherLogRecord rec;
+        memcpy(&rec, log.data() + offset, sizeof(rec));
+        size_t body = offset + sizeof(rec);
+        if (body + rec.length > log.size())
+            break;
+        f(rec, log.data() + body);
+        offset = body + rec.length;
+    }
+    return true;
+}
+
+// Airports are identified by position, rounded to about 10 m.
+inline uint64_t weatherLogKey(WeatherEndpoint endpoint, double lat, double lon)
+{
+    uint64_t a = static_cast<uint32_t>(std::llround(lat * 1e4) + 900000);
+    uint64_t b = static_cast<uint32_t>(std::llround(lon * 1e4) + 1800000);
+    return (static_cast<uint64_t>(endpoint) << 62) | (a << 31) | b;
+}
+
+// Live fetching plus an append to the log once each response arrives. A
+// single writer thread drains responses in request order.
+class RecordingWeatherProvider : public WeatherProvider
+{
+public:
+    explicit RecordingWeatherProvider(const std::string &path)
+    {
+        log = fopen(path.c_str(), "ab");
+        if (log && fseek(log, 0, SEEK_END) == 0 && ftell(log) == 0)
+        {
+            fwrite(WeatherLogMagic, 1, sizeof(WeatherLogMagic), log);
+            fflush(log);
+        }
+    }
+
+    ~RecordingWeatherProvider()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        ready.notify_all();
+        if (writer.joinable())
+            writer.join();
+        if (log)
+            fclose(log);
+    }
+
+    std::shared_future<WeatherResponse> fetch(WeatherEndpoint endpoint, double lat, double lon, const std::string &apiKey) override
+    {
+        std::shared_future<WeatherResponse> future = live.fetch(endpoint, lat, lon, apiKey);
+        if (!log)
+            return future;
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!writer.joinable())
+            writer = std::thread([this]()
+                                 { drain(); });
+        queue.push_back({endpoint, lat, lon, future});
+        ready.notify_one();
+        return future;
+    }
+
+private:
+    struct Pending
+    {
+        WeatherEndpoint endpoint;
+        double lat;
+        double lon;
+        std::shared_future<WeatherResponse> response;
+    };
+
+    WeatherClient live;
+    FILE *log = nullptr;
+    std::deque<Pending> queue;
+    std::mutex mtx;
+    std::condition_variable ready;
+    std::thread writer;
+    bool stopping = false;
+
+    void drain()
+    {
+        while (true)
+        {
+            Pending p;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                ready.wait(lock, [this]()
+                           { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                p = std::move(queue.front());
+                queue.pop_front();
+            }
+            const WeatherResponse &r = p.response.get();
+            WeatherLogRecord rec = {};
+            rec.recordedAt = static_cast<int64_t>(std::time(nullptr));
+            rec.lat = p.lat;
+            rec.lon = p.lon;
+            rec.endpoint = static_cast<uint8_t>(p.endpoint);
+            rec.status = static_cast<int32_t>(r.status);
+            rec.length = static_cast<uint32_t>(r.text.size());
+            fwrite(&rec, sizeof(rec), 1, log);
+            fwrite(r.text.data(), 1, r.text.size(), log);
+            fflush(log);
+        }
+    }
+};
+
+// Serves recorded responses straight out of the mapped log. Lookups for
+// positions that were never recorded answer 404, as an offline API would.
+class ReplayWeatherProvider : public WeatherProvider
+{
+public:
+    explicit ReplayWeatherProvider(const std::string &path, long long clock = replayClock())
+        : log(path)
+    {
+        forEachWeatherLogRecord(log, [&](const WeatherLogRecord &rec, const char *body)
+                                {
+                                    if (clock > 0 && rec.recordedAt > clock)
+                                        return;
+                                    Entry &e = latest[weatherLogKey(static_cast<WeatherEndpoint>(rec.endpoint), rec.lat, rec.lon)];
+                                    if (!e.body || rec.recordedAt >= e.recordedAt)
+                                        e = {rec.recordedAt, rec.status, body, rec.length};
+                                    ++recordCount; });
+    }
+
+    std::shared_future<WeatherResponse> fetch(WeatherEndpoint endpoint, double lat, double lon, const std::string &) override
+    {
+        std::promise<WeatherResponse> promise;
+        auto it = latest.find(weatherLogKey(endpoint, lat, lon));
+        if (it == latest.end())
+            promise.set_value({404, "{\"cod\":\"404\",\"message\":\"not in weather log\"}"});
+        else
+            promise.set_value({it->second.status, std::string(it->second.body, it->second.length)});
+        return promise.get_future().share();
+    }
+
+    size_t records() const { return recordCount; }
+    size_t locations() const { return latest.size(); }
+
+    static long long replayClock()
+    {
+        const char *env = getenv("AEROROUTE_REPLAY_TIME");
+        return env && *env ? atoll(env) : 0;
+    }
+
+private:
+    struct Entry
+    {
+        long long recordedAt = 0;
+        long status = 0;
+        const char *body = nullptr;
+        size_t length = 0;
+    };
+
+    MappedFile log;
+    std::unordered_map<uint64_t, Entry> latest;
+    size_t recordCount = 0;
+};
+
+// OpenWeatherMap-shaped responses generated from a StormField, so every
+// consumer of forecasts sees the synthetic storms without any other change.
+class StormWeatherProvider : public WeatherProvider
+{
+public:
+    explicit StormWeatherProvider(const StormFieldConfig &config = stormConfigFromEnv()) : field(config) {}
+
+    std::shared_future<WeatherResponse> fetch(WeatherEndpoint endpoint, double lat, double lon, const std::string &) override
+    {
+        UnitVector p = unitVector(lat, lon);
+        long long now = static_cast<long long>(std::time(nullptr));
+        std::ostringstream out;
+        StormSnapshot snapshot;
+        if (endpoint == WeatherEndpoint::Current)
+        {
+            field.at(now, snapshot);
+            out << "{";
+            appendConditions(out, snapshot, p, lat);
+            out << ",\"dt\":" << now << ",\"cod\":200}";
+        }
+        else
+        {
+            // Forty 3-hour slots on the API's UTC grid.
+            long long first = now / 10800 * 10800;
+            out << "{\"cod\":\"200\",\"cnt\":40,\"list\":[";
+            for (int i = 0; i < 40; ++i)
+            {
+                long long t = first + i * 10800LL;
+                field.at(t, snapshot);
+                out << (i ? ",{" : "{") << "\"dt\":" << t << ",";
+                appendConditions(out, snapshot, p, lat);
+                out << "}";
+            }
+            out << "]}";
+        }
+        std::promise<WeatherResponse> promise;
+        promise.set_value({200, out.str()});
+        return promise.get_future().share();
+    }
+
+private:
+    StormField field;
+
+    static void appendConditions(std::ostringstream &out, const StormSnapshot &snapshot, const UnitVector &p, double lat)
+    {
+        int cell = snapshot.cellAt(p);
+        double temp = 22.0 - (lat - 30.0) * 0.6 - (cell >= 0 ? 4.0 : 0.0);
+        if (cell >= 0 && snapshot.kind[cell] == StormKind::Snow)
+            temp = -2.0;
+        out << "\"main\":{\"temp\":" << temp << ",\"humidity\":" << (cell >= 0 ? 95 : 55) << "},"
+            << "\"weather\":[{\"main\":\"" << (cell >= 0 ? stormKindName(snapshot.kind[cell]) : "Clear")
+            << "\",\"description\":\"" << (cell >= 0 ? stormKindDescription(snapshot.kind[cell]) : "clear sky") << "\"}],"
+            << "\"wind\":{\"speed\":" << (cell >= 0 ? 17.5 : 3.5) << "}";
+    }
+};
+
+inline std::unique_ptr<WeatherProvider> makeWeatherProvider()
+{
+    std::string mode = weatherMode();
+    if (mode == "record")
+        return std::unique_ptr<WeatherProvider>(new RecordingWeatherProvider(weatherLogPath()));
+    if (mode == "replay")
+        return std::unique_ptr<WeatherProvider>(new ReplayWeatherProvider(weatherLogPath()));
+    if (mode == "storm")
+        return std::unique_ptr<WeatherProvider>(new StormWeatherProvider());
+    return std::unique_ptr<WeatherProvider>(new WeatherClient());
+}
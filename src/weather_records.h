@@ -0,0 +1,395 @@
+#pragma once
+
+// Streaming extraction of OpenWeatherMap /weather and /forecast payloads into
+// fixed-size records. The scanner walks the response text once, reads only
+// the handful of fields we use and skips everything else without building a
+// DOM or allocating. Condition names become a small enum and descriptions are
+// interned process-wide, so a record is a few bytes of plain data.
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <algorithm>
+#include <cctype>
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's
+// days_from_civil), so timestamps never go through mktime and its tz lock.
+inline long long daysFromCivil(int y, int m, int d)
+{
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+enum class WeatherMain : uint8_t
+{
+    Unknown,
+    Clear,
+    Clouds,
+    Drizzle,
+    Rain,
+    Thunderstorm,
+    Snow,
+    Mist,
+    Smoke,
+    Haze,
+    Dust,
+    Fog,
+    Sand,
+    Ash,
+    Squall,
+    Tornado,
+    Extreme,
+    Count
+};
+
+inline const std::string &weatherMainName(WeatherMain m)
+{
+    static const std::string names[] = {"--", "Clear", "Clouds", "Drizzle", "Rain", "Thunderstorm", "Snow", "Mist",
+                                        "Smoke", "Haze", "Dust", "Fog", "Sand", "Ash", "Squall", "Tornado", "Extreme"};
+    return names[static_cast<size_t>(m) < static_cast<size_t>(WeatherMain::Count) ? static_cast<size_t>(m) : 0];
+}
+
+inline WeatherMain weatherMainCode(std::string_view s)
+{
+    for (size_t i = 1; i < static_cast<size_t>(WeatherMain::Count); ++i)
+        if (s == weatherMainName(static_cast<WeatherMain>(i)))
+            return static_cast<WeatherMain>(i);
+    return WeatherMain::Unknown;
+}
+
+// Conditions that close an airport or segment. Every closure path (reports,
+// feed events, the gridded raster) judges weather through this one test.
+inline bool isBadCondition(WeatherMain m)
+{
+    return m == WeatherMain::Thunderstorm || m == WeatherMain::Snow || m == WeatherMain::Tornado || m == WeatherMain::Squall ||
+           m == WeatherMain::Ash || m == WeatherMain::Sand || m == WeatherMain::Dust || m == WeatherMain::Rain || m == WeatherMain::Extreme;
+}
+
+// Same test on a "main" string as the API spells it, in any case; "heavy
+// rain" is rain.
+inline bool isBadWeather(std::string_view main)
+{
+    std::string folded(main);
+    for (char &c : folded)
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    if (folded == "heavy rain")
+        return isBadCondition(WeatherMain::Rain);
+    for (size_t i = 1; i < static_cast<size_t>(WeatherMain::Count); ++i)
+    {
+        const std::string &name = weatherMainName(static_cast<WeatherMain>(i));
+        if (folded.size() == name.size() && std::equal(name.begin(), name.end(), folded.begin(), [](char a, char b)
+                                                       { return tolower(static_cast<unsigned char>(a)) == b; }))
+            return isBadCondition(static_cast<WeatherMain>(i));
+    }
+    return false;
+}
+
+// Process-wide description table. Ids are stable for the life of the process
+// and text references never move; id 0 is the empty/unknown description.
+class DescriptionTable
+{
+public:
+    static DescriptionTable &instance()
+    {
+        static DescriptionTable table;
+        return table;
+    }
+
+    uint16_t intern(std::string_view s)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = ids.find(s);
+        if (it != ids.end())
+            return it->second;
+        if (texts.size() >= 0xFFFF)
+            return 0;
+        texts.emplace_back(s);
+        uint16_t id = static_cast<uint16_t>(texts.size() - 1);
+        ids.emplace(texts.back(), id);
+        return id;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return texts.size();
+    }
+
+    const std::string &text(uint16_t id)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return id < texts.size() ? texts[id] : texts[0];
+    }
+
+private:
+    std::deque<std::string> texts{std::string("--")};
+    std::unordered_map<std::string_view, uint16_t> ids;
+    std::mutex mtx;
+};
+
+struct WeatherRecord
+{
+    long long time = 0;
+    WeatherMain main = WeatherMain::Unknown;
+    uint8_t humidity = 0;
+    uint16_t description = 0;
+    float temp = 0;
+    float wind = 0;
+};
+
+namespace weather_detail
+{
+    // Pull scanner over a NUL-terminated JSON text. Every routine leaves p on
+    // the first byte after what it consumed and sets ok=false on bad input.
+    struct Scanner
+    {
+        const char *p;
+        bool ok = true;
+
+        void ws()
+        {
+            while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+                ++p;
+        }
+
+        bool eat(char c)
+        {
+            ws();
+            if (*p != c)
+                return false;
+            ++p;
+            return true;
+        }
+
+        // Raw string contents without the quotes; escapes are left as-is.
+        std::string_view string()
+        {
+            ws();
+            if (*p != '"')
+            {
+                ok = false;
+                return {};
+            }
+            const char *begin = ++p;
+            while (*p && *p != '"')
+                p += (*p == '\\' && p[1]) ? 2 : 1;
+            if (!*p)
+            {
+                ok = false;
+                return {};
+            }
+            return std::string_view(begin, static_cast<size_t>(p++ - begin));
+        }
+
+        double number()
+        {
+            ws();
+            char *end;
+            double v = strtod(p, &end);
+            if (end == p)
+                ok = false;
+            p = end;
+            return v;
+        }
+
+        void skip()
+        {
+            ws();
+            if (*p == '"')
+                string();
+            else if (*p == '{' || *p == '[')
+            {
+                int depth = 0;
+                do
+                {
+                    if (*p == '"')
+                    {
+                        string();
+                        continue;
+                    }
+                    if (*p == '{' || *p == '[')
+                        ++depth;
+                    else if (*p == '}' || *p == ']')
+                        --depth;
+                    else if (!*p)
+                    {
+                        ok = false;
+                        return;
+                    }
+                    ++p;
+                } while (depth > 0 && ok);
+            }
+            else
+            {
+                while (*p && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+                    ++p;
+            }
+        }
+
+        // Calls f(key) for each member of an object; f must consume the value.
+        template <typename F>
+        void object(F f)
+        {
+            if (!eat('{'))
+            {
+                ok = false;
+                return;
+            }
+            if (eat('}'))
+                return;
+            do
+            {
+                std::string_view key = string();
+                if (!ok || !eat(':'))
+                {
+                    ok = false;
+                    return;
+                }
+                f(key);
+            } while (ok && eat(','));
+            if (ok && !eat('}'))
+                ok = false;
+        }
+
+        // Calls f(index) for each element of an array; f must consume it.
+        template <typename F>
+        void array(F f)
+        {
+            if (!eat('['))
+            {
+                ok = false;
+                return;
+            }
+            if (eat(']'))
+                return;
+            size_t i = 0;
+            do
+                f(i++);
+            while (ok && eat(','));
+            if (ok && !eat(']'))
+                ok = false;
+        }
+    };
+
+    inline uint16_t internDescription(std::string_view raw)
+    {
+        if (raw.find('\\') == std::string_view::npos)
+            return DescriptionTable::instance().intern(raw);
+        std::string text;
+        for (size_t i = 0; i < raw.size(); ++i)
+        {
+            if (raw[i] == '\\' && i + 1 < raw.size())
+            {
+                char c = raw[++i];
+                text += c == 'n' ? '\n' : c == 't' ? '\t' : c;
+            }
+            else
+                text += raw[i];
+        }
+        return DescriptionTable::instance().intern(text);
+    }
+
+    inline long long epochFromText(std::string_view s)
+    {
+        int v[6] = {0, 0, 0, 0, 0, 0};
+        size_t f = 0;
+        for (char c : s)
+        {
+            if (c >= '0' && c <= '9')
+                v[f] = v[f] * 10 + (c - '0');
+            else if (++f == 6)
+                break;
+        }
+        return daysFromCivil(v[0], v[1], v[2]) * 86400 + v[3] * 3600 + v[4] * 60 + v[5];
+    }
+
+    // Fields shared by a current-weather payload and one forecast slot.
+    inline bool member(Scanner &s, std::string_view key, WeatherRecord &rec)
+    {
+        if (key == "main")
+            s.object([&](std::string_view k)
+                     {
+                         if (k == "temp")
+                             rec.temp = static_cast<float>(s.number());
+                         else if (k == "humidity")
+                             rec.humidity = static_cast<uint8_t>(s.number());
+                         else
+                             s.skip(); });
+        else if (key == "weather")
+            s.array([&](size_t i)
+                    {
+                        if (i > 0)
+                        {
+                            s.skip();
+                            return;
+                        }
+                        s.object([&](std::string_view k)
+                                 {
+                                     if (k == "main")
+                                         rec.main = weatherMainCode(s.string());
+                                     else if (k == "description")
+                                         rec.description = internDescription(s.string());
+                                     else
+                                         s.skip(); }); });
+        else if (key == "wind")
+            s.object([&](std::string_view k)
+                     {
+                         if (k == "speed")
+                             rec.wind = static_cast<float>(s.number());
+                         else
+                             s.skip(); });
+        else if (key == "dt")
+            rec.time = static_cast<long long>(s.number());
+        else
+            return false;
+        return true;
+    }
+}
+
+// Appends one record per forecast slot. Slots without "dt" fall back to
+// "dt_txt". Returns false on malformed input; out may then be partial.
+inline bool parseForecastRecords(const std::string &text, std::vector<WeatherRecord> &out)
+{
+    weather_detail::Scanner s{text.c_str()};
+    s.object([&](std::string_view key)
+             {
+                 if (key != "list")
+                 {
+                     s.skip();
+                     return;
+                 }
+                 s.array([&](size_t)
+                         {
+                             WeatherRecord rec;
+                             long long fromText = 0;
+                             s.object([&](std::string_view k)
+                                      {
+                                          if (k == "dt_txt")
+                                              fromText = weather_detail::epochFromText(s.string());
+                                          else if (!weather_detail::member(s, k, rec))
+                                              s.skip(); });
+                             if (rec.time == 0)
+                                 rec.time = fromText;
+                             out.push_back(rec); }); });
+    return s.ok;
+}
+
+inline bool parseCurrentRecord(const std::string &text, WeatherRecord &rec)
+{
+    weather_detail::Scanner s{text.c_str()};
+    s.object([&](std::string_view key)
+             {
+                 if (!weather_detail::member(s, key, rec))
+                     s.skip(); });
+    return s.ok;
+}